@@ -2428,15 +2428,56 @@ move_change(listOLD * new_game, const listOLD * new_move)
     return (plLastMove == new_move);
 }
 
-static int
-cmark_game_rollout(listOLD * game)
+/* queue the marked moves and cube decision of pmr for
+ * cmark_games_rollout(); ms must be the position of pmr */
+static void
+cmark_collect(moverecord * pmr, gboolean fMoves, GArray * paDecisions, GPtrArray * papmr, GArray * paNames)
 {
-    listOLD *pl, *pl_hint = NULL;
+    rolloutdecision rd;
+    gchar asz[2][FORMATEDMOVESIZE];
+    guint j;
 
-    g_return_val_if_fail(game, -1);
+    memset(&rd, 0, sizeof(rd));
+    GetMatchStateCubeInfo(&rd.ci, &ms);
+
+    if (fMoves) {
+        for (j = 0; j < pmr->ml.cMoves; j++)
+            if (pmr->ml.amMoves[j].cmark == CMARK_ROLLOUT)
+                rd.cMoves++;
+
+        if (rd.cMoves) {
+            rd.ppm = g_new(move *, rd.cMoves);
+            rd.cMoves = 0;
+            for (j = 0; j < pmr->ml.cMoves; j++) {
+                move *m = &pmr->ml.amMoves[j];
+
+                if (m->cmark != CMARK_ROLLOUT)
+                    continue;
+                rd.ppm[rd.cMoves++] = m;
+                FormatMove(asz[0], msBoard(), m->anMove);
+                g_array_append_val(paNames, asz[0]);
+            }
+            g_array_append_val(paDecisions, rd);
+            g_ptr_array_add(papmr, pmr);
+            rd.cMoves = 0;
+            rd.ppm = NULL;
+        }
+    }
 
-    if (game_is_last(game))
-        pl_hint = game_add_pmr_hint(game);
+    if (pmr->CubeDecPtr && pmr->CubeDecPtr->cmark == CMARK_ROLLOUT) {
+        memcpy(rd.anBoard, msBoard(), sizeof(TanBoard));
+        rd.pes = setup_cube_rollout(&pmr->CubeDecPtr->esDouble, pmr, rd.aarOutput, rd.aarStdDev);
+        FormatCubePositions(&rd.ci, asz);
+        g_array_append_vals(paNames, asz, 2);
+        g_array_append_val(paDecisions, rd);
+        g_ptr_array_add(papmr, pmr);
+    }
+}
+
+static int
+cmark_game_collect(listOLD * game, GArray * paDecisions, GPtrArray * papmr, GArray * paNames)
+{
+    listOLD *pl;
 
     ChangeGame(game);
 
@@ -2450,43 +2491,136 @@ cmark_game_rollout(listOLD * game)
         switch (pmr->mt) {
         case MOVE_NORMAL:
             if (!move_change(game, pl->plPrev))
-                goto finished;
-            if (cmark_move_rollout(pmr, TRUE) < -1)
-                goto finished;
-            if (cmark_cube_rollout(pmr, TRUE) < -1)
-                goto finished;
+                return -1;
+            cmark_collect(pmr, TRUE, paDecisions, papmr, paNames);
             break;
         case MOVE_DOUBLE:
             pmr_prev = game->plPrev->p;
             if (pmr_prev->mt == MOVE_DOUBLE)
                 break;
             if (!move_change(game, pl->plPrev))
-                goto finished;
-            if (cmark_cube_rollout(pmr, TRUE) < -1)
-                goto finished;
+                return -1;
+            cmark_collect(pmr, FALSE, paDecisions, papmr, paNames);
             break;
         default:
             break;
         }
     }
-    if (pl_hint)
-        game_remove_pmr_hint(pl_hint);
     return 0;
-  finished:
+}
+
+/* Roll out all the decisions marked in the games together.  The
+ * decisions share one rollout, so the threads stay busy on the ones
+ * still undecided instead of waiting for each to finish in turn. */
+static int
+cmark_games_rollout(GSList * games)
+{
+    GArray *paDecisions = g_array_new(FALSE, FALSE, sizeof(rolloutdecision));
+    GPtrArray *papmr = g_ptr_array_new();
+    GArray *paNames = g_array_new(FALSE, FALSE, FORMATEDMOVESIZE);
+    listOLD *pl_hint = NULL;
+    GSList *pl;
+    guint i, j;
+    int res = 0;
+    void *p;
+
+    for (pl = games; pl; pl = g_slist_next(pl)) {
+        listOLD *game = pl->data;
+
+        if (game_is_last(game))
+            pl_hint = game_add_pmr_hint(game);
+
+        if (cmark_game_collect(game, paDecisions, papmr, paNames) < 0) {
+            res = -1;
+            break;
+        }
+    }
+
+    if (res == 0 && paDecisions->len) {
+        rolloutdecision *ard = (rolloutdecision *) (void *) paDecisions->data;
+
+        RolloutProgressStart(&ard[0].ci, paNames->len, NULL, &rcRollout,
+                             (char (*)[FORMATEDMOVESIZE]) (void *) paNames->data, TRUE, &p);
+        RolloutDecisions(ard, paDecisions->len, RolloutProgress, p);
+        if (RolloutProgressEnd(&p, TRUE) < 0)
+            res = -1;
+
+        for (i = 0; i < paDecisions->len; i++) {
+            moverecord *pmr = g_ptr_array_index(papmr, i);
+
+            if (ard[i].cMoves) {
+                positionkey key = { {0, 0, 0, 0, 0, 0, 0} };
+
+                if (pmr->n.iMove != UINT_MAX)
+                    CopyKey(pmr->ml.amMoves[pmr->n.iMove].key, key);
+
+                RefreshMoveList(&pmr->ml, NULL);
+
+                if (pmr->n.iMove != UINT_MAX)
+                    for (j = 0; j < pmr->ml.cMoves; j++)
+                        if (EqualKeys(key, pmr->ml.amMoves[j].key)) {
+                            pmr->n.iMove = j;
+                            pmr->n.stMove = Skill(pmr->ml.amMoves[j].rScore - pmr->ml.amMoves[0].rScore);
+                            break;
+                        }
+            } else {
+                memcpy(pmr->CubeDecPtr->aarOutput, ard[i].aarOutput, 2 * NUM_ROLLOUT_OUTPUTS * sizeof(float));
+                memcpy(pmr->CubeDecPtr->aarStdDev, ard[i].aarStdDev, 2 * NUM_ROLLOUT_OUTPUTS * sizeof(float));
+
+                if (ard[i].pes->et != EVAL_ROLLOUT)
+                    memcpy(&pmr->CubeDecPtr->esDouble.rc, &rcRollout, sizeof(rcRollout));
+
+                pmr->CubeDecPtr->esDouble.et = EVAL_ROLLOUT;
+            }
+        }
+
+#if defined(USE_GTK)
+        if (fX)
+            ChangeGame(NULL);
+        else
+#endif
+            ShowBoard();
+    }
+
     if (pl_hint)
         game_remove_pmr_hint(pl_hint);
-    return -1;
+
+    for (i = 0; i < paDecisions->len; i++)
+        g_free(g_array_index(paDecisions, rolloutdecision, i).ppm);
+
+    g_array_free(paNames, TRUE);
+    g_ptr_array_free(papmr, TRUE);
+    g_array_free(paDecisions, TRUE);
+
+    return res;
+}
+
+static int
+cmark_game_rollout(listOLD * game)
+{
+    GSList *games;
+    int res;
+
+    g_return_val_if_fail(game, -1);
+
+    games = g_slist_append(NULL, game);
+    res = cmark_games_rollout(games);
+    g_slist_free(games);
+
+    return res;
 }
 
 static void
 cmark_match_rollout(listOLD * match)
 {
+    GSList *games = NULL;
     listOLD *pl;
 
-    for (pl = match->plNext; pl != match; pl = pl->plNext) {
-        if (cmark_game_rollout(pl->p) < 0)
-            break;
-    }
+    for (pl = match->plNext; pl != match; pl = pl->plNext)
+        games = g_slist_append(games, pl->p);
+
+    cmark_games_rollout(games);
+    g_slist_free(games);
 }
 
 static gint
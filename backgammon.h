@@ -331,6 +331,8 @@ extern char *default_export_folder;
 extern char *default_import_folder;
 extern char *default_sgf_folder;
 extern char *log_file_name;
+extern char *szRolloutJournal;
+extern char *szRolloutServer;
 extern char *szCurrentFileName;
 extern char *szCurrentFolder;
 extern const char szDefaultPrompt[];
@@ -386,6 +388,10 @@ extern int fTutor;
 extern int fTutorChequer;
 extern int fTutorCube;
 extern int log_rollouts;
+extern unsigned int nRolloutBatch;
+extern int fRolloutAdaptive;
+extern int fRolloutCubeStop;
+extern float rRolloutCubeLimit;
 extern int nThreadPriority;
 extern int nToolbarStyle;
 extern int nTutorSkillCurrent;
@@ -417,6 +423,8 @@ extern rngcontext *rngctxRollout;
 
 extern command acAnnotateMove[];
 extern command acSetAnalysisPlayer[];
+extern command acSetCache[];
+extern command acSetThreads[];
 extern command acSetCheatPlayer[];
 extern command acSetEvalParam[];
 extern command acSetEvaluation[];
@@ -425,6 +433,8 @@ extern command acSetGeometryValues[];
 extern command acSetPlayer[];
 extern command acSetRNG[];
 extern command acSetRollout[];
+extern command acShowEvaluation[];
+extern command acSetRolloutCubeStop[];
 extern command acSetRolloutJsd[];
 extern command acSetRolloutLate[];
 extern command acSetRolloutLatePlayer[];
@@ -562,6 +572,8 @@ extern void CommandAnnotateUnlucky(char *);
 extern void CommandAnnotateVeryBad(char *);
 extern void CommandAnnotateVeryLucky(char *);
 extern void CommandAnnotateVeryUnlucky(char *);
+extern void CommandBenchmarkPrecision(char *);
+extern void CommandBenchmarkRollout(char *);
 extern void CommandCalibrate(char *);
 extern void CommandClearCache(char *);
 extern void CommandClearHint(char *);
@@ -656,6 +668,8 @@ extern void CommandRelationalTest(char *);
 extern void CommandResign(char *);
 extern void CommandRoll(char *);
 extern void CommandRollout(char *);
+extern void CommandRolloutTrace(char *);
+extern void CommandRolloutWorker(char *);
 extern void CommandSaveGame(char *);
 extern void CommandSaveMatch(char *);
 extern void CommandSavePosition(char *);
@@ -697,6 +711,11 @@ extern void CommandSetBeavers(char *);
 extern void CommandSetBoard(char *);
 extern void CommandSetBrowser(char *);
 extern void CommandSetCache(char *);
+extern void CommandSetCacheBearoff(char *);
+extern void CommandSetCacheFile(char *);
+extern void CommandSetCacheShared(char *);
+extern void CommandSetCacheTypeClustered(char *);
+extern void CommandSetCacheTypeStandard(char *);
 extern void CommandSetCalibration(char *);
 extern void CommandSetCheatEnable(char *);
 extern void CommandSetCheatPlayer(char *);
@@ -733,6 +752,8 @@ extern void CommandSetEvalParamEvaluation(char *);
 extern void CommandSetEvalParamRollout(char *);
 extern void CommandSetEvalParamType(char *);
 extern void CommandSetEvalPlies(char *);
+extern void CommandSetEvalPrecisionFloat(char *);
+extern void CommandSetEvalPrecisionInt16(char *);
 extern void CommandSetEvalPrune(char *);
 extern void CommandSetEvalSameAsAnalysis(char *);
 extern void CommandSetExportCubeDisplayActual(char *);
@@ -855,6 +876,8 @@ extern void CommandSetRNGManual(char *);
 extern void CommandSetRNGMD5(char *);
 extern void CommandSetRNGMersenne(char *);
 extern void CommandSetRNGRandomDotOrg(char *);
+extern void CommandSetRolloutAdaptive(char *);
+extern void CommandSetRolloutBatch(char *);
 extern void CommandSetRolloutBearoffTruncationExact(char *);
 extern void CommandSetRolloutBearoffTruncationOS(char *);
 extern void CommandSetRollout(char *);
@@ -862,6 +885,9 @@ extern void CommandSetRolloutChequerplay(char *);
 extern void CommandSetRolloutCubedecision(char *);
 extern void CommandSetRolloutCubeEqualChequer(char *);
 extern void CommandSetRolloutCubeful(char *);
+extern void CommandSetRolloutCubeStop(char *);
+extern void CommandSetRolloutCubeStopEnable(char *);
+extern void CommandSetRolloutCubeStopLimit(char *);
 extern void CommandSetRolloutInitial(char *);
 extern void CommandSetRolloutJsd(char *);
 extern void CommandSetRolloutJsdEnable(char *);
@@ -879,6 +905,7 @@ extern void CommandSetRolloutLimitEnable(char *);
 extern void CommandSetRolloutLimitMinGames(char *);
 extern void CommandSetRolloutLogEnable(char *);
 extern void CommandSetRolloutLogFile(char *);
+extern void CommandSetRolloutJournal(char *);
 extern void CommandSetRolloutMaxError(char *);
 extern void CommandSetRolloutMoveFilter(char *);
 extern void CommandSetRolloutPlayer(char *);
@@ -892,6 +919,7 @@ extern void CommandSetRolloutPlayersAreSame(char *);
 extern void CommandSetRolloutRNG(char *);
 extern void CommandSetRolloutRotate(char *);
 extern void CommandSetRolloutSeed(char *);
+extern void CommandSetRolloutServer(char *);
 extern void CommandSetRolloutTrials(char *);
 extern void CommandSetRolloutTruncation(char *);
 extern void CommandSetRolloutTruncationChequer(char *);
@@ -935,6 +963,8 @@ extern void CommandSetStyledGameList(char *);
 extern void CommandSetMarkedSamePlayer(char *);
 extern void CommandSetTheoryWindow(char *);
 extern void CommandSetThreads(char *);
+extern void CommandSetThreadsAffinity(char *);
+extern void CommandSetThreadsNUMA(char *);
 extern void CommandSetToolbar(char *);
 extern void CommandSetTurn(char *);
 extern void CommandSetTutorChequer(char *);
@@ -975,6 +1005,7 @@ extern void CommandShowDice(char *);
 extern void CommandShowDisplay(char *);
 extern void CommandShowEngine(char *);
 extern void CommandShowEvaluation(char *);
+extern void CommandShowEvaluationKernels(char *);
 extern void CommandShowExport(char *);
 extern void CommandShowFullBoard(char *);
 extern void CommandShowGammonValues(char *);
@@ -257,46 +257,496 @@ HeuristicDatabase(void (*pfProgress) (unsigned int))
 
 
 static void
-ReadBearoffFile(const bearoffcontext * pbc, unsigned int offset, unsigned char *buf, unsigned int nBytes)
+ReadBearoffError(unsigned char *buf, unsigned int nBytes)
 {
+    if (errno)
+        perror(_("bearoff database"));
+    else
+        fprintf(stderr, _("Error reading bearoff database\n"));
+
+    memset(buf, 0, nBytes);
+}
+
+/*
+ * Read nBytes at offset of an on disk database.
+ *
+ * Where pread() is available the reads are positional and threads
+ * never wait for each other; otherwise (or with BO_SEEK) the shared
+ * file position is guarded by the global lock.
+ */
+
+static void
+ReadBearoffFile(const bearoffcontext * pbc, size_t offset, unsigned char *buf, unsigned int nBytes)
+{
+#if HAVE_PREAD
+    if (!pbc->fSeek) {
+        int fd = fileno(pbc->pf);
+        unsigned int n = 0;
+
+        errno = 0;
+        while (n < nBytes) {
+            ssize_t r = pread(fd, buf + n, nBytes - n, (off_t) offset + n);
+
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0) {
+                ReadBearoffError(buf, nBytes);
+                return;
+            }
+            n += (unsigned int) r;
+        }
+        return;
+    }
+#endif
+
     MT_Exclusive();
 
+    errno = 0;
     if ((fseek(pbc->pf, (long) offset, SEEK_SET) < 0) || (fread(buf, 1, nBytes, pbc->pf) < nBytes)) {
-        if (errno)
-            perror(_("bearoff database"));
-        else
-            fprintf(stderr, _("Error reading bearoff database"));
-
-        memset(buf, 0, nBytes);
+        MT_Release();
+        ReadBearoffError(buf, nBytes);
         return;
     }
 
     MT_Release();
 }
 
-/* BEAROFF_GNUBG: read two sided bearoff database */
+/*
+ * Cache of recently decoded positions, in front of the file or mapping.
+ *
+ * The cache is four way set associative and replaces the least
+ * recently used way of a set. Each set has its own lock, so threads
+ * only wait for each other when they look up positions of the same set
+ * at the same moment.
+ */
+
+#define BEAROFF_CACHE_WAYS 4
+
+struct _bearoffcacheset {
+    unsigned short int aaus[BEAROFF_CACHE_WAYS][64];
+    unsigned int anPos[BEAROFF_CACHE_WAYS];     /* position + 1, 0 if unused */
+    unsigned int anUsed[BEAROFF_CACHE_WAYS];    /* nClock when last used */
+    unsigned int nClock;
+    unsigned int cLookup;
+    unsigned int cHit;
+#if defined(USE_MULTITHREAD)
+    int lock;
+#endif
+};
+
+static inline bearoffcacheset *
+CacheSetLock(const bearoffcontext * pbc, const unsigned int nPos)
+{
+    bearoffcacheset *pbcs = pbc->pCache + (nPos & (pbc->cCacheSets - 1));
+
+#if defined(USE_MULTITHREAD)
+    while (MT_SafeIncCheck(&pbcs->lock))
+        MT_SafeDec(&pbcs->lock);
+#endif
+
+    return pbcs;
+}
+
+static inline void
+CacheSetUnlock(bearoffcacheset * pbcs)
+{
+#if defined(USE_MULTITHREAD)
+    MT_SafeDec(&pbcs->lock);
+#else
+    (void) pbcs;
+#endif
+}
+
+/* Copies the first n values cached for nPos to aus; FALSE if not cached */
+static int
+CacheLookup(const bearoffcontext * pbc, const unsigned int nPos, unsigned short int aus[], const unsigned int n)
+{
+    bearoffcacheset *pbcs = CacheSetLock(pbc, nPos);
+    int i;
+
+    ++pbcs->cLookup;
+
+    for (i = 0; i < BEAROFF_CACHE_WAYS; ++i)
+        if (pbcs->anPos[i] == nPos + 1) {
+            memcpy(aus, pbcs->aaus[i], n * sizeof(unsigned short int));
+            pbcs->anUsed[i] = ++pbcs->nClock;
+            ++pbcs->cHit;
+            CacheSetUnlock(pbcs);
+            return TRUE;
+        }
+
+    CacheSetUnlock(pbcs);
+    return FALSE;
+}
+
 static void
-ReadTwoSidedBearoff(const bearoffcontext * pbc, const unsigned int iPos, float ar[4], unsigned short int aus[4])
+CacheAdd(const bearoffcontext * pbc, const unsigned int nPos, const unsigned short int aus[], const unsigned int n)
 {
-    unsigned int i, k = (pbc->fCubeful) ? 4 : 1;
-    unsigned char ac[8];
-    unsigned char *pc = NULL;
+    bearoffcacheset *pbcs = CacheSetLock(pbc, nPos);
+    int i, iOldest = 0;
+
+    for (i = 1; i < BEAROFF_CACHE_WAYS; ++i)
+        if (pbcs->anUsed[i] < pbcs->anUsed[iOldest])
+            iOldest = i;
+
+    memcpy(pbcs->aaus[iOldest], aus, n * sizeof(unsigned short int));
+    pbcs->anPos[iOldest] = nPos + 1;
+    pbcs->anUsed[iOldest] = ++pbcs->nClock;
+
+    CacheSetUnlock(pbcs);
+}
+
+/*
+ * Cache cEntries decoded positions of the database (rounded down to a
+ * power of two, 0 for no cache). Must not be called while other threads
+ * evaluate with the database.
+ *
+ * Returns the number of entries or -1 if the cache could not be allocated.
+ */
+
+extern int
+BearoffCacheResize(bearoffcontext * pbc, unsigned int cEntries)
+{
+    unsigned int cSets = 1;
+
+    g_return_val_if_fail(pbc, -1);
+
+    g_free(pbc->pCache);
+    pbc->pCache = NULL;
+    pbc->cCacheSets = 0;
+
+    if (cEntries < BEAROFF_CACHE_WAYS)
+        return 0;
+
+    while (cSets * 2 <= cEntries / BEAROFF_CACHE_WAYS)
+        cSets *= 2;
+
+    if ((pbc->pCache = g_try_new0(bearoffcacheset, cSets)) == NULL)
+        return -1;
+
+    pbc->cCacheSets = cSets;
+    return (int) (cSets * BEAROFF_CACHE_WAYS);
+}
+
+/*
+ * Compressed two sided databases.
+ *
+ * The positions are stored in tiles of BEAROFF_TILE x BEAROFF_TILE
+ * (fewer at the edges), with the positions of the player on roll as
+ * rows and those of the opponent as columns. The header is followed by
+ * the tiles, a row of tiles at a time, and the file ends with the
+ * offsets of all tiles and of the end of the last, 8 bytes each.
+ *
+ * In a tile the cubeful equities are taken relative to the cubeless
+ * one and each value is predicted from the position to its left, the
+ * one above and the one above to the left. The differences are written
+ * with a Rice code whose parameter is chosen for each tile and value,
+ * so a tile decodes on its own, from its top left position on.
+ */
+
+#define TILE_PARAM 5            /* bits of the Rice parameters */
+#define TILE_FIRST 17           /* bits of the values of the first position */
+#define TILE_ESCAPE 20          /* longer quotients are written as TILE_ESCAPE ones... */
+#define TILE_RAW 20             /* ...followed by the difference in TILE_RAW bits */
+
+typedef struct {
+    unsigned char *pc;
+    guint64 acc;
+    unsigned int nBits;
+} tilebits;
+
+static void
+TilePut(tilebits * ptb, const unsigned int n, const unsigned int nBits)
+{
+    ptb->acc |= (guint64) n << ptb->nBits;
+    ptb->nBits += nBits;
+
+    while (ptb->nBits >= 8) {
+        *ptb->pc++ = (unsigned char) ptb->acc;
+        ptb->acc >>= 8;
+        ptb->nBits -= 8;
+    }
+}
+
+/*
+ * Have at least 56 bits ahead in acc. This reads 8 bytes at a time, so
+ * there must be 8 bytes to read after the end of a tile; in the file the
+ * index follows the tiles.
+ */
+
+static inline void
+TileFill(tilebits * ptb)
+{
+    guint64 n;
+
+    memcpy(&n, ptb->pc, sizeof(n));
+    ptb->acc |= GUINT64_FROM_LE(n) << ptb->nBits;
+    ptb->pc += (63 - ptb->nBits) >> 3;
+    ptb->nBits |= 56;
+}
+
+static unsigned int
+TileGet(tilebits * ptb, const unsigned int nBits)
+{
+    unsigned int n;
+
+    TileFill(ptb);
+
+    n = (unsigned int) (ptb->acc & ((1u << nBits) - 1));
+    ptb->acc >>= nBits;
+    ptb->nBits -= nBits;
+
+    return n;
+}
+
+static inline unsigned int
+ZigZag(const int n)
+{
+    return n >= 0 ? (unsigned int) n << 1 : (((unsigned int) -n) << 1) - 1;
+}
+
+static inline int
+UnZigZag(const unsigned int n)
+{
+    return (int) (n >> 1) ^ -(int) (n & 1);
+}
+
+/* the value of position i of a tile with nCols columns as predicted
+ * from the values before it, ag[i * k] being the first of position i */
+static inline int
+TilePredict(const int *ag, const unsigned int i, const unsigned int nCols, const unsigned int k)
+{
+    if (i < nCols)
+        return ag[(i - 1) * k];
+    else if (!(i % nCols))
+        return ag[(i - nCols) * k];
+    else
+        return ag[(i - 1) * k] + ag[(i - nCols) * k] - ag[(i - nCols - 1) * k];
+}
+
+/*
+ * Compress a tile of nRows x nCols positions with k values each, given
+ * row by row in aus, into pc (at least BEAROFF_TILE_MAX_BYTES).
+ *
+ * Returns the number of bytes written.
+ */
+
+extern unsigned int
+BearoffEncodeTile(const unsigned short int aus[], const unsigned int nRows, const unsigned int nCols,
+                  const unsigned int k, unsigned char *pc)
+{
+    int ag[BEAROFF_TILE * BEAROFF_TILE * 4];
+    unsigned int az[BEAROFF_TILE * BEAROFF_TILE * 4];
+    unsigned int anParam[4];
+    unsigned int nPos = nRows * nCols;
+    unsigned int i, c, r;
+    tilebits tb = { pc, 0, 0 };
+
+    g_assert(nRows <= BEAROFF_TILE && nCols <= BEAROFF_TILE && k <= 4);
+
+    for (i = 0; i < nPos; ++i)
+        for (c = 0; c < k; ++c)
+            ag[i * k + c] = c ? aus[i * k + c] - aus[i * k] : aus[i * k];
+
+    for (i = 1; i < nPos; ++i)
+        for (c = 0; c < k; ++c)
+            az[i * k + c] = ZigZag(ag[i * k + c] - TilePredict(ag + c, i, nCols, k));
+
+    /* the cheapest Rice parameter for each value */
+
+    for (c = 0; c < k; ++c) {
+        unsigned int nBest = G_MAXUINT;
+
+        anParam[c] = 0;
+        for (r = 0; r < TILE_RAW; ++r) {
+            unsigned int nBits = 0;
+
+            for (i = 1; i < nPos; ++i)
+                nBits += (az[i * k + c] >> r) < TILE_ESCAPE ? (az[i * k + c] >> r) + 1 + r : TILE_ESCAPE + TILE_RAW;
+
+            if (nBits < nBest) {
+                nBest = nBits;
+                anParam[c] = r;
+            }
+        }
+        TilePut(&tb, anParam[c], TILE_PARAM);
+    }
+
+    for (c = 0; c < k; ++c)
+        TilePut(&tb, ZigZag(ag[c]), TILE_FIRST);
+
+    for (i = 1; i < nPos; ++i)
+        for (c = 0; c < k; ++c) {
+            unsigned int q = az[i * k + c] >> anParam[c];
+
+            if (q < TILE_ESCAPE) {
+                TilePut(&tb, (1u << q) - 1, q + 1);
+                TilePut(&tb, az[i * k + c] & ((1u << anParam[c]) - 1), anParam[c]);
+            } else {
+                TilePut(&tb, (1u << TILE_ESCAPE) - 1, TILE_ESCAPE);
+                TilePut(&tb, az[i * k + c], TILE_RAW);
+            }
+        }
+
+    if (tb.nBits)
+        *tb.pc++ = (unsigned char) tb.acc;
+
+    return (unsigned int) (tb.pc - pc);
+}
+
+/* the number of ones before the first zero, with at least 56 bits ahead */
+static inline unsigned int
+TileOnes(tilebits * ptb)
+{
+    TileFill(ptb);
+#if defined(__GNUC__)
+    return (unsigned int) __builtin_ctzll(~ptb->acc);
+#else
+    {
+        unsigned int n = 0;
+
+        while ((ptb->acc >> n) & 1)
+            ++n;
+        return n;
+    }
+#endif
+}
+
+/* decode a tile from its top left position up to position iTarget */
+static void
+DecodeTile(const unsigned char *pc, const unsigned int nCols, const unsigned int k,
+           const unsigned int iTarget, unsigned short int aus[4])
+{
+    int ag[BEAROFF_TILE * BEAROFF_TILE * 4];
+    unsigned int anParam[4];
+    unsigned int i, c, q, iCol;
+    tilebits tb = { (unsigned char *) pc, 0, 0 };
+
+    for (c = 0; c < k; ++c)
+        anParam[c] = TileGet(&tb, TILE_PARAM);
+
+    for (c = 0; c < k; ++c)
+        ag[c] = UnZigZag(TileGet(&tb, TILE_FIRST));
+
+    for (i = 1, iCol = 1; i <= iTarget; ++i, iCol = iCol + 1 < nCols ? iCol + 1 : 0)
+        for (c = 0; c < k; ++c) {
+            int *pg = ag + i * k + c;
+            unsigned int z;
+
+            /* TileOnes() leaves enough bits for the rest of the value */
+
+            if ((q = TileOnes(&tb)) < TILE_ESCAPE) {
+                tb.acc >>= q + 1;
+                z = (q << anParam[c]) | (unsigned int) (tb.acc & ((1u << anParam[c]) - 1));
+                tb.acc >>= anParam[c];
+                tb.nBits -= q + 1 + anParam[c];
+            } else {
+                tb.acc >>= TILE_ESCAPE;
+                z = (unsigned int) (tb.acc & ((1u << TILE_RAW) - 1));
+                tb.acc >>= TILE_RAW;
+                tb.nBits -= TILE_ESCAPE + TILE_RAW;
+            }
+
+            /* as TilePredict() */
+
+            if (i < nCols)
+                *pg = UnZigZag(z) + pg[-(int) k];
+            else if (!iCol)
+                *pg = UnZigZag(z) + pg[-(int) (nCols * k)];
+            else
+                *pg = UnZigZag(z) + pg[-(int) k] + pg[-(int) (nCols * k)] - pg[-(int) ((nCols + 1) * k)];
+        }
+
+    for (c = 0; c < k; ++c)
+        aus[c] = (unsigned short int) (c ? ag[iTarget * k + c] + ag[iTarget * k] : ag[iTarget * k]);
+}
+
+static inline size_t
+MakeOffset(const unsigned char *pc)
+{
+    guint64 n = 0;
+    int i;
+
+    for (i = 7; i >= 0; --i)
+        n = n << 8 | pc[i];
+
+    return (size_t) n;
+}
+
+static void
+ReadTwoSidedTile(const bearoffcontext * pbc, const unsigned int iPos, unsigned short int aus[4])
+{
+    const unsigned int n = Combination(pbc->nPoints + pbc->nChequers, pbc->nPoints);
+    const unsigned int nTiles = (n + BEAROFF_TILE - 1) / BEAROFF_TILE;
+    const unsigned int nUs = iPos / n, nThem = iPos % n;
+    const unsigned int iRow = nUs / BEAROFF_TILE * BEAROFF_TILE, iCol = nThem / BEAROFF_TILE * BEAROFF_TILE;
+    const unsigned int nCols = MIN(BEAROFF_TILE, n - iCol);
+    const size_t iIndex = pbc->iTileIndex + 8 * ((size_t) (nUs / BEAROFF_TILE) * nTiles + nThem / BEAROFF_TILE);
+    unsigned char ac[BEAROFF_TILE_MAX_BYTES + 8];
+    const unsigned char *pc;
+    size_t iStart, iEnd;
 
     if (pbc->p)
-        pc = pbc->p + 40 + 2 * iPos * k;
+        pc = pbc->p + iIndex;
     else {
-        ReadBearoffFile(pbc, 40 + 2 * iPos * k, ac, k * 2);
+        ReadBearoffFile(pbc, iIndex, ac, 16);
         pc = ac;
     }
-    /* add to cache */
 
-    for (i = 0; i < k; ++i) {
-        unsigned short int us = pc[2 * i] | (unsigned short) (pc[2 * i + 1] << 8);
+    iStart = MakeOffset(pc);
+    iEnd = MakeOffset(pc + 8);
 
+    if (iEnd < iStart || iEnd - iStart > BEAROFF_TILE_MAX_BYTES || iEnd > pbc->iTileIndex) {
+        fprintf(stderr, _("The bearoff file '%s' is likely to be corrupted.\n"), pbc->szFilename);
+        memset(aus, 0, 4 * sizeof(unsigned short int));
+        return;
+    }
+
+    if (pbc->p)
+        pc = pbc->p + iStart;
+    else {
+        /* with the 8 bytes after it for TileFill() */
+        ReadBearoffFile(pbc, iStart, ac, (unsigned int) (iEnd - iStart) + 8);
+        pc = ac;
+    }
+
+    DecodeTile(pc, nCols, pbc->fCubeful ? 4 : 1, (nUs - iRow) * nCols + nThem - iCol, aus);
+}
+
+/* BEAROFF_GNUBG: read two sided bearoff database */
+static void
+ReadTwoSidedBearoff(const bearoffcontext * pbc, const unsigned int iPos, float ar[4], unsigned short int aus[4])
+{
+    unsigned int i, k = (pbc->fCubeful) ? 4 : 1;
+    unsigned short int ausPos[4];
+
+    if (!pbc->pCache || !CacheLookup(pbc, iPos, ausPos, k)) {
+        unsigned char ac[8];
+        unsigned char *pc = NULL;
+
+        if (pbc->fCompressed)
+            ReadTwoSidedTile(pbc, iPos, ausPos);
+        else {
+            if (pbc->p)
+                pc = pbc->p + 40 + 2 * (size_t) iPos * k;
+            else {
+                ReadBearoffFile(pbc, 40 + 2 * (size_t) iPos * k, ac, k * 2);
+                pc = ac;
+            }
+
+            for (i = 0; i < k; ++i)
+                ausPos[i] = pc[2 * i] | (unsigned short) (pc[2 * i + 1] << 8);
+        }
+
+        if (pbc->pCache)
+            CacheAdd(pbc, iPos, ausPos, k);
+    }
+
+    for (i = 0; i < k; ++i) {
         if (aus)
-            aus[i] = us;
+            aus[i] = ausPos[i];
         if (ar)
-            ar[i] = us / 32767.5f - 1.0f;
+            ar[i] = ausPos[i] / 32767.5f - 1.0f;
     }
 }
 
@@ -520,6 +970,8 @@ BearoffStatus(const bearoffcontext * pbc, char *sz)
     case BEAROFF_TWOSIDED:
         sz += sprintf(sz, "   - %s\n", pbc->fCubeful ? _("database includes both cubeful and cubeless equities")
                       : _("cubeless database"));
+        if (pbc->fCompressed)
+            sz += sprintf(sz, "   - %s\n", _("database is stored in compressed blocks"));
         break;
 
     case BEAROFF_ONESIDED:
@@ -536,6 +988,20 @@ BearoffStatus(const bearoffcontext * pbc, char *sz)
     default:
         break;
     }
+
+    if (pbc->pCache) {
+        unsigned int i, cLookup = 0, cHit = 0;
+
+        for (i = 0; i < pbc->cCacheSets; ++i) {
+            cLookup += pbc->pCache[i].cLookup;
+            cHit += pbc->pCache[i].cHit;
+        }
+
+        sprintf(buf, _("cache of %u positions: %u lookups, %u hits (%.1f%%)"),
+                pbc->cCacheSets * BEAROFF_CACHE_WAYS, cLookup, cHit, cLookup ? 100.0f * cHit / cLookup : 0.0f);
+        sz += sprintf(sz, "   - %s\n", buf);
+    }
+
     sprintf(sz, "\n");
 }
 
@@ -736,6 +1202,7 @@ BearoffClose(bearoffcontext * pbc)
     if (pbc->szFilename)
         g_free(pbc->szFilename);
 
+    g_free(pbc->pCache);
     g_free(pbc);
 }
 
@@ -777,6 +1244,32 @@ InvalidDb(bearoffcontext * pbc)
     BearoffClose(pbc);
 }
 
+/* find the index at the end of a compressed two sided database */
+static int
+FindTileIndex(bearoffcontext * pbc)
+{
+    const unsigned int nTiles =
+        (Combination(pbc->nPoints + pbc->nChequers, pbc->nPoints) + BEAROFF_TILE - 1) / BEAROFF_TILE;
+    const size_t nIndex = 8 * ((size_t) nTiles * nTiles + 1);
+    size_t nSize;
+
+    if (pbc->map)
+        nSize = g_mapped_file_get_length(pbc->map);
+    else {
+        long l;
+
+        if (fseek(pbc->pf, 0L, SEEK_END) < 0 || (l = ftell(pbc->pf)) < 0)
+            return -1;
+        nSize = (size_t) l;
+    }
+
+    if (nSize < 40 + nIndex)
+        return -1;
+
+    pbc->iTileIndex = nSize - nIndex;
+    return 0;
+}
+
 /*
  * Initialise bearoff database
  *
@@ -908,6 +1401,7 @@ BearoffInit(const char *szFilename, const unsigned int bo, void (*p) (unsigned i
     case BEAROFF_TWOSIDED:
         /* options for two-sided dbs */
         pbc->fCubeful = atoi(sz + 15);
+        pbc->fCompressed = atoi(sz + 17);
         break;
     case BEAROFF_ONESIDED:
         /* options for one-sided dbs */
@@ -925,6 +1419,12 @@ BearoffInit(const char *szFilename, const unsigned int bo, void (*p) (unsigned i
      * read database into memory if requested 
      */
 
+#if HAVE_PREAD
+    pbc->fSeek = (bo & BO_SEEK) != 0;
+#else
+    pbc->fSeek = TRUE;
+#endif
+
     if (bo & BO_IN_MEMORY) {
         fclose(pbc->pf);
         pbc->pf = NULL;
@@ -936,6 +1436,12 @@ BearoffInit(const char *szFilename, const unsigned int bo, void (*p) (unsigned i
             }
     }
 
+    if (pbc->bt == BEAROFF_TWOSIDED && pbc->fCompressed && FindTileIndex(pbc) < 0) {
+        g_printerr("%s: %s\n", szFilename, _("incomplete bearoff database"));
+        InvalidDb(pbc);
+        return NULL;
+    }
+
     return pbc;
 }
 
@@ -1163,10 +1669,17 @@ ReadBearoffOneSidedExact(const bearoffcontext * pbc, const unsigned int nPosID,
     unsigned short int *pus = NULL;
 
     /* get distribution */
-    if (pbc->fCompressed)
-        pus = GetDistCompressed(aus, pbc, nPosID);
-    else
-        pus = GetDistUncompressed(aus, pbc, nPosID);
+    if (pbc->pCache && CacheLookup(pbc, nPosID, aus, 64))
+        pus = aus;
+    else {
+        if (pbc->fCompressed)
+            pus = GetDistCompressed(aus, pbc, nPosID);
+        else
+            pus = GetDistUncompressed(aus, pbc, nPosID);
+
+        if (pus && pbc->pCache)
+            CacheAdd(pbc, nPosID, pus, 64);
+    }
 
     if (!pus) {
         printf(_("Error decoding one-sided bearoff database entry; position %u\n"), nPosID);
@@ -32,33 +32,51 @@ typedef enum {
     BEAROFF_HYPERGAMMON
 } bearofftype;
 
+typedef struct _bearoffcacheset bearoffcacheset;
+
 typedef struct {
     bearofftype bt;             /* type of bearoff database */
     unsigned int nPoints;       /* number of points covered by database */
     unsigned int nChequers;     /* number of chequers for one-sided database */
     /* one sided dbs */
-    int fCompressed;            /* is database compressed? */
+    int fCompressed;            /* is database compressed? (also two sided dbs) */
     int fGammon;                /* gammon probs included */
     int fND;                    /* normal distibution instead of exact dist? */
     int fHeuristic;             /* heuristic database? */
     /* two sided dbs */
     int fCubeful;               /* cubeful equities included */
+    size_t iTileIndex;          /* offset of the index of a compressed db */
     FILE *pf;                   /* file pointer */
+    int fSeek;                  /* read pf with fseek()/fread() under the global lock */
     char *szFilename;           /* filename */
     GMappedFile *map;
     unsigned char *p;           /* pointer to data in memory */
+    bearoffcacheset *pCache;    /* recently decoded positions, see BearoffCacheResize() */
+    unsigned int cCacheSets;
 } bearoffcontext;
 
+/* compressed two sided dbs are stored in tiles of BEAROFF_TILE x
+ * BEAROFF_TILE positions, none longer than BEAROFF_TILE_MAX_BYTES */
+#define BEAROFF_TILE 8
+#define BEAROFF_TILE_MAX_BYTES (BEAROFF_TILE * BEAROFF_TILE * 4 * 5 + 16)
+
 enum bearoffoptions {
     BO_NONE = 0,
-    BO_IN_MEMORY = 1,
+    BO_IN_MEMORY = 1,           /* share a read-only mapping of the file */
     BO_MUST_BE_ONE_SIDED = 2,
     BO_MUST_BE_TWO_SIDED = 4,
-    BO_HEURISTIC = 8
+    BO_HEURISTIC = 8,
+    BO_SEEK = 16                /* on disk: seek and read under a lock even where pread() exists */
 };
 
 extern bearoffcontext *BearoffInit(const char *szFilename, const unsigned int bo, void (*p) (unsigned int));
 
+extern int BearoffCacheResize(bearoffcontext * pbc, unsigned int cEntries);
+
+extern unsigned int
+BearoffEncodeTile(const unsigned short int aus[], const unsigned int nRows, const unsigned int nCols,
+                  const unsigned int k, unsigned char *pc);
+
 extern int
  BearoffEval(const bearoffcontext * pbc, const TanBoard anBoard, float arOutput[]);
 
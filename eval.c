@@ -202,6 +202,8 @@ f_EvaluatePosition EvaluatePosition = EvaluatePositionNoLocking;
 f_ScoreMove ScoreMove = ScoreMoveNoLocking;
 f_GeneralCubeDecisionE GeneralCubeDecisionE = GeneralCubeDecisionENoLocking;
 f_GeneralEvaluationE GeneralEvaluationE = GeneralEvaluationENoLocking;
+f_FillMovesCache FillMovesCache = FillMovesCacheNoLocking;
+f_FindBestMoves FindBestMoves = FindBestMovesNoLocking;
 
 #define FindnSaveBestMoves FindnSaveBestMovesNoLocking
 #define FindBestMove FindBestMoveNoLocking
@@ -215,6 +217,9 @@ f_GeneralEvaluationE GeneralEvaluationE = GeneralEvaluationENoLocking;
 #define EvaluatePositionCubeful3 EvaluatePositionCubeful3NoLocking
 #define ScoreMoves ScoreMovesNoLocking
 #define ScoreMovesPruned ScoreMovesPrunedNoLocking
+#define ScoreMovesBatch ScoreMovesBatchNoLocking
+#define FillMovesCache FillMovesCacheNoLocking
+#define FindBestMoves FindBestMovesNoLocking
 #define FindBestMoveInEval FindBestMoveInEvalNoLocking
 #define GeneralEvaluationEPliedCubeful GeneralEvaluationEPliedCubefulNoLocking
 #define EvaluatePositionCubeful4 EvaluatePositionCubeful4NoLocking
@@ -246,6 +251,7 @@ bearoffcontext *apbcHyper[3] = { NULL, NULL, NULL };
 evalCache cEval;
 evalCache cpEval;
 unsigned int cCache;
+unsigned int cBearoffCache = 4096;
 int fInterrupt = FALSE;
 int fMatchCancelled = FALSE;
 
@@ -273,6 +279,18 @@ const char *aszVariationCommands[NUM_VARIATIONS] = {
     "3-chequer-hypergammon"
 };
 
+evalprecision epEval = EVAL_PRECISION_FLOAT;
+
+const char *aszEvalPrecision[NUM_EVAL_PRECISIONS] = {
+    "float",
+    "int16"
+};
+
+const char *aszCacheType[NUM_CACHE_TYPES] = {
+    "standard",
+    "clustered"
+};
+
 cubeinfo ciCubeless = { 1, 0, 0, 0, {0, 0}, FALSE, FALSE, FALSE,
 {1.0f, 1.0f, 1.0f, 1.0f}, VARIATION_STANDARD
 };
@@ -575,6 +593,23 @@ weights_failed(char *filename, FILE * weights)
     return 0;
 }
 
+/* The quantized nets written by makeweights -q after the others */
+
+static int
+LoadQuantizedWeights(FILE * pf)
+{
+    float r;
+
+    if (fread(&r, sizeof(r), 1, pf) < 1 || r != WEIGHTS_MAGIC_QUANTIZED)
+        return -1;
+
+    if (NeuralNetLoadQuantized(&nnContact, pf) || NeuralNetLoadQuantized(&nnRace, pf)
+        || NeuralNetLoadQuantized(&nnCrashed, pf))
+        return -1;
+
+    return 0;
+}
+
 extern void
 EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pfProgress) (unsigned int))
 {
@@ -685,6 +720,8 @@ EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pf
             g_free(fn);
         }
 
+        EvalBearoffCacheResize(cBearoffCache);
+
     }
 
     if (szWeightsBinary) {
@@ -699,6 +736,8 @@ EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pf
                                    !NeuralNetLoadBinary(&nnpRace, pfWeights))) {
                 perror(szWeightsBinary);
             }
+            if (fReadWeights)
+                LoadQuantizedWeights(pfWeights);
         }
         if (pfWeights)
             fclose(pfWeights);
@@ -739,6 +778,17 @@ EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pf
         exit(EXIT_FAILURE);
     }
 
+    /* quantized nets not read from the weights file */
+    {
+        neuralnet *const apnn[] = { &nnContact, &nnRace, &nnCrashed };
+        unsigned int j;
+
+        for (j = 0; j < G_N_ELEMENTS(apnn); j++)
+            if (!apnn[j]->asHiddenWeight && NeuralNetQuantize(apnn[j], NULL))
+                outputerrf(_("Quantization of the neural nets failed; "
+                             "`set evaluation precision int16' will be ignored.\n"));
+    }
+
 }
 
 /* Calculates inputs for any contact position, for one player only. */
@@ -2099,6 +2149,25 @@ EvalRaceBG(const TanBoard anBoard, float arOutput[], const bgvariation bgv)
     }
 }
 
+/* Evaluate one of the contact, crashed and race nets, quantized if
+ * selected with `set evaluation precision' */
+
+static inline int
+EvaluateNet(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState)
+{
+#if defined(USE_SIMD_INSTRUCTIONS)
+    if (epEval == EVAL_PRECISION_INT16 && pnn->asHiddenWeight)
+        return NeuralNetEvaluateQuantizedSSE(pnn, arInput, arOutput);
+
+    return NeuralNetEvaluateSSE(pnn, arInput, arOutput, pnState);
+#else
+    if (epEval == EVAL_PRECISION_INT16 && pnn->asHiddenWeight)
+        return NeuralNetEvaluateQuantized(pnn, arInput, arOutput);
+
+    return NeuralNetEvaluate(pnn, arInput, arOutput, pnState);
+#endif
+}
+
 static int
 EvalRace(const TanBoard anBoard, float arOutput[], const bgvariation bgv, NNState * nnStates)
 {
@@ -2106,13 +2175,8 @@ EvalRace(const TanBoard anBoard, float arOutput[], const bgvariation bgv, NNStat
 
     CalculateRaceInputs(anBoard, arInput);
 
-#if defined(USE_SIMD_INSTRUCTIONS)
-    // cppcheck-suppress duplicateExpression
-    if (NeuralNetEvaluateSSE(&nnRace, arInput, arOutput, nnStates ? nnStates + (CLASS_RACE - CLASS_RACE) : NULL))
-#else
     // cppcheck-suppress duplicateExpression
-    if (NeuralNetEvaluate(&nnRace, arInput, arOutput, nnStates ? nnStates + (CLASS_RACE - CLASS_RACE) : NULL))
-#endif
+    if (EvaluateNet(&nnRace, arInput, arOutput, nnStates ? nnStates + (CLASS_RACE - CLASS_RACE) : NULL))
         return -1;
 
     /* special evaluation of backgammons overrides net output */
@@ -2131,12 +2195,7 @@ EvalContact(const TanBoard anBoard, float arOutput[], const bgvariation UNUSED(b
 
     CalculateContactInputs(anBoard, arInput);
 
-#if defined(USE_SIMD_INSTRUCTIONS)
-    return NeuralNetEvaluateSSE(&nnContact, arInput, arOutput,
-                                nnStates ? nnStates + (CLASS_CONTACT - CLASS_RACE) : NULL);
-#else
-    return NeuralNetEvaluate(&nnContact, arInput, arOutput, nnStates ? nnStates + (CLASS_CONTACT - CLASS_RACE) : NULL);
-#endif
+    return EvaluateNet(&nnContact, arInput, arOutput, nnStates ? nnStates + (CLASS_CONTACT - CLASS_RACE) : NULL);
 }
 
 static int
@@ -2146,12 +2205,68 @@ EvalCrashed(const TanBoard anBoard, float arOutput[], const bgvariation UNUSED(b
 
     CalculateCrashedInputs(anBoard, arInput);
 
+    return EvaluateNet(&nnCrashed, arInput, arOutput, nnStates ? nnStates + (CLASS_CRASHED - CLASS_RACE) : NULL);
+}
+
+/* Static evaluation of cPositions positions of the neural net class
+ * pc, sharing one pass over the net weights between them.  Gives the
+ * same result as acef[pc] followed by SanityCheck() on each one. */
+
+extern int
+EvalNetBatch(const positionclass pc, const TanBoard aanBoard[], float aarOutput[][NUM_OUTPUTS],
+             const unsigned int cPositions, const bgvariation bgv)
+{
+    SSE_ALIGN(float aarInput[NN_BATCH_SIZE * NN_INPUT_STRIDE(NUM_INPUTS)]);
+    void (*CalculateInputs) (const TanBoard anBoard, float arInput[]);
+    const neuralnet *pnn;
+    unsigned int i, j;
+
+    switch (pc) {
+    case CLASS_RACE:
+        pnn = &nnRace;
+        CalculateInputs = CalculateRaceInputs;
+        break;
+    case CLASS_CRASHED:
+        pnn = &nnCrashed;
+        CalculateInputs = CalculateCrashedInputs;
+        break;
+    case CLASS_CONTACT:
+        pnn = &nnContact;
+        CalculateInputs = CalculateContactInputs;
+        break;
+    default:
+        g_assert_not_reached();
+        return -1;
+    }
+
+    for (i = 0; i < cPositions; i += NN_BATCH_SIZE) {
+        unsigned int const n = MIN(cPositions - i, NN_BATCH_SIZE);
+
+        for (j = 0; j < n; j++)
+            CalculateInputs(aanBoard[i + j], aarInput + j * NN_INPUT_STRIDE(pnn->cInput));
+
+        if (epEval == EVAL_PRECISION_INT16 && pnn->asHiddenWeight) {
+            for (j = 0; j < n; j++)
+                if (EvaluateNet(pnn, aarInput + j * NN_INPUT_STRIDE(pnn->cInput), aarOutput[i + j], NULL))
+                    return -1;
+        }
 #if defined(USE_SIMD_INSTRUCTIONS)
-    return NeuralNetEvaluateSSE(&nnCrashed, arInput, arOutput,
-                                nnStates ? nnStates + (CLASS_CRASHED - CLASS_RACE) : NULL);
+        else if (NeuralNetEvaluateBatchSSE(pnn, aarInput, aarOutput[i], n))
 #else
-    return NeuralNetEvaluate(&nnCrashed, arInput, arOutput, nnStates ? nnStates + (CLASS_CRASHED - CLASS_RACE) : NULL);
+        else if (NeuralNetEvaluateBatch(pnn, aarInput, aarOutput[i], n))
 #endif
+            return -1;
+
+        for (j = i; j < i + n; j++) {
+            if (pc == CLASS_RACE)
+                /* special evaluation of backgammons overrides net output */
+                EvalRaceBG(aanBoard[j], aarOutput[j], bgv);
+
+            SanityCheck(aanBoard[j], aarOutput[j]);
+        }
+    }
+
+    return 0;
 }
 
 extern int
@@ -3176,16 +3291,95 @@ GetCubeRecommendation(const cubedecision cd)
 }
 
 
+/* A bearoff database is identified by its parameters; the databases
+ * made with the same ones hold the same values */
+
+static void
+BearoffTag(const bearoffcontext * pbc, struct md5_ctx *pctx)
+{
+    guint64 an[10] = { 0 };
+
+    if (pbc) {
+        an[0] = 1;
+        an[1] = pbc->bt;
+        an[2] = pbc->nPoints;
+        an[3] = pbc->nChequers;
+        an[4] = (guint64) pbc->fCompressed;
+        an[5] = (guint64) pbc->fGammon;
+        an[6] = (guint64) pbc->fND;
+        an[7] = (guint64) pbc->fHeuristic;
+        an[8] = (guint64) pbc->fCubeful;
+        an[9] = pbc->iTileIndex;
+    }
+
+    md5_process_bytes(an, sizeof(an), pctx);
+}
+
+/* What the cached evaluations depend on beyond their key: the nets
+ * and how they are evaluated, the bearoff databases and the match
+ * equity table.  Rollout workers must have the same to play trials for
+ * us. */
+
+extern void
+EvalCacheTag(unsigned char auchTag[16])
+{
+    const neuralnet *apnn[] = { &nnContact, &nnRace, &nnCrashed, &nnpContact, &nnpRace, &nnpCrashed };
+    const bearoffcontext *apbc[] = { pbc1, pbc2, pbcOS, pbcTS, apbcHyper[0], apbcHyper[1], apbcHyper[2] };
+    struct md5_ctx ctx;
+    unsigned int i;
+
+    md5_init_ctx(&ctx);
+
+    for (i = 0; i < G_N_ELEMENTS(apnn); i++) {
+        const neuralnet *pnn = apnn[i];
+
+        md5_process_bytes(pnn->arHiddenWeight, pnn->cInput * pnn->cHidden * sizeof(float), &ctx);
+        md5_process_bytes(pnn->arOutputWeight, pnn->cHidden * pnn->cOutput * sizeof(float), &ctx);
+        md5_process_bytes(pnn->arHiddenThreshold, pnn->cHidden * sizeof(float), &ctx);
+        md5_process_bytes(pnn->arOutputThreshold, pnn->cOutput * sizeof(float), &ctx);
+    }
+
+    md5_process_bytes(&epEval, sizeof(epEval), &ctx);
+    for (i = 0; i < G_N_ELEMENTS(apbc); i++)
+        BearoffTag(apbc[i], &ctx);
+    if (miCurrent.szFileName)
+        md5_process_bytes(miCurrent.szFileName, strlen(miCurrent.szFileName), &ctx);
+    md5_process_bytes(&fInvertMET, sizeof(fInvertMET), &ctx);
+
+    md5_finish_ctx(&ctx, auchTag);
+}
+
+/* The settings the cached evaluations depend on have changed */
+
 extern void
 EvalCacheFlush(void)
 {
-    CacheFlush(&cEval);
+    if (cEval.szFile) {
+        /* keep the file, other processes may use it; the entries made
+         * with other settings no longer match */
+        unsigned char auchTag[16];
+
+        EvalCacheTag(auchTag);
+        CacheSetTag(&cEval, auchTag);
+    } else
+        CacheFlush(&cEval);
 }
 
 void
 CommandClearCache(char *UNUSED(sz))
 {
-    EvalCacheFlush();
+    CacheFlush(&cEval);
+}
+
+extern int
+EvalCacheSetFile(const char *szFile, int fShared)
+{
+    unsigned char auchTag[16];
+
+    EvalCacheTag(auchTag);
+    CacheSetTag(&cEval, auchTag);
+
+    return CacheSetFile(&cEval, szFile, fShared);
 }
 
 extern double
@@ -3224,7 +3418,8 @@ GetCacheMB(int size)
     if (size <= 0)
         return 0;
     else
-        return (1 << (size + 15)) * (int) sizeof(cacheNode) / (1024 * 1024);
+        return (1 << (size + 15)) * (int) (cEval.type == CACHE_CLUSTERED ? sizeof(cacheBucket) : sizeof(cacheNode))
+            / (1024 * 1024);
 }
 
 extern int
@@ -3234,6 +3429,56 @@ EvalCacheResize(unsigned int cNew)
     return cCache;
 }
 
+/* Size the caches of decoded positions of the one and two sided bearoff
+ * databases.  Returns the entries of each cache or -1 on failure. */
+extern int
+EvalBearoffCacheResize(unsigned int cNew)
+{
+    bearoffcontext *apbc[] = { pbc1, pbc2, pbcOS, pbcTS };
+    unsigned int i;
+    int n = (int) cNew;
+
+    cBearoffCache = cNew;
+
+    for (i = 0; i < G_N_ELEMENTS(apbc); i++)
+        if (apbc[i] && (n = BearoffCacheResize(apbc[i], cNew)) < 0)
+            return -1;
+
+    return n;
+}
+
+extern int
+EvalCacheSetType(cachetype type)
+{
+    if (type != CACHE_CLUSTERED && cEval.szFile)
+        CacheSetFile(&cEval, NULL, FALSE);
+
+    if (type != cEval.type) {
+        CacheDestroy(&cEval);
+        cEval.type = type;
+        if (CacheCreate(&cEval, cCache) != 0) {
+            cCache = 0;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Give the cache new memory for the threads to flush their parts of
+ * with EvalCacheFlushPart(), see CacheReallocate() */
+extern int
+EvalCacheReallocate(void)
+{
+    return CacheReallocate(&cEval);
+}
+
+extern void
+EvalCacheFlushPart(unsigned int iPart, unsigned int cParts)
+{
+    CacheFlushPart(&cEval, iPart, cParts);
+}
+
 #if CACHE_STATS
 extern int
 EvalCacheStats(unsigned int *pcUsed, unsigned int *pcLookup, unsigned int *pcHit)
@@ -5267,6 +5512,9 @@ DoubleType(const int fDoubled, const int fMove, const int fTurn)
 #define EvaluatePositionCubeful3 EvaluatePositionCubeful3WithLocking
 #define ScoreMoves ScoreMovesWithLocking
 #define ScoreMovesPruned ScoreMovesPrunedWithLocking
+#define ScoreMovesBatch ScoreMovesBatchWithLocking
+#define FillMovesCache FillMovesCacheWithLocking
+#define FindBestMoves FindBestMovesWithLocking
 #define FindBestMoveInEval FindBestMoveInEvalWithLocking
 #define GeneralEvaluationEPliedCubeful GeneralEvaluationEPliedCubefulWithLocking
 #define EvaluatePositionCubeful4 EvaluatePositionCubeful4WithLocking
@@ -5382,7 +5630,7 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
             }
             memcpy(ec.ar, arOutput, sizeof(float) * NUM_OUTPUTS);
             ec.ar[5] = 0.f;
-            CacheAdd(&cpEval, &ec, l);
+            CacheAdd(&cpEval, &ec, l, 0);
         }
         pm->rScore = UtilityME(arOutput, pci);
         if (i < prune_moves) {
@@ -5414,6 +5662,81 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
     PositionFromKey(anBoardOut, &ml.amMoves[ml.iMoveBest].key);
 }
 
+/* Evaluate the position after the best move for one roll, from the opponent's side */
+static int
+EvaluateRollPlied(NNState * nnStates, const TanBoard anBoard, float arOutput[],
+                  cubeinfo * const pci, const evalcontext * pec, unsigned int nPlies,
+                  int n0, int n1, int usePrune)
+{
+    TanBoard anBoardNew;
+    cubeinfo ciOpp;
+    int i;
+
+    for (i = 0; i < 25; i++) {
+        anBoardNew[0][i] = anBoard[0][i];
+        anBoardNew[1][i] = anBoard[1][i];
+    }
+
+    if (MT_SafeGet(&fInterrupt)) {
+        errno = EINTR;
+        return -1;
+    }
+
+    if (usePrune) {
+        FindBestMoveInEval(nnStates, n0, n1, anBoard, anBoardNew, pci, pec);
+    } else {
+
+        FindBestMovePlied(NULL, n0, n1, anBoardNew, pci, pec, 0, defaultFilters);
+    }
+
+    SwapSides(anBoardNew);
+
+    SetCubeInfo(&ciOpp, pci->nCube, pci->fCubeOwner, !pci->fMove,
+                pci->nMatchTo, pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
+
+    /* Evaluate at 0-ply */
+    return EvaluatePositionCache(nnStates, (ConstTanBoard) anBoardNew, arOutput,
+                                 &ciOpp, pec, nPlies - 1, ClassifyPosition((ConstTanBoard) anBoardNew, ciOpp.bgv));
+}
+
+#if defined(LOCKING_VERSION)
+
+typedef struct {
+    NNState *nnStates;
+    ConstTanBoard anBoard;
+    cubeinfo *pci;
+    const evalcontext *pec;
+    unsigned int nPlies;
+    int usePrune;
+    int fFailed;
+    float aarOutput[21][NUM_OUTPUTS];
+} EvaluateRollsData;
+
+static const int aanRoll[21][2] = {
+    {1, 1}, {2, 1}, {2, 2}, {3, 1}, {3, 2}, {3, 3}, {4, 1},
+    {4, 2}, {4, 3}, {4, 4}, {5, 1}, {5, 2}, {5, 3}, {5, 4},
+    {5, 5}, {6, 1}, {6, 2}, {6, 3}, {6, 4}, {6, 5}, {6, 6}
+};
+
+static void
+EvaluateRollTask(void *data, unsigned int iRoll)
+{
+    EvaluateRollsData *perd = (EvaluateRollsData *) data;
+    /* each thread keeps its own incremental evaluation state */
+    NNState *nnStates = perd->nnStates ? MT_Get_nnState() : NULL;
+    SSE_ALIGN(float arOutput[NUM_OUTPUTS]);
+
+    if (MT_SafeGet(&perd->fFailed))
+        return;
+
+    if (EvaluateRollPlied(nnStates, perd->anBoard, arOutput, perd->pci, perd->pec,
+                          perd->nPlies, aanRoll[iRoll][0], aanRoll[iRoll][1], perd->usePrune))
+        MT_SafeSet(&perd->fFailed, TRUE);
+    else
+        memcpy(perd->aarOutput[iRoll], arOutput, sizeof(arOutput));
+}
+#endif
+
 static int
 EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[],
                      cubeinfo * const pci, const evalcontext * pec, unsigned int nPlies, positionclass pc)
@@ -5424,9 +5747,6 @@ EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[
     if (pc > CLASS_PERFECT && nPlies > 0) {
         /* internal node; recurse */
 
-        TanBoard anBoardNew;
-        /* int anMove[ 8 ]; */
-        cubeinfo ciOpp;
         float rTemp;
         int n0, n1;
 
@@ -5435,44 +5755,52 @@ EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[
         for (i = 0; i < NUM_OUTPUTS; i++)
             arOutput[i] = 0.0f;
 
-        /* loop over rolls */
+#if defined(LOCKING_VERSION)
+        if (MT_GetNumThreads() > 1 && nPlies > 1) {
+            /* spread the rolls over the threads, then sum them in the
+             * same order as below so the result does not depend on the
+             * number of threads; the rolls of a 1-ply node are too
+             * quick to be worth it */
+            EvaluateRollsData erd;
+            int iRoll = 0;
+
+            erd.nnStates = nnStates;
+            erd.anBoard = anBoard;
+            erd.pci = pci;
+            erd.pec = pec;
+            erd.nPlies = nPlies;
+            erd.usePrune = usePrune;
+            erd.fFailed = FALSE;
+
+            MT_ParallelFor(21, EvaluateRollTask, &erd);
+
+            if (erd.fFailed)
+                return -1;
 
-        for (n0 = 1; n0 <= 6; n0++) {
-            for (n1 = 1; n1 <= n0; n1++) {
-                float w = (n0 == n1) ? 1.0f : 2.0f;
+            for (n0 = 1; n0 <= 6; n0++)
+                for (n1 = 1; n1 <= n0; n1++, iRoll++) {
+                    float w = (n0 == n1) ? 1.0f : 2.0f;
 
-                for (i = 0; i < 25; i++) {
-                    anBoardNew[0][i] = anBoard[0][i];
-                    anBoardNew[1][i] = anBoard[1][i];
+                    for (i = 0; i < NUM_OUTPUTS; i++)
+                        arOutput[i] += w * erd.aarOutput[iRoll][i];
                 }
+        } else
+#endif
+        {
+            /* loop over rolls */
 
-                if (MT_SafeGet(&fInterrupt)) {
-                    errno = EINTR;
-                    return -1;
-                }
+            for (n0 = 1; n0 <= 6; n0++) {
+                for (n1 = 1; n1 <= n0; n1++) {
+                    float w = (n0 == n1) ? 1.0f : 2.0f;
 
-                if (usePrune) {
-                    FindBestMoveInEval(nnStates, n0, n1, anBoard, anBoardNew, pci, pec);
-                } else {
+                    if (EvaluateRollPlied(nnStates, anBoard, arVariationOutput, pci, pec, nPlies, n0, n1, usePrune))
+                        return -1;
 
-                    FindBestMovePlied(NULL, n0, n1, anBoardNew, pci, pec, 0, defaultFilters);
+                    for (i = 0; i < NUM_OUTPUTS; i++)
+                        arOutput[i] += w * arVariationOutput[i];
                 }
 
-                SwapSides(anBoardNew);
-
-                SetCubeInfo(&ciOpp, pci->nCube, pci->fCubeOwner, !pci->fMove,
-                            pci->nMatchTo, pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
-
-                /* Evaluate at 0-ply */
-                if (EvaluatePositionCache(nnStates, (ConstTanBoard) anBoardNew, arVariationOutput,
-                                          &ciOpp, pec, nPlies - 1,
-                                          ClassifyPosition((ConstTanBoard) anBoardNew, ciOpp.bgv)))
-                    return -1;
-
-                for (i = 0; i < NUM_OUTPUTS; i++)
-                    arOutput[i] += w *arVariationOutput[i];
             }
-
         }
 
         /* normalize */
@@ -5538,7 +5866,7 @@ EvaluatePositionCache(NNState * nnStates, const TanBoard anBoard, float arOutput
 
     memcpy(ec.ar, arOutput, sizeof(float) * NUM_OUTPUTS);
     ec.ar[5] = 0.f;
-    CacheAdd(&cEval, &ec, l);
+    CacheAdd(&cEval, &ec, l, (unsigned int) nPlies);
     return 0;
 }
 
@@ -5591,6 +5919,207 @@ ScoreMove(NNState * nnStates, move * pm, const cubeinfo * pci, const evalcontext
     return 0;
 }
 
+/* Positions of one neural net class waiting to be evaluated as a batch
+ * and stored in the evaluation cache */
+typedef struct {
+    unsigned int n;
+    TanBoard aanBoard[NN_BATCH_SIZE];
+    evalcache aec[NN_BATCH_SIZE];
+    uint32_t al[NN_BATCH_SIZE];
+} movebatch;
+
+static void
+MoveBatchFlush(movebatch * pmb, const positionclass pc, const bgvariation bgv)
+{
+    SSE_ALIGN(float aarOutput[NN_BATCH_SIZE][NUM_OUTPUTS]);
+    unsigned int j;
+
+    if (pmb->n && !EvalNetBatch(pc, (const TanBoard *) pmb->aanBoard, aarOutput, pmb->n, bgv))
+        for (j = 0; j < pmb->n; j++) {
+            memcpy(pmb->aec[j].ar, aarOutput[j], sizeof(float) * NUM_OUTPUTS);
+            pmb->aec[j].ar[5] = 0.f;
+            CacheAdd(&cEval, pmb->aec + j, pmb->al[j], 0);
+        }
+
+    pmb->n = 0;
+}
+
+/* Queue the position after the move with key pkey for a batched
+ * evaluation unless it is already in the cache; pci is the cubeinfo of
+ * the opponent, as in ScoreMove() */
+
+static void
+MoveBatchAdd(movebatch amb[NUM_NN_STATES], const positionkey * pkey, const cubeinfo * pci)
+{
+    TanBoard anBoard;
+    positionclass pc;
+    movebatch *pmb;
+    evalcache ec;
+    uint32_t l;
+    SSE_ALIGN(float arOutput[NUM_OUTPUTS]);
+
+    PositionFromKeySwapped(anBoard, pkey);
+
+    if ((pc = ClassifyPosition((ConstTanBoard) anBoard, pci->bgv)) < CLASS_RACE)
+        return;
+
+    /* same key as the leaf of EvaluatePositionCubeful4() */
+    PositionKey((ConstTanBoard) anBoard, &ec.key);
+    ec.nEvalContext = EvalKey(&ecBasic, 0, pci, FALSE);
+    if ((l = CacheLookup(&cEval, &ec, arOutput, NULL)) == CACHEHIT)
+        return;
+
+    pmb = amb + NN_STATE(pc);
+    memcpy(pmb->aanBoard[pmb->n], anBoard, sizeof(TanBoard));
+    pmb->aec[pmb->n] = ec;
+    pmb->al[pmb->n] = l;
+
+    if (++pmb->n == NN_BATCH_SIZE)
+        MoveBatchFlush(pmb, pc, pci->bgv);
+}
+
+static void
+MoveBatchFlushAll(movebatch amb[NUM_NN_STATES], const bgvariation bgv)
+{
+    positionclass pc;
+
+    for (pc = CLASS_RACE; pc <= CLASS_CONTACT; pc++)
+        MoveBatchFlush(amb + NN_STATE(pc), pc, bgv);
+}
+
+/* Fill the evaluation cache with the 0-ply evaluations of the moves
+ * aiMove[0..cMove-1] of pml (the first cMove moves if aiMove is NULL),
+ * running the neural nets on batches of positions.  The ScoreMove()
+ * calls that follow then find them in the cache. */
+
+static void
+ScoreMovesBatch(const movelist * pml, const unsigned int *aiMove, const unsigned int cMove,
+                const cubeinfo * pci, const evalcontext * pec)
+{
+    movebatch amb[NUM_NN_STATES];
+    unsigned int i;
+    cubeinfo ci;
+
+    if (!cCache || pec->rNoise != 0.0f)
+        return;
+
+    for (i = 0; i < NUM_NN_STATES; i++)
+        amb[i].n = 0;
+
+    /* swap fMove in cubeinfo, as in ScoreMove() */
+    memcpy(&ci, pci, sizeof(ci));
+    ci.fMove = !ci.fMove;
+
+    for (i = 0; i < cMove; i++)
+        MoveBatchAdd(amb, &pml->amMoves[aiMove ? aiMove[i] : i].key, &ci);
+
+    MoveBatchFlushAll(amb, ci.bgv);
+}
+
+/* As ScoreMovesBatch() for all the legal moves of cPositions positions
+ * at once, aanDice[i] rolled in aanBoard[i] by the player apci[i]->fMove.
+ * A FindBestMove() at 0 plies with pec then finds them in the cache;
+ * used by the rollouts to play many games in lockstep. */
+
+extern void
+FillMovesCache(const TanBoard aanBoard[], const unsigned int aanDice[][2], const cubeinfo * const apci[],
+               const unsigned int cPositions, const evalcontext * pec)
+{
+    movebatch amb[NUM_NN_STATES];
+    unsigned int i, j;
+
+    if (!cCache || !cPositions || pec->nPlies || pec->rNoise != 0.0f)
+        return;
+
+    for (i = 0; i < NUM_NN_STATES; i++)
+        amb[i].n = 0;
+
+    for (i = 0; i < cPositions; i++) {
+        movelist ml;
+        cubeinfo ci;
+
+        memcpy(&ci, apci[i], sizeof(ci));
+        ci.fMove = !ci.fMove;
+
+        GenerateMoves(&ml, aanBoard[i], (int) aanDice[i][0], (int) aanDice[i][1], FALSE);
+
+        for (j = 0; j < ml.cMoves; j++)
+            MoveBatchAdd(amb, &ml.amMoves[j].key, &ci);
+    }
+
+    MoveBatchFlushAll(amb, apci[0]->bgv);
+}
+
+/* The moves FindBestMove() at 0 plies with pec finds for each of the
+ * rolls aanDice[0..cRolls-1] in anBoard: aanMove[i] gets the move and
+ * aanBoardOut[i] the position after it.  The candidate moves of all
+ * the rolls are generated first and go through the neural nets as one
+ * batch, which is what the variance reduction of the rollouts needs
+ * every turn. */
+
+extern int
+FindBestMoves(int aanMove[][8], TanBoard aanBoardOut[], const unsigned int aanDice[][2], const unsigned int cRolls,
+              const TanBoard anBoard, const cubeinfo * pci, const evalcontext * pec)
+{
+    NNState *nnStates = MT_Get_nnState();
+    movebatch amb[NUM_NN_STATES];
+    movelist *aml = g_alloca(cRolls * sizeof(movelist));
+    cubeinfo ci;
+    unsigned int i, j;
+    int r = 0;
+
+    for (i = 0; i < NUM_NN_STATES; i++)
+        amb[i].n = 0;
+
+    /* swap fMove in cubeinfo, as in ScoreMove() */
+    memcpy(&ci, pci, sizeof(ci));
+    ci.fMove = !ci.fMove;
+
+    for (i = 0; i < cRolls; i++) {
+        movelist *pml = aml + i;
+
+        GenerateMoves(pml, anBoard, (int) aanDice[i][0], (int) aanDice[i][1], FALSE);
+
+        /* the next GenerateMoves() overwrites them */
+#if GLIB_CHECK_VERSION (2,67,4)
+        pml->amMoves = (move *) g_memdup2(pml->amMoves, pml->cMoves * sizeof(move));
+#else
+        pml->amMoves = (move *) g_memdup(pml->amMoves, pml->cMoves * sizeof(move));
+#endif
+
+        if (cCache && pec->rNoise == 0.0f)
+            for (j = 0; j < pml->cMoves; j++)
+                MoveBatchAdd(amb, &pml->amMoves[j].key, &ci);
+    }
+
+    MoveBatchFlushAll(amb, ci.bgv);
+
+    for (i = 0; i < cRolls; i++) {
+        movelist *pml = aml + i;
+
+        for (j = 0; j < 8; j++)
+            aanMove[i][j] = -1;
+        memcpy(aanBoardOut[i], anBoard, sizeof(TanBoard));
+
+        for (j = 0; j < pml->cMoves && !r; j++)
+            if (ScoreMove(nnStates, pml->amMoves + j, pci, pec, 0) < 0)
+                r = -1;
+
+        if (pml->cMoves && !r) {
+            /* the same choice as FindnSaveBestMoves() */
+            qsort(pml->amMoves, pml->cMoves, sizeof(move), (cfunc) CompareMoves);
+
+            for (j = 0; j < pml->cMaxMoves * 2; j++)
+                aanMove[i][j] = pml->amMoves[0].anMove[j];
+            PositionFromKey(aanBoardOut[i], &pml->amMoves[0].key);
+        }
+
+        g_free(pml->amMoves);
+    }
+
+    return r;
+}
+
 static int
 ScoreMoves(movelist * pml, const cubeinfo * pci, const evalcontext * pec, int nPlies)
 {
@@ -5601,6 +6130,8 @@ ScoreMoves(movelist * pml, const cubeinfo * pci, const evalcontext * pec, int nP
     pml->rBestScore = -99999.9f;
 
     if (nPlies == 0) {
+        ScoreMovesBatch(pml, NULL, pml->cMoves, pci, pec);
+
         /* start incremental evaluations */
         nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_INCREMENTAL;
     }
@@ -5639,6 +6170,8 @@ ScoreMovesPruned(movelist * pml, const cubeinfo * pci, const evalcontext * pec,
 
     pml->rBestScore = -99999.9f;
 
+    ScoreMovesBatch(pml, bmovesi, prune_moves, pci, pec);
+
     /* start incremental evaluations */
     nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_INCREMENTAL;
 
@@ -6337,7 +6870,7 @@ EvaluatePositionCubeful3(NNState * nnStates, const TanBoard anBoard,
                 ec.ar[5] = arCubeful[ici];      /* Cubeful equity stored in slot 5 */
                 ec.nEvalContext = EvalKey(pec, nPlies, &aciCubePos[ici], TRUE);
 
-                CacheAdd(&cEval, &ec, GetHashKey(cEval.hashMask, &ec));
+                CacheAdd(&cEval, &ec, GetHashKey(cEval.hashMask, &ec), (unsigned int) nPlies);
 
             }
         }
@@ -33,6 +33,8 @@
 #define WEIGHTS_VERSION "1.01"
 #define WEIGHTS_VERSION_BINARY 1.01f
 #define WEIGHTS_MAGIC_BINARY 472.3782f
+/* optional quantized nets following the nets in the binary file */
+#define WEIGHTS_MAGIC_QUANTIZED 472.3783f
 
 #define NUM_OUTPUTS 5
 #define NUM_CUBEFUL_OUTPUTS 4
@@ -158,6 +160,18 @@ extern int anChequers[NUM_VARIATIONS];
 extern const char *aszVariations[NUM_VARIATIONS];
 extern const char *aszVariationCommands[NUM_VARIATIONS];
 
+/* arithmetic used by the contact, crashed and race nets */
+
+typedef enum {
+    EVAL_PRECISION_FLOAT,
+    EVAL_PRECISION_INT16,
+    NUM_EVAL_PRECISIONS
+} evalprecision;
+
+extern evalprecision epEval;
+extern const char *aszEvalPrecision[NUM_EVAL_PRECISIONS];
+extern const char *aszCacheType[NUM_CACHE_TYPES];
+
 /*
  * Cubeinfo contains the information necessary for evaluation
  * of a position.
@@ -369,6 +383,12 @@ EXP_LOCK_FUN(int, FindnSaveBestMoves, movelist * pml,
              positionkey * keyMove, const float rThr,
              const cubeinfo * pci, const evalcontext * pec, movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES]);
 
+EXP_LOCK_FUN(void, FillMovesCache, const TanBoard aanBoard[], const unsigned int aanDice[][2],
+             const cubeinfo * const apci[], const unsigned int cPositions, const evalcontext * pec);
+
+EXP_LOCK_FUN(int, FindBestMoves, int aanMove[][8], TanBoard aanBoardOut[], const unsigned int aanDice[][2],
+             const unsigned int cRolls, const TanBoard anBoard, const cubeinfo * pci, const evalcontext * pec);
+
 extern void
  PipCount(const TanBoard anBoard, unsigned int anPips[2]);
 
@@ -394,6 +414,12 @@ extern int
 
 extern void EvalCacheFlush(void);
 extern int EvalCacheResize(unsigned int cNew);
+extern int EvalCacheSetType(cachetype type);
+extern int EvalBearoffCacheResize(unsigned int cNew);
+extern int EvalCacheSetFile(const char *szFile, int fShared);
+extern int EvalCacheReallocate(void);
+extern void EvalCacheFlushPart(unsigned int iPart, unsigned int cParts);
+extern void EvalCacheTag(unsigned char auchTag[16]);
 extern int EvalCacheStats(unsigned int *pcUsed, unsigned int *pcLookup, unsigned int *pcHit);
 extern double GetEvalCacheSize(void);
 void SetEvalCacheSize(unsigned int size);
@@ -403,6 +429,7 @@ extern int GetCacheMB(int size);
 extern evalCache cEval;
 extern evalCache cpEval;
 extern unsigned int cCache;
+extern unsigned int cBearoffCache;
 
 extern int
  GenerateMoves(movelist * pml, const TanBoard anBoard, int n0, int n1, int fPartial);
@@ -443,6 +470,10 @@ extern void
 extern int
  EvalOver(const TanBoard anBoard, float arOutput[], const bgvariation bgv, NNState * nnStates);
 
+extern int
+ EvalNetBatch(const positionclass pc, const TanBoard aanBoard[], float aarOutput[][NUM_OUTPUTS],
+             const unsigned int cPositions, const bgvariation bgv);
+
 extern float
  KleinmanCount(int nPipOnRoll, int nPipNotOnRoll);
 
@@ -547,4 +578,9 @@ extern int EvaluatePerfectCubeful(const TanBoard anBoard, float arEquity[], cons
 extern neuralnet nnContact, nnRace, nnCrashed;
 extern neuralnet nnpContact, nnpRace, nnpCrashed;
 
+/* The NNStates of a thread (MT_Get_nnState()), one for each of the
+ * race, crashed and contact nets */
+#define NUM_NN_STATES 3
+#define NN_STATE(pc) ((pc) - CLASS_RACE)
+
 #endif
@@ -560,6 +560,7 @@ static char szDICE[] = N_("<die> <die>"),
     szSCORE[] = N_("<score> [length]"),
     szSIZE[] = N_("<size>"),
     szSTEP[] = N_("[game|roll|rolled|marked] <count>"),
+    szTRACE[] = N_("<filename> <trial>"),
     szTRIALS[] = N_("<trials>"),
     szVALUE[] = N_("<value>"),
     szMATCHID[] = N_("<matchid>"),
@@ -2633,7 +2634,7 @@ CommandRollout(char *sz)
     void *p = NULL;
 
     if (CountTokens(sz) > 0) {
-        outputerrf("%s", _("The rollout command takes no arguments and only rollouts the current position"));
+        HandleCommand(sz, acRollout);
         return;
     }
     if (ms.gs != GAME_PLAYING) {
@@ -3294,10 +3295,19 @@ SaveEvaluationSettings(FILE * pf)
     SaveEvalSetupSettings(pf, "set evaluation chequerplay", &esEvalChequer);
     SaveEvalSetupSettings(pf, "set evaluation cubedecision", &esEvalCube);
     SaveMoveFilterSettings(pf, "set evaluation movefilter", aamfEval);
+    fprintf(pf, "set evaluation precision %s\n", aszEvalPrecision[epEval]);
+    fprintf(pf, "set cache type %s\n", aszCacheType[cEval.type]);
     fprintf(pf, "set cache %u\n", GetEvalCacheEntries());
+    fprintf(pf, "set cache bearoff %u\n", cBearoffCache);
     fprintf(pf, "set matchequitytable \"%s\"\n", miCurrent.szFileName);
     fprintf(pf, "set invert matchequitytable %s\n", fInvertMET ? "on" : "off");
+    /* after the settings the cached evaluations depend on, so that the
+     * file is not flushed while they are read */
+    if (cEval.szFile)
+        fprintf(pf, "set cache %s \"%s\"\n", cEval.fShared ? "shared" : "file", cEval.szFile);
 #if defined(USE_MULTITHREAD)
+    fprintf(pf, "set threads affinity %s\n", td.fAffinity ? "on" : "off");
+    fprintf(pf, "set threads numa %s\n", td.fNUMA ? "on" : "off");
     fprintf(pf, "set threads %u\n", MT_GetNumThreads());
 #endif
 }
@@ -3364,6 +3374,7 @@ CommandSaveSettings(char *szParam)
 {
     FILE *pf;
     char *szFile;
+    char szTemp[G_ASCII_DTOSTR_BUF_SIZE];
 
     szParam = NextToken(&szParam);
 
@@ -3435,6 +3446,11 @@ CommandSaveSettings(char *szParam)
     SavePlayerSettings(pf);
     SaveRNGSettings(pf, "set", rngCurrent, rngctxCurrent);
     SaveRolloutSettings(pf, "set rollout", &rcRollout);
+    fprintf(pf, "set rollout batch %u\n", nRolloutBatch);
+    fprintf(pf, "set rollout adaptive %s\n", fRolloutAdaptive ? "on" : "off");
+    fprintf(pf, "set rollout cubestop enable %s\n", fRolloutCubeStop ? "on" : "off");
+    fprintf(pf, "set rollout cubestop limit %s\n",
+            g_ascii_formatd(szTemp, G_ASCII_DTOSTR_BUF_SIZE, "%05.4f", rRolloutCubeLimit));
     SaveImportExportSettings(pf);
     SaveSoundSettings(pf);
     RelationalSaveSettings(pf);
@@ -20,9 +20,20 @@
 
 #include "config.h"
 
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define USE_CACHE_MMAP 1
+#endif
+
 #include "cache.h"
 #include "positionid.h"
 
@@ -78,6 +89,182 @@ cache_unlock(evalCache * pc, uint32_t k)
 #endif                          /* USE_MULTITHREAD */
 
 
+/* Seed of the hash kept in the entries of a clustered cache, XORed
+ * with the tag of the cache (see CacheSetTag()) */
+#define CHECK_SEED 0x9747b28c
+
+/* nPlies of a free entry of a clustered cache */
+#define CACHE_EMPTY UCHAR_MAX
+
+/* Buckets of a clustered cache start on a cache line */
+#define BUCKET_ALIGN 64
+
+/* A cache file is this header followed by the buckets, as they are in
+ * memory (so it is only good on machines of the same byte order) */
+typedef struct {
+    char szMagic[8];
+    uint32_t nVersion;
+    uint32_t cBuckets;
+    uint32_t cbBucket;
+    unsigned char unused[BUCKET_ALIGN - 20];
+} cacheFileHeader;
+
+#define CACHE_FILE_MAGIC "GNUbgEC"
+#define CACHE_FILE_VERSION 1
+
+/* Is pcfh the header of a cache file of cb bytes? */
+
+static int
+HeaderValid(const cacheFileHeader * pcfh, size_t cb)
+{
+    return !memcmp(pcfh->szMagic, CACHE_FILE_MAGIC, sizeof(pcfh->szMagic))
+        && pcfh->nVersion == CACHE_FILE_VERSION && pcfh->cbBucket == sizeof(cacheBucket)
+        && (pcfh->cBuckets & (pcfh->cBuckets - 1)) == 0
+        && cb == sizeof(cacheFileHeader) + (size_t) pcfh->cBuckets * sizeof(cacheBucket);
+}
+
+#if USE_CACHE_MMAP
+/* Wait for the lock on all of the file fd; closing fd releases it */
+
+static int
+LockFile(int fd)
+{
+    struct flock fl;
+
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+
+    while (fcntl(fd, F_SETLKW, &fl) < 0)
+        if (errno != EINTR)
+            return -1;
+
+    return 0;
+}
+#endif
+
+/* Map (or read) the cache file or shared memory object of pc.  One that
+ * is already a cache keeps its size and entries, as other processes may
+ * have it mapped; the entries made with another tag never match.
+ * Anything else is made a cache of the size of pc.  Processes starting
+ * at the same time take turns, under a lock on the file, so that only
+ * the first makes it a cache and the others find it made. */
+
+static int
+CacheOpenFile(evalCache * pc)
+{
+    cacheFileHeader *pcfh;
+    int fValid = 0;
+#if USE_CACHE_MMAP
+    struct stat st;
+    int fd;
+
+#if defined(HAVE_SHM_OPEN)
+    if (pc->fShared)
+        fd = shm_open(pc->szFile, O_RDWR | O_CREAT, 0600);
+    else
+#else
+    if (pc->fShared)
+        return -1;
+#endif
+        fd = open(pc->szFile, O_RDWR | O_CREAT, 0666);
+
+    if (fd < 0)
+        return -1;
+
+    if (LockFile(fd) < 0 || fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    if ((size_t) st.st_size >= sizeof(cacheFileHeader)) {
+        void *pv = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (pv != MAP_FAILED) {
+            if (HeaderValid((cacheFileHeader *) pv, (size_t) st.st_size)) {
+                pc->pvBuckets = pv;
+                pc->cbFile = (size_t) st.st_size;
+                fValid = 1;
+            } else
+                munmap(pv, (size_t) st.st_size);
+        }
+    }
+
+    if (!fValid) {
+        pc->cbFile = sizeof(cacheFileHeader) + (pc->size / 2) * sizeof(cacheBucket);
+
+        if (ftruncate(fd, (off_t) pc->cbFile) < 0) {
+            close(fd);
+            return -1;
+        }
+
+        pc->pvBuckets = mmap(NULL, pc->cbFile, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (pc->pvBuckets == MAP_FAILED) {
+            pc->pvBuckets = NULL;
+            close(fd);
+            return -1;
+        }
+    }
+#else
+    cacheFileHeader cfh;
+    FILE *pf;
+
+    if (pc->fShared)
+        return -1;
+
+    /* read it all now and write it back in CacheDestroy() */
+    if ((pf = fopen(pc->szFile, "rb")) != NULL) {
+        if (fread(&cfh, sizeof(cfh), 1, pf) == 1 && !fseek(pf, 0, SEEK_END)) {
+            long cb = ftell(pf);
+
+            if (cb > 0 && HeaderValid(&cfh, (size_t) cb) && (pc->pvBuckets = malloc((size_t) cb)) != NULL) {
+                pc->cbFile = (size_t) cb;
+                rewind(pf);
+                fValid = fread(pc->pvBuckets, 1, pc->cbFile, pf) == pc->cbFile;
+            }
+        }
+        fclose(pf);
+    }
+
+    if (!fValid) {
+        free(pc->pvBuckets);
+        pc->cbFile = sizeof(cacheFileHeader) + (pc->size / 2) * sizeof(cacheBucket);
+        if ((pc->pvBuckets = malloc(pc->cbFile)) == NULL)
+            return -1;
+    }
+
+    /* make sure it can be written back */
+    if ((pf = fopen(pc->szFile, "ab")) == NULL) {
+        free(pc->pvBuckets);
+        pc->pvBuckets = NULL;
+        return -1;
+    }
+    fclose(pf);
+#endif
+
+    pcfh = (cacheFileHeader *) pc->pvBuckets;
+    pc->buckets = (cacheBucket *) (pcfh + 1);
+
+    if (fValid) {
+        pc->size = 2 * pcfh->cBuckets;
+        pc->hashMask = pcfh->cBuckets - 1;
+    } else {
+        CacheFlush(pc);
+        memset(pcfh, 0, sizeof(*pcfh));
+        memcpy(pcfh->szMagic, CACHE_FILE_MAGIC, sizeof(pcfh->szMagic));
+        pcfh->nVersion = CACHE_FILE_VERSION;
+        pcfh->cBuckets = pc->size / 2;
+        pcfh->cbBucket = sizeof(cacheBucket);
+    }
+
+#if USE_CACHE_MMAP
+    /* the others may look at it now */
+    close(fd);
+#endif
+
+    return 0;
+}
+
 int
 CacheCreate(evalCache * pc, unsigned int s)
 {
@@ -98,9 +285,26 @@ CacheCreate(evalCache * pc, unsigned int s)
     pc->size = (s < pc->size) ? 2 * s : s;
     pc->hashMask = (pc->size >> 1) - 1;
 
-    pc->entries = (cacheNode *) malloc((pc->size / 2) * sizeof(*pc->entries));
-    if (pc->entries == NULL)
-        return -1;
+    pc->entries = NULL;
+    pc->buckets = NULL;
+    pc->pvBuckets = NULL;
+
+    if (pc->szFile)
+        return CacheOpenFile(pc);
+
+    if (pc->type == CACHE_CLUSTERED) {
+        /* as many buckets as a standard cache has nodes, in half the
+         * memory */
+        pc->pvBuckets = malloc((pc->size / 2) * sizeof(*pc->buckets) + BUCKET_ALIGN - 1);
+        if (pc->pvBuckets == NULL)
+            return -1;
+
+        pc->buckets = (cacheBucket *) (((size_t) pc->pvBuckets + BUCKET_ALIGN - 1) & ~(size_t) (BUCKET_ALIGN - 1));
+    } else {
+        pc->entries = (cacheNode *) malloc((pc->size / 2) * sizeof(*pc->entries));
+        if (pc->entries == NULL)
+            return -1;
+    }
 
     CacheFlush(pc);
     return 0;
@@ -108,10 +312,10 @@ CacheCreate(evalCache * pc, unsigned int s)
 
 /* MurmurHash3  https://code.google.com/p/smhasher/wiki/MurmurHash */
 
-extern uint32_t
-GetHashKey(uint32_t hashMask, const cacheNodeDetail * restrict e)
+static inline uint32_t
+MurmurHash(uint32_t seed, const cacheNodeDetail * restrict e)
 {
-    uint32_t hash = (uint32_t) e->nEvalContext;
+    uint32_t hash = (uint32_t) e->nEvalContext ^ seed;
     int i;
 
     hash *= 0xcc9e2d51;
@@ -142,14 +346,142 @@ GetHashKey(uint32_t hashMask, const cacheNodeDetail * restrict e)
     hash *= 0xc2b2ae35;
     hash ^= hash >> 16;
 
-    return (hash & hashMask);
+    return hash;
+}
+
+extern uint32_t
+GetHashKey(uint32_t hashMask, const cacheNodeDetail * restrict e)
+{
+    return (MurmurHash(0, e) & hashMask);
+}
+
+/* The fields of a clustered cache entry that nCheck covers, folded
+ * into 32 bits */
+
+static inline uint32_t
+EntryChecksum(const cacheEntry * pce)
+{
+    uint32_t n;
+
+    memcpy(&n, &pce->rCubeful, sizeof(n));
+
+    return n ^ (pce->anOutput[0] | ((uint32_t) pce->anOutput[1] << 16))
+        ^ (pce->anOutput[2] | ((uint32_t) pce->anOutput[3] << 16))
+        ^ (pce->anOutput[4] | ((uint32_t) pce->nPlies << 16));
+}
+
+static uint32_t
+CacheLookupClustered(evalCache * restrict pc, const cacheNodeDetail * restrict e, float *restrict arOut,
+                     float *restrict arCubeful)
+{
+    uint32_t const l = GetHashKey(pc->hashMask, e);
+    uint32_t const nKey = MurmurHash(CHECK_SEED ^ pc->nTagSeed, e);
+    const volatile cacheEntry *pce = pc->buckets[l].ae;
+    int i;
+
+#if CACHE_STATS
+#if defined(USE_MULTITHREAD)
+    MT_SafeInc(&pc->cLookup);
+#else
+    ++pc->cLookup;
+#endif
+#endif
+
+    for (i = 0; i < CACHE_BUCKET_ENTRIES; i++) {
+        /* read the entry once and check that copy; another thread may
+         * be writing it */
+        cacheEntry const ce = pce[i];
+        int j;
+
+        if ((ce.nCheck ^ EntryChecksum(&ce)) != nKey || ce.nPlies == CACHE_EMPTY)
+            continue;
+
+        /* Cache hit */
+        for (j = 0; j < 5 /*NUM_OUTPUTS */ ; j++)
+            arOut[j] = ce.anOutput[j] * (1.0f / 65535.0f);
+        if (arCubeful)
+            *arCubeful = ce.rCubeful;
+
+#if CACHE_STATS
+#if defined(USE_MULTITHREAD)
+        MT_SafeInc(&pc->cHit);
+#else
+        ++pc->cHit;
+#endif
+#endif
+
+        return CACHEHIT;
+    }
+
+    return l;
 }
 
+/* Evaluations at more plies cost more to redo, so each ply keeps an
+ * entry of a clustered cache for 8 more additions to its bucket.
+ * Entries are only written here, never on a lookup. */
+
+void
+CacheAddClustered(evalCache * restrict pc, const cacheNodeDetail * restrict e, uint32_t l, unsigned int nPlies)
+{
+    cacheEntry *pce = pc->buckets[l].ae;
+    uint32_t const nKey = MurmurHash(CHECK_SEED ^ pc->nTagSeed, e);
+    cacheEntry ce;
+    int i, iVictim = 0, nWorst = INT_MAX;
+
+    for (i = 0; i < CACHE_BUCKET_ENTRIES; i++) {
+        int n;
+
+        if (pce[i].nPlies == CACHE_EMPTY || (pce[i].nCheck ^ EntryChecksum(pce + i)) == nKey) {
+            iVictim = i;
+            break;
+        }
+
+        n = 8 * pce[i].nPlies - pce[i].nAge;
+        if (n < nWorst) {
+            nWorst = n;
+            iVictim = i;
+        }
+    }
+
+    for (i = 0; i < CACHE_BUCKET_ENTRIES; i++)
+        if (i != iVictim && pce[i].nAge < UCHAR_MAX)
+            pce[i].nAge++;
+
+    for (i = 0; i < 5 /*NUM_OUTPUTS */ ; i++) {
+        float r = e->ar[i];
+
+        if (r < 0.0f)
+            r = 0.0f;
+        else if (r > 1.0f)
+            r = 1.0f;
+        ce.anOutput[i] = (unsigned short) (r * 65535.0f + 0.5f);
+    }
+    ce.rCubeful = e->ar[5];
+    /* CACHE_EMPTY is not a ply count */
+    ce.nPlies = (unsigned char) (nPlies < CACHE_EMPTY ? nPlies : CACHE_EMPTY - 1);
+    ce.nAge = 0;
+    ce.nCheck = nKey ^ EntryChecksum(&ce);
+
+    pce[iVictim] = ce;
+
+#if CACHE_STATS
+#if defined(USE_MULTITHREAD)
+    MT_SafeInc(&pc->nAdds);
+#else
+    ++pc->nAdds;
+#endif
+#endif
+}
 
 uint32_t
 CacheLookupWithLocking(evalCache * restrict pc, const cacheNodeDetail * restrict e, float * restrict arOut, float * restrict arCubeful)
 {
-    uint32_t const l = GetHashKey(pc->hashMask, e);
+    uint32_t l;
+
+    if (pc->type == CACHE_CLUSTERED)
+        return CacheLookupClustered(pc, e, arOut, arCubeful);
+
+    l = GetHashKey(pc->hashMask, e);
 
 #if CACHE_STATS
 #if defined(USE_MULTITHREAD)
@@ -199,7 +531,12 @@ CacheLookupWithLocking(evalCache * restrict pc, const cacheNodeDetail * restrict
 uint32_t
 CacheLookupNoLocking(evalCache * restrict pc, const cacheNodeDetail * restrict e, float *restrict arOut, float * restrict arCubeful)
 {
-    uint32_t const l = GetHashKey(pc->hashMask, e);
+    uint32_t l;
+
+    if (pc->type == CACHE_CLUSTERED)
+        return CacheLookupClustered(pc, e, arOut, arCubeful);
+
+    l = GetHashKey(pc->hashMask, e);
 
 #if CACHE_STATS
     ++pc->cLookup;
@@ -228,8 +565,13 @@ CacheLookupNoLocking(evalCache * restrict pc, const cacheNodeDetail * restrict e
 }
 
 void
-CacheAddWithLocking(evalCache * restrict pc, const cacheNodeDetail * restrict e, uint32_t l)
+CacheAddWithLocking(evalCache * restrict pc, const cacheNodeDetail * restrict e, uint32_t l, unsigned int nPlies)
 {
+    if (pc->type == CACHE_CLUSTERED) {
+        CacheAddClustered(pc, e, l, nPlies);
+        return;
+    }
+
 #if defined(USE_MULTITHREAD)
     cache_lock(pc, l);
 #endif
@@ -256,13 +598,106 @@ void
 CacheDestroy(const evalCache * pc)
 {
     free(pc->entries);
+
+    if (pc->szFile && pc->pvBuckets) {
+#if USE_CACHE_MMAP
+        munmap(pc->pvBuckets, pc->cbFile);
+#else
+        FILE *pf;
+
+        if ((pf = fopen(pc->szFile, "wb")) != NULL) {
+            fwrite(pc->pvBuckets, 1, pc->cbFile, pf);
+            fclose(pf);
+        }
+        free(pc->pvBuckets);
+#endif
+    } else
+        free(pc->pvBuckets);
+}
+
+/* Keep the clustered cache pc in the file szFile from now on, or in
+ * the POSIX shared memory object of that name if fShared, or in memory
+ * again if szFile is NULL.  An existing cache file keeps its size and
+ * its entries (see CacheOpenFile()).  With mmap()
+ * the file is the cache, so it is up to date even if gnubg does not
+ * exit cleanly, and several processes can share it, reading and writing
+ * the entries without locks as threads do; otherwise it is read here
+ * and written back by CacheDestroy().  If the file cannot be used the
+ * cache stays in memory and -1 is returned. */
+
+int
+CacheSetFile(evalCache * pc, const char *szFile, int fShared)
+{
+    unsigned int const size = pc->size;
+
+    CacheDestroy(pc);
+    free(pc->szFile);
+    pc->szFile = NULL;
+
+    if (szFile) {
+        pc->type = CACHE_CLUSTERED;
+        pc->fShared = fShared;
+        pc->szFile = malloc(strlen(szFile) + 1);
+        if (pc->szFile) {
+            strcpy(pc->szFile, szFile);
+            if (CacheCreate(pc, size) == 0)
+                return 0;
+
+            free(pc->szFile);
+            pc->szFile = NULL;
+        }
+        CacheCreate(pc, size);
+        return -1;
+    }
+
+    return CacheCreate(pc, size);
+}
+
+/* The tag of a cache identifies what its entries were computed with
+ * (eval.c uses the weights, bearoff databases and match equity table).
+ * It is folded into the hash an entry of a clustered cache is checked
+ * with, so an entry only matches a lookup made with the same tag.  The
+ * processes sharing a cache file can then have different tags, and
+ * none of them needs to flush the file when its tag changes. */
+
+void
+CacheSetTag(evalCache * pc, const unsigned char auchTag[16])
+{
+    uint32_t an[4];
+
+    memcpy(pc->auchTag, auchTag, sizeof(pc->auchTag));
+    memcpy(an, auchTag, sizeof(an));
+    pc->nTagSeed = an[0] ^ an[1] ^ an[2] ^ an[3];
 }
 
 void
 CacheFlush(const evalCache * pc)
 {
+    CacheFlushPart(pc, 0, 1);
+}
+
+/* Flush part iPart of cParts equal parts of the cache */
+
+void
+CacheFlushPart(const evalCache * pc, unsigned int iPart, unsigned int cParts)
+{
+    unsigned int const c = pc->size / 2;
+    unsigned int const kFirst = (unsigned int) ((uint64_t) c * iPart / cParts);
+    unsigned int const kLast = (unsigned int) ((uint64_t) c * (iPart + 1) / cParts);
     unsigned int k;
-    for (k = 0; k < pc->size / 2; ++k) {
+
+    if (pc->type == CACHE_CLUSTERED) {
+        memset(pc->buckets + kFirst, 0, (kLast - kFirst) * sizeof(*pc->buckets));
+        for (k = kFirst; k < kLast; ++k) {
+            int i;
+
+            for (i = 0; i < CACHE_BUCKET_ENTRIES; i++)
+                pc->buckets[k].ae[i].nPlies = CACHE_EMPTY;
+        }
+        return;
+    }
+
+    for (k = kFirst; k < kLast; ++k) {
         pc->entries[k].nd_primary.key.data[0] = (unsigned int) -1;
         pc->entries[k].nd_secondary.key.data[0] = (unsigned int) -1;
 #if defined(USE_MULTITHREAD)
@@ -271,6 +706,37 @@ CacheFlush(const evalCache * pc)
     }
 }
 
+/* Give a cache kept in memory new memory of the same size, which is left
+ * for the caller to flush with CacheFlushPart().  The operating system
+ * places each page when it is first written, so a thread flushing the
+ * part of the cache it will use gets it in memory close to its processor
+ * on NUMA systems.  Returns -1 for a cache in a file or if the memory
+ * cannot be had, leaving the cache as it was. */
+
+int
+CacheReallocate(evalCache * pc)
+{
+    void *pv;
+
+    if (pc->szFile)
+        return -1;
+
+    if (pc->type == CACHE_CLUSTERED) {
+        if ((pv = malloc((pc->size / 2) * sizeof(*pc->buckets) + BUCKET_ALIGN - 1)) == NULL)
+            return -1;
+        free(pc->pvBuckets);
+        pc->pvBuckets = pv;
+        pc->buckets = (cacheBucket *) (((size_t) pc->pvBuckets + BUCKET_ALIGN - 1) & ~(size_t) (BUCKET_ALIGN - 1));
+    } else {
+        if ((pv = malloc((pc->size / 2) * sizeof(*pc->entries))) == NULL)
+            return -1;
+        free(pc->entries);
+        pc->entries = (cacheNode *) pv;
+    }
+
+    return 0;
+}
+
 int
 CacheResize(evalCache * pc, unsigned int cNew)
 {
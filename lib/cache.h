@@ -21,6 +21,8 @@
 
 #include "config.h"
 
+#include <stddef.h>
+
 #ifdef HAVE_STDINT_H
 #include <stdint.h>
 #else
@@ -29,8 +31,10 @@ typedef unsigned int uint32_t;
 
 #include "gnubg-types.h"
 
-/* Set to calculate simple cache stats */
+/* Set to calculate simple cache stats, e.g. with CPPFLAGS=-DCACHE_STATS=1 */
+#if !defined(CACHE_STATS)
 #define CACHE_STATS 0
+#endif
 
 typedef struct {
     positionkey key;	/* size = 28 */
@@ -49,11 +53,51 @@ typedef struct {
 /* name used in eval.c */
 typedef cacheNodeDetail evalcache;
 
+typedef enum {
+    CACHE_STANDARD,             /* two cacheNodeDetail per node, locked */
+    CACHE_CLUSTERED,            /* cacheBucket, lockless */
+    NUM_CACHE_TYPES
+} cachetype;
+
+/* Entry of a clustered cache.  The position and context are only kept
+ * as a 32 bit hash (a different one from the hash giving the bucket,
+ * and seeded with the tag of the cache), XORed with the other fields
+ * so that an entry torn by two threads writing it at once no longer
+ * matches.  The outputs are stored in 16 bits, to within 1/131070.
+ * nPlies is the ply count the caller passed to CacheAdd, nAge counts
+ * the entries added to the bucket since; neither nAge nor the padding
+ * is covered by nCheck. */
+typedef struct {
+    uint32_t nCheck;
+    float rCubeful;
+    unsigned short anOutput[5];
+    unsigned char nPlies;
+    unsigned char nAge;
+} cacheEntry;
+
+#define CACHE_BUCKET_ENTRIES 3
+
+/* Fills one 64 byte cache line */
+typedef struct {
+    cacheEntry ae[CACHE_BUCKET_ENTRIES];
+    uint32_t unused;
+} cacheBucket;
+
 typedef struct {
+    cachetype type;             /* set before CacheCreate() */
     cacheNode *entries;
+    cacheBucket *buckets;
+    void *pvBuckets;            /* as allocated, buckets is aligned */
+
+    /* Clustered caches can be kept in a file, see CacheSetFile() */
+    char *szFile;
+    int fShared;                /* szFile is a shared memory object */
+    size_t cbFile;
+    unsigned char auchTag[16];
+    uint32_t nTagSeed;          /* auchTag folded into 32 bits */
 
     unsigned int size;
-    uint32_t hashMask;
+    uint32_t hashMask;          /* entries or buckets, passed to CacheAdd */
 
 #if CACHE_STATS
     unsigned int nAdds;
@@ -68,15 +112,21 @@ int CacheResize(evalCache * pc, unsigned int cNew);
 
 #define CACHEHIT ((uint32_t)-1)
 
-/* returns a value which is passed to CacheAdd (if a miss) */
+/* returns a value which is passed to CacheAdd (if a miss), with the
+ * number of plies the evaluation was made at */
 unsigned int CacheLookupWithLocking(evalCache * pc, const cacheNodeDetail * e, float *arOut, float *arCubeful);
 unsigned int CacheLookupNoLocking(evalCache * pc, const cacheNodeDetail * e, float *arOut, float *arCubeful);
 
-void CacheAddWithLocking(evalCache * pc, const cacheNodeDetail * e, uint32_t l);
+void CacheAddWithLocking(evalCache * pc, const cacheNodeDetail * e, uint32_t l, unsigned int nPlies);
+void CacheAddClustered(evalCache * pc, const cacheNodeDetail * e, uint32_t l, unsigned int nPlies);
 
 static inline void
-CacheAddNoLocking(evalCache * pc, const cacheNodeDetail * e, const uint32_t l)
+CacheAddNoLocking(evalCache * pc, const cacheNodeDetail * e, const uint32_t l, const unsigned int nPlies)
 {
+    if (pc->type == CACHE_CLUSTERED) {
+        CacheAddClustered(pc, e, l, nPlies);
+        return;
+    }
     pc->entries[l].nd_secondary = pc->entries[l].nd_primary;
     pc->entries[l].nd_primary = *e;
 #if CACHE_STATS
@@ -85,7 +135,11 @@ CacheAddNoLocking(evalCache * pc, const cacheNodeDetail * e, const uint32_t l)
 }
 
 void CacheFlush(const evalCache * pc);
+void CacheFlushPart(const evalCache * pc, unsigned int iPart, unsigned int cParts);
+int CacheReallocate(evalCache * pc);
 void CacheDestroy(const evalCache * pc);
+int CacheSetFile(evalCache * pc, const char *szFile, int fShared);
+void CacheSetTag(evalCache * pc, const unsigned char auchTag[16]);
 
 #if CACHE_STATS
 void CacheStats(const evalCache * pc, unsigned int *pcLookup, unsigned int *pcHit, unsigned int *pcUsed);
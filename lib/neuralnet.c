@@ -25,6 +25,7 @@
 #include <string.h>
 #include <time.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "neuralnet.h"
 #include "simd.h"
@@ -40,6 +41,8 @@ NeuralNetCreate(neuralnet * pnn, unsigned int cInput, unsigned int cHidden,
     pnn->rBetaHidden = rBetaHidden;
     pnn->rBetaOutput = rBetaOutput;
     pnn->nTrained = 0;
+    pnn->asHiddenWeight = NULL;
+    pnn->arHiddenScale = NULL;
 
     if ((pnn->arHiddenWeight = sse_malloc(cHidden * cInput * sizeof(float))) == NULL)
         return -1;
@@ -76,6 +79,83 @@ NeuralNetDestroy(neuralnet * pnn)
     pnn->arHiddenThreshold = 0;
     sse_free(pnn->arOutputThreshold);
     pnn->arOutputThreshold = 0;
+    sse_free((float *) pnn->asHiddenWeight);
+    pnn->asHiddenWeight = 0;
+    sse_free(pnn->arHiddenScale);
+    pnn->arHiddenScale = 0;
+}
+
+/* The quantized hidden weights are stored in the same order as
+ * arHiddenWeight, asHiddenWeight[ i * cHidden + j ] being the weight
+ * from input i to hidden node j */
+
+#define QUANT_WEIGHTS(pnn) ((pnn)->cInput * (pnn)->cHidden)
+
+static int
+QuantizedCreate(neuralnet * pnn)
+{
+    sse_free((float *) pnn->asHiddenWeight);
+    sse_free(pnn->arHiddenScale);
+
+    pnn->asHiddenWeight = (short *) sse_malloc(QUANT_WEIGHTS(pnn) * sizeof(short));
+    pnn->arHiddenScale = sse_malloc(pnn->cHidden * sizeof(float));
+
+    if (!pnn->asHiddenWeight || !pnn->arHiddenScale) {
+        sse_free((float *) pnn->asHiddenWeight);
+        pnn->asHiddenWeight = NULL;
+        sse_free(pnn->arHiddenScale);
+        pnn->arHiddenScale = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Calibrate and build the quantized copy of the hidden layer.  Each
+ * hidden node gets its own scale, so that its largest weight becomes
+ * NN_QUANT_WEIGHT_MAX.  If prError is given it is set to the largest
+ * error the rounding of the weights can make in the activity of a
+ * hidden node with all inputs at 1. */
+
+extern int
+NeuralNetQuantize(neuralnet * pnn, float *prError)
+{
+    const unsigned int cHidden = pnn->cHidden;
+    float rError = 0.0f;
+    unsigned int i, j;
+
+    if (QuantizedCreate(pnn))
+        return -1;
+
+    for (j = 0; j < cHidden; j++) {
+        float rMax = 0.0f;
+        float rScale;
+        float rNodeError = 0.0f;
+
+        for (i = 0; i < pnn->cInput; i++)
+            rMax = MAX(rMax, fabsf(pnn->arHiddenWeight[i * cHidden + j]));
+
+        if (rMax == 0.0f)
+            rMax = 1.0f;
+        rScale = NN_QUANT_WEIGHT_MAX / rMax;
+
+        for (i = 0; i < pnn->cInput; i++) {
+            float const r = pnn->arHiddenWeight[i * cHidden + j] * rScale;
+            short const s = (short) lrintf(r);
+
+            pnn->asHiddenWeight[i * cHidden + j] = s;
+            rNodeError += fabsf(r - s) / rScale;
+        }
+
+        rError = MAX(rError, rNodeError);
+
+        pnn->arHiddenScale[j] = rMax / NN_QUANT_WEIGHT_MAX;
+    }
+
+    if (prError)
+        *prError = rError;
+
+    return 0;
 }
 
 #if !defined(USE_SIMD_INSTRUCTIONS)
@@ -257,6 +337,132 @@ NeuralNetEvaluate(const neuralnet * pnn, float arInput[], float arOutput[], NNSt
     }
     return 0;
 }
+
+/* Batched evaluation, see NeuralNetEvaluateBatchSSE() in neuralnetsse.c */
+
+static void
+EvaluateBatch(const neuralnet * pnn, const float aarInput[], float aar[], float aarOutput[], unsigned int cBatch)
+{
+    const unsigned int cHidden = pnn->cHidden;
+    const unsigned int cInput = pnn->cInput;
+    const unsigned int cStride = NN_INPUT_STRIDE(cInput);
+    const float *prRow;
+    unsigned int i, j, k;
+
+    /* Calculate activity at hidden nodes */
+    for (k = 0; k < cBatch; k++)
+        memcpy(aar + k * cHidden, pnn->arHiddenThreshold, cHidden * sizeof(float));
+
+    for (i = 0, prRow = pnn->arHiddenWeight; i < cInput; i++, prRow += cHidden)
+        for (k = 0; k < cBatch; k++) {
+            float const ari = aarInput[k * cStride + i];
+
+            if (ari == 0.0f)
+                continue;
+            else {
+                const float *prWeight = prRow;
+                float *pr = aar + k * cHidden;
+
+                if (ari == 1.0f)
+                    for (j = cHidden; j; j--)
+                        *pr++ += *prWeight++;
+                else
+                    for (j = cHidden; j; j--)
+                        *pr++ += *prWeight++ * ari;
+            }
+        }
+
+    for (k = 0; k < cBatch; k++) {
+        float *ar = aar + k * cHidden;
+        float *arOutput = aarOutput + k * pnn->cOutput;
+        const float *prWeight;
+
+        for (i = 0; i < cHidden; i++)
+            ar[i] = sigmoid(-pnn->rBetaHidden * ar[i]);
+
+        /* Calculate activity at output nodes */
+        prWeight = pnn->arOutputWeight;
+
+        for (i = 0; i < pnn->cOutput; i++) {
+            float r = pnn->arOutputThreshold[i];
+
+            for (j = 0; j < cHidden; j++)
+                r += ar[j] * *prWeight++;
+
+            arOutput[i] = sigmoid(-pnn->rBetaOutput * r);
+        }
+    }
+}
+
+extern int
+NeuralNetEvaluateBatch(const neuralnet * pnn, const float aarInput[], float aarOutput[], unsigned int cBatch)
+{
+    float *aar = (float *) g_alloca(NN_BATCH_SIZE * pnn->cHidden * sizeof(float));
+
+    while (cBatch) {
+        unsigned int const n = MIN(cBatch, NN_BATCH_SIZE);
+
+        EvaluateBatch(pnn, aarInput, aar, aarOutput, n);
+
+        aarInput += n * NN_INPUT_STRIDE(pnn->cInput);
+        aarOutput += n * pnn->cOutput;
+        cBatch -= n;
+    }
+
+    return 0;
+}
+
+/* Quantized evaluation, see NeuralNetQuantize() */
+
+extern int
+NeuralNetEvaluateQuantized(const neuralnet * pnn, const float arInput[], float arOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    float *ar = (float *) g_alloca(cHidden * sizeof(float));
+    const float *prWeight;
+    const short *psWeight;
+    unsigned int i, j;
+
+    /* Calculate activity at hidden nodes, in units of the scale of
+     * each node */
+    memset(ar, 0, cHidden * sizeof(float));
+
+    psWeight = pnn->asHiddenWeight;
+
+    for (i = 0; i < pnn->cInput; i++) {
+        float const ari = arInput[i];
+
+        if (ari == 0.0f)
+            psWeight += cHidden;
+        else {
+            float *pr = ar;
+
+            if (ari == 1.0f)
+                for (j = cHidden; j; j--)
+                    *pr++ += *psWeight++;
+            else
+                for (j = cHidden; j; j--)
+                    *pr++ += *psWeight++ * ari;
+        }
+    }
+
+    for (i = 0; i < cHidden; i++)
+        ar[i] = sigmoid(-pnn->rBetaHidden * (ar[i] * pnn->arHiddenScale[i] + pnn->arHiddenThreshold[i]));
+
+    /* Calculate activity at output nodes */
+    prWeight = pnn->arOutputWeight;
+
+    for (i = 0; i < pnn->cOutput; i++) {
+        float r = pnn->arOutputThreshold[i];
+
+        for (j = 0; j < cHidden; j++)
+            r += ar[j] * *prWeight++;
+
+        arOutput[i] = sigmoid(-pnn->rBetaOutput * r);
+    }
+
+    return 0;
+}
 #endif
 
 extern int
@@ -357,6 +563,163 @@ NeuralNetSaveBinary(const neuralnet * pnn, FILE * pf)
     return 0;
 }
 
+/* The quantized hidden layer of a net already loaded, as written by
+ * makeweights -q after the nets themselves */
+
+extern int
+NeuralNetLoadQuantized(neuralnet * pnn, FILE * pf)
+{
+    unsigned int acSize[2];
+
+    if (fread(acSize, sizeof(acSize[0]), 2, pf) < 2)
+        return -1;
+
+    if (acSize[0] != pnn->cInput || acSize[1] != pnn->cHidden) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (QuantizedCreate(pnn))
+        return -1;
+
+    if (fread(pnn->arHiddenScale, sizeof(float), pnn->cHidden, pf) < pnn->cHidden ||
+        fread(pnn->asHiddenWeight, sizeof(short), QUANT_WEIGHTS(pnn), pf) < QUANT_WEIGHTS(pnn)) {
+        sse_free((float *) pnn->asHiddenWeight);
+        pnn->asHiddenWeight = NULL;
+        sse_free(pnn->arHiddenScale);
+        pnn->arHiddenScale = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+extern int
+NeuralNetSaveQuantized(const neuralnet * pnn, FILE * pf)
+{
+
+#define FWRITE( p, c ) \
+    if ( fwrite( (p), sizeof( *(p) ), (c), pf ) < (unsigned int)(c) ) return -1
+
+    FWRITE(&pnn->cInput, 1);
+    FWRITE(&pnn->cHidden, 1);
+    FWRITE(pnn->arHiddenScale, pnn->cHidden);
+    FWRITE(pnn->asHiddenWeight, QUANT_WEIGHTS(pnn));
+#undef FWRITE
+
+    return 0;
+}
+
+#if defined(USE_SIMD_DISPATCH)
+
+/* Kernels built into this binary, best first.  The last one runs on
+ * any CPU SIMD_Supported() accepts. */
+
+static int
+CheckAVX512(void)
+{
+    return __builtin_cpu_supports("avx512f") != 0;
+}
+
+static int
+CheckAVX2(void)
+{
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+static nnkernel anKernel[] = {
+    { "AVX-512F", 16, FALSE, NeuralNetEvaluateAVX512, NeuralNetEvaluateBatchAVX512,
+      NeuralNetEvaluateQuantizedAVX512, CheckAVX512 },
+    { "AVX2/FMA3", 8, FALSE, NeuralNetEvaluateAVX2, NeuralNetEvaluateBatchAVX2,
+      NeuralNetEvaluateQuantizedAVX2, CheckAVX2 },
+    { "SSE2", 4, TRUE, NeuralNetEvaluateSSE2, NeuralNetEvaluateBatchSSE2,
+      NeuralNetEvaluateQuantizedSSE2, NULL }
+};
+
+static const nnkernel *pnkActive = &anKernel[G_N_ELEMENTS(anKernel) - 1];
+
+static void
+SelectKernel(void)
+{
+    unsigned int i;
+
+    __builtin_cpu_init();
+
+    for (i = G_N_ELEMENTS(anKernel); i--;) {
+        if (anKernel[i].pfCheck)
+            anKernel[i].fSupported = anKernel[i].pfCheck();
+        if (anKernel[i].fSupported)
+            pnkActive = &anKernel[i];
+    }
+}
+
+/* The wider kernels need the hidden nodes to fill whole vectors, which
+ * is not the case for some of the pruning nets */
+
+static inline const nnkernel *
+NetKernel(const neuralnet * pnn)
+{
+    const nnkernel *pnk = pnkActive;
+
+    while (pnn->cHidden % pnk->cVecSize && pnk < &anKernel[G_N_ELEMENTS(anKernel) - 1])
+        pnk++;
+
+    return pnk;
+}
+
+extern int
+NeuralNetEvaluateSSE(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState)
+{
+    return NetKernel(pnn)->pfEvaluate(pnn, arInput, arOutput, pnState);
+}
+
+extern int
+NeuralNetEvaluateBatchSSE(const neuralnet * pnn, const float aarInput[], float aarOutput[], unsigned int cBatch)
+{
+    return NetKernel(pnn)->pfEvaluateBatch(pnn, aarInput, aarOutput, cBatch);
+}
+
+extern int
+NeuralNetEvaluateQuantizedSSE(const neuralnet * pnn, const float arInput[], float arOutput[])
+{
+    return NetKernel(pnn)->pfEvaluateQuantized(pnn, arInput, arOutput);
+}
+
+#else
+
+static nnkernel anKernel[] = {
+#if defined(USE_NEON)
+    { "NEON", VEC_SIZE, FALSE }
+#elif defined(USE_FMA3)
+    { "AVX/FMA3", VEC_SIZE, FALSE }
+#elif defined(USE_AVX)
+    { "AVX", VEC_SIZE, FALSE }
+#elif defined(USE_SSE2)
+    { "SSE2", VEC_SIZE, FALSE }
+#elif defined(USE_SIMD_INSTRUCTIONS)
+    { "SSE", VEC_SIZE, FALSE }
+#else
+    { "C", 1, TRUE }
+#endif
+};
+
+static const nnkernel *pnkActive = &anKernel[0];
+
+#endif
+
+extern unsigned int
+NeuralNetKernels(const nnkernel ** ppak)
+{
+    *ppak = anKernel;
+
+    return G_N_ELEMENTS(anKernel);
+}
+
+extern const nnkernel *
+NeuralNetKernel(void)
+{
+    return pnkActive;
+}
 
 #if defined(USE_SIMD_INSTRUCTIONS)
 
@@ -365,6 +728,17 @@ NeuralNetSaveBinary(const neuralnet * pnn, FILE * pf)
 int
 SIMD_Supported(void)
 {
+#if defined(USE_SIMD_DISPATCH)
+    static int fSelected = FALSE;
+
+    if (!fSelected) {
+        SelectKernel();
+        fSelected = TRUE;
+    }
+#else
+    anKernel[0].fSupported = TRUE;
+#endif
+
     return 1;
 }
 
@@ -560,6 +934,14 @@ SIMD_Supported(void)
 #else
         state = -2;
 #endif
+
+        if (state == 1) {
+#if defined(USE_SIMD_DISPATCH)
+            SelectKernel();
+#else
+            anKernel[0].fSupported = TRUE;
+#endif
+        }
     }
 
     return state;
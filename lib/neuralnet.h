@@ -35,6 +35,9 @@ typedef struct {
     float *arOutputWeight;
     float *arHiddenThreshold;
     float *arOutputThreshold;
+    /* Quantized copy of the hidden layer, see NeuralNetQuantize() */
+    short *asHiddenWeight;
+    float *arHiddenScale;
 } neuralnet;
 
 typedef enum {
@@ -58,12 +61,66 @@ typedef struct {
 #endif
 } NNState;
 
+/* Number of positions evaluated together by the batch functions */
+#define NN_BATCH_SIZE 32
+
+/* Floats per position in the input of the batch functions; the
+ * inputs of each position start on a SIMD aligned boundary */
+#define NN_INPUT_STRIDE(cInput) (((cInput) + 7) & ~7u)
+
+/* Quantized evaluation: the hidden weights are rounded to 16 bit
+ * integers, with a scale for each hidden node chosen so its largest
+ * weight becomes NN_QUANT_WEIGHT_MAX */
+#define NN_QUANT_WEIGHT_MAX 32767
+
 extern void NeuralNetDestroy(neuralnet * pnn);
+extern int NeuralNetQuantize(neuralnet * pnn, float *prError);
+extern int NeuralNetLoadQuantized(neuralnet * pnn, FILE * pf);
+extern int NeuralNetSaveQuantized(const neuralnet * pnn, FILE * pf);
 #if !defined(USE_SIMD_INSTRUCTIONS)
 extern int NeuralNetEvaluate(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState);
+extern int NeuralNetEvaluateBatch(const neuralnet * pnn, const float aarInput[], float aarOutput[],
+                                  unsigned int cBatch);
+extern int NeuralNetEvaluateQuantized(const neuralnet * pnn, const float arInput[], float arOutput[]);
 #else
 extern int NeuralNetEvaluateSSE(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState);
+extern int NeuralNetEvaluateBatchSSE(const neuralnet * pnn, const float aarInput[], float aarOutput[],
+                                     unsigned int cBatch);
+extern int NeuralNetEvaluateQuantizedSSE(const neuralnet * pnn, const float arInput[], float arOutput[]);
 #endif
+#if defined(USE_SIMD_DISPATCH)
+extern int NeuralNetEvaluateSSE2(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState);
+extern int NeuralNetEvaluateBatchSSE2(const neuralnet * pnn, const float aarInput[], float aarOutput[],
+                                      unsigned int cBatch);
+extern int NeuralNetEvaluateQuantizedSSE2(const neuralnet * pnn, const float arInput[], float arOutput[]);
+extern int NeuralNetEvaluateAVX2(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState);
+extern int NeuralNetEvaluateBatchAVX2(const neuralnet * pnn, const float aarInput[], float aarOutput[],
+                                      unsigned int cBatch);
+extern int NeuralNetEvaluateQuantizedAVX2(const neuralnet * pnn, const float arInput[], float arOutput[]);
+extern int NeuralNetEvaluateAVX512(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState);
+extern int NeuralNetEvaluateBatchAVX512(const neuralnet * pnn, const float aarInput[], float aarOutput[],
+                                        unsigned int cBatch);
+extern int NeuralNetEvaluateQuantizedAVX512(const neuralnet * pnn, const float arInput[], float arOutput[]);
+#endif
+
+/* Neural net evaluation code built into this binary.  With
+ * USE_SIMD_DISPATCH there are several and the best one the CPU
+ * supports is chosen by SIMD_Supported(). */
+typedef struct {
+    const char *szName;
+    unsigned int cVecSize;      /* floats per vector */
+    int fSupported;             /* by this CPU */
+#if defined(USE_SIMD_DISPATCH)
+    int (*pfEvaluate) (const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState);
+    int (*pfEvaluateBatch) (const neuralnet * pnn, const float aarInput[], float aarOutput[], unsigned int cBatch);
+    int (*pfEvaluateQuantized) (const neuralnet * pnn, const float arInput[], float arOutput[]);
+    int (*pfCheck) (void);
+#endif
+} nnkernel;
+
+extern unsigned int NeuralNetKernels(const nnkernel ** ppak);
+extern const nnkernel *NeuralNetKernel(void);
+
 extern int NeuralNetLoad(neuralnet * pnn, FILE * pf);
 extern int NeuralNetLoadBinary(neuralnet * pnn, FILE * pf);
 extern int NeuralNetSaveBinary(const neuralnet * pnn, FILE * pf);
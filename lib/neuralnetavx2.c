@@ -0,0 +1,27 @@
+/*
+ * Copyright (C) 2026 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* AVX2/FMA3 neural net kernel, selected at run time when gnubg is
+ * configured with --enable-simd=multi.  Built with SIMD_AVX2_CFLAGS. */
+
+#include "config.h"
+
+#if defined(USE_SIMD_DISPATCH)
+#define SIMD_KERNEL_AVX2 1
+
+#include "neuralnetsse.c"
+#endif
@@ -26,7 +26,13 @@
 #include <stdlib.h>
 #include "common.h"
 
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+#define ALIGN_SIZE 64
+#define VEC_SIZE 16
+#define LOG2VEC_SIZE 4
+#define float_vector __m512
+#define int_vector __m512i
+#elif defined(USE_AVX)
 #define ALIGN_SIZE 32
 #define VEC_SIZE 8
 #define LOG2VEC_SIZE 3
@@ -73,6 +79,13 @@
 
 #define sse_aligned(ar) (!(((size_t)ar) % ALIGN_SIZE))
 
+#if defined(USE_SIMD_DISPATCH)
+/* The weights must suit the widest of the kernels chosen at run time */
+#define MALLOC_ALIGN_SIZE 64
+#else
+#define MALLOC_ALIGN_SIZE ALIGN_SIZE
+#endif
+
 extern float *sse_malloc(size_t size);
 extern void sse_free(float *ptr);
 
@@ -341,10 +341,19 @@ RollsOS(const unsigned short int aus[32])
 
 }
 
+/*
+ * Calculate the distributions of position nId.
+ *
+ * The distributions of the positions after the moves are looked up in
+ * pusTable (64 values per position) if not NULL, otherwise in the xhash
+ * or in the database written so far.
+ */
+
 static void
 BearOff(int nId, unsigned int nPoints,
         unsigned short int aOutProb[64],
-        const int fGammon, xhash * ph, bearoffcontext * pbc, const int fCompress, FILE * pfOutput, FILE * pfTmp)
+        const int fGammon, xhash * ph, bearoffcontext * pbc, const int fCompress, FILE * pfOutput, FILE * pfTmp,
+        const unsigned short int *pusTable)
 {
 #if !defined(G_DISABLE_ASSERT)
     int iBest;
@@ -356,7 +365,7 @@ BearOff(int nId, unsigned int nPoints,
     int k;
     unsigned int us;
     unsigned int usBest;
-    unsigned short int *pusj;
+    const unsigned short int *pusj;
     unsigned short int ausj[64];
     unsigned short int ausBest[32];
 
@@ -429,16 +438,20 @@ BearOff(int nId, unsigned int nPoints,
 
                 if (!j) {
 
-                    memset(pusj = ausj, 0, fGammon ? 128 : 64);
-                    pusj[0] = 0xFFFF;
-                    pusj[32] = 0xFFFF;
+                    memset(ausj, 0, fGammon ? 128 : 64);
+                    ausj[0] = 0xFFFF;
+                    ausj[32] = 0xFFFF;
+                    pusj = ausj;
 
-                } else if (!(pusj = XhashLookup(ph, j))) {
+                } else if (pusTable)
+                    /* generated in an earlier layer */
+                    pusj = pusTable + 64 * (size_t) j;
+                else if (!(pusj = XhashLookup(ph, j))) {
                     /* look up in file generated so far */
-                    pusj = ausj;
-                    OSLookup(j, nPoints, pusj, fGammon, fCompress, pfOutput, pfTmp);
+                    OSLookup(j, nPoints, ausj, fGammon, fCompress, pfOutput, pfTmp);
 
-                    XhashAdd(ph, j, pusj, fGammon ? 128 : 64);
+                    XhashAdd(ph, j, ausj, fGammon ? 128 : 64);
+                    pusj = ausj;
                 }
 
                 /* find best move to win */
@@ -634,7 +647,7 @@ generate_os(const int nOS, const int fHeader,
     for (i = 0; i < n; ++i) {
 
         if (i)
-            BearOff(i, nOS, aus, fGammon, &h, pbc, fCompress, output, pfTmp);
+            BearOff(i, nOS, aus, fGammon, &h, pbc, fCompress, output, pfTmp, NULL);
         else {
             memset(aus, 0, 128);
             aus[0] = 0xFFFF;
@@ -979,13 +992,19 @@ TSLookup(const int nUs, const int nThem,
  * We store the equity in two bytes:
  * 0x0000 meaning equity=-1 and 0xFFFF meaning equity=+1.
  *
+ * The equities after the moves are looked up in psiTable (indexed by
+ * the roller's position times n plus the opponent's, with 4 or 1
+ * values per position) if not NULL, otherwise in the xhash or in the
+ * temporary file.
+ *
  */
 
 
 static void
 BearOff2(int nUs, int nThem,
          const int nTSP, const int nTSC,
-         short int asiEquity[4], const int n, const int fCubeful, xhash * ph, bearoffcontext * pbc, FILE * pfTmp)
+         short int asiEquity[4], const int n, const int fCubeful, xhash * ph, bearoffcontext * pbc, FILE * pfTmp,
+         const short int *psiTable)
 {
 
     int j, anRoll[2];
@@ -998,7 +1017,7 @@ BearOff2(int nUs, int nThem,
     int asiBest[4];
     int aiTotal[4];
     short int k;
-    short int *psij;
+    const short int *psij;
     short int asij[4];
     const short int EQUITY_P1 = 0x7FFF;
     const short int EQUITY_M1 = ~EQUITY_P1;
@@ -1066,11 +1085,14 @@ BearOff2(int nUs, int nThem,
                 } else if (!j) {
                     asij[0] = asij[1] = asij[2] = asij[3] = EQUITY_M1;
                 }
-                if (!(psij = XhashLookup(ph, n * nThem + j))) {
+                if (psiTable)
+                    /* generated in an earlier layer */
+                    psij = psiTable + ((size_t) nThem * n + j) * (fCubeful ? 4 : 1);
+                else if (!(psij = XhashLookup(ph, n * nThem + j))) {
                     /* lookup in file */
+                    TSLookup(nThem, j, nTSP, nTSC, asij, n, fCubeful, pfTmp);
+                    XhashAdd(ph, n * nThem + j, asij, fCubeful ? 8 : 2);
                     psij = asij;
-                    TSLookup(nThem, j, nTSP, nTSC, psij, n, fCubeful, pfTmp);
-                    XhashAdd(ph, n * nThem + j, psij, fCubeful ? 8 : 2);
                 }
 
                 /* cubeless */
@@ -1152,9 +1174,134 @@ WriteEquity(FILE * pf, const short int si)
 
 }
 
+/*
+ * Writes a two sided database position by position, in the order of
+ * the file. A compressed database is written a row of tiles at a time
+ * (see bearoff.c), so only BEAROFF_TILE rows are held in memory.
+ */
+
+typedef struct {
+    FILE *pf;
+    unsigned int n;             /* number of one sided positions */
+    unsigned int k;             /* values per position */
+    int fCompress;
+    unsigned int iRow;          /* first row of the current row of tiles */
+    unsigned int iPos;          /* positions of the current row of tiles written */
+    unsigned short int *aus;    /* the current row of tiles */
+    guint64 *aiOffset;          /* offsets of the tiles written */
+    size_t cTiles;
+} tswriter;
+
+static void
+TSWriteError(void)
+{
+    g_printerr(_("failed to read from or write to database file\n"));
+    exit(3);
+}
+
+static void
+TSWriterOpen(tswriter * ptw, FILE * pf, const int nTSP, const int nTSC, const int fHeader, const int fCubeful,
+             const int fCompress)
+{
+    ptw->pf = pf;
+    ptw->n = Combination(nTSP + nTSC, nTSC);
+    ptw->k = fCubeful ? 4 : 1;
+    ptw->fCompress = fCompress;
+    ptw->iRow = ptw->iPos = 0;
+    ptw->aus = NULL;
+    ptw->aiOffset = NULL;
+    ptw->cTiles = 0;
+
+    if (fHeader) {
+        char sz[41];
+        if (fCompress)
+            sprintf(sz, "gnubg-TS-%02d-%02d-%1d-1xxxxxxxxxxxxxxxxxxxxx\n", nTSP, nTSC, fCubeful);
+        else
+            sprintf(sz, "gnubg-TS-%02d-%02d-%1dxxxxxxxxxxxxxxxxxxxxxxx\n", nTSP, nTSC, fCubeful);
+        fputs(sz, pf);
+    }
+
+    if (fCompress) {
+        const size_t nTiles = (ptw->n + BEAROFF_TILE - 1) / BEAROFF_TILE;
+
+        ptw->aus = g_new(unsigned short int, (size_t) BEAROFF_TILE * ptw->n * ptw->k);
+        ptw->aiOffset = g_new(guint64, nTiles * nTiles + 1);
+        ptw->aiOffset[0] = (guint64) ftell(pf);
+    }
+}
+
+/* compress and write the current row of tiles */
+static void
+TSWriteTiles(tswriter * ptw)
+{
+    const unsigned int nRows = MIN(BEAROFF_TILE, ptw->n - ptw->iRow);
+    unsigned short int aus[BEAROFF_TILE * BEAROFF_TILE * 4];
+    unsigned char ac[BEAROFF_TILE_MAX_BYTES];
+    unsigned int iCol, nCols, i, cb;
+
+    for (iCol = 0; iCol < ptw->n; iCol += BEAROFF_TILE) {
+        nCols = MIN(BEAROFF_TILE, ptw->n - iCol);
+
+        for (i = 0; i < nRows; ++i)
+            memcpy(aus + i * nCols * ptw->k, ptw->aus + ((size_t) i * ptw->n + iCol) * ptw->k,
+                   nCols * ptw->k * sizeof(unsigned short int));
+
+        cb = BearoffEncodeTile(aus, nRows, nCols, ptw->k, ac);
+
+        if (fwrite(ac, 1, cb, ptw->pf) != cb)
+            TSWriteError();
+
+        ptw->aiOffset[ptw->cTiles + 1] = ptw->aiOffset[ptw->cTiles] + cb;
+        ++ptw->cTiles;
+    }
+
+    ptw->iRow += nRows;
+    ptw->iPos = 0;
+}
+
+static void
+TSWriterAdd(tswriter * ptw, const short int asiEquity[4])
+{
+    unsigned int i;
+
+    if (!ptw->fCompress) {
+        for (i = 0; i < ptw->k; ++i)
+            WriteEquity(ptw->pf, asiEquity[i]);
+        return;
+    }
+
+    for (i = 0; i < ptw->k; ++i)
+        ptw->aus[(size_t) ptw->iPos * ptw->k + i] = (unsigned short int) (asiEquity[i] + 0x8000);
+
+    if (++ptw->iPos == MIN(BEAROFF_TILE, ptw->n - ptw->iRow) * ptw->n)
+        TSWriteTiles(ptw);
+}
+
+/* write the index of a compressed database */
+static void
+TSWriterClose(tswriter * ptw)
+{
+    size_t i;
+    int j;
+
+    if (!ptw->fCompress)
+        return;
+
+    g_assert(ptw->iRow == ptw->n && !ptw->iPos);
+
+    for (i = 0; i <= ptw->cTiles; ++i)
+        for (j = 0; j < 8; ++j)
+            if (putc((int) ((ptw->aiOffset[i] >> (8 * j)) & 0xFF), ptw->pf) == EOF)
+                TSWriteError();
+
+    g_free(ptw->aus);
+    g_free(ptw->aiOffset);
+}
+
 static void
 generate_ts(const int nTSP, const int nTSC,
-            const int fHeader, const int fCubeful, const int nHashSize, bearoffcontext * pbc, FILE * output)
+            const int fHeader, const int fCubeful, const int fCompress, const int nHashSize, bearoffcontext * pbc,
+            FILE * output)
 {
 
     int i, j, k;
@@ -1166,6 +1313,8 @@ generate_ts(const int nTSP, const int nTSC,
     unsigned char ac[8];
     char *tmpfile;
     int fTTY = isatty(STDERR_FILENO);
+    tswriter tw;
+    int m;
 
     pfTmp = GetTemporaryFile(NULL, &tmpfile);
     if (pfTmp == NULL) {
@@ -1184,11 +1333,7 @@ generate_ts(const int nTSP, const int nTSC,
 
     /* write header information */
 
-    if (fHeader) {
-        char sz[41];
-        sprintf(sz, "gnubg-TS-%02d-%02d-%1dxxxxxxxxxxxxxxxxxxxxxxx\n", nTSP, nTSC, fCubeful);
-        fputs(sz, output);
-    }
+    TSWriterOpen(&tw, output, nTSP, nTSC, fHeader, fCubeful, fCompress);
 
 
     /* generate bearoff database */
@@ -1202,7 +1347,7 @@ generate_ts(const int nTSP, const int nTSC,
     for (i = 0; i < n; i++) {
         for (j = 0; j <= i; j++, ++iPos) {
 
-            BearOff2(i - j, j, nTSP, nTSC, asiEquity, n, fCubeful, &h, pbc, pfTmp);
+            BearOff2(i - j, j, nTSP, nTSC, asiEquity, n, fCubeful, &h, pbc, pfTmp, NULL);
 
             for (k = 0; k < (fCubeful ? 4 : 1); ++k)
                 WriteEquity(pfTmp, asiEquity[k]);
@@ -1219,7 +1364,7 @@ generate_ts(const int nTSP, const int nTSC,
     for (i = 0; i < n; i++) {
         for (j = i + 1; j < n; j++, ++iPos) {
 
-            BearOff2(i + n - j, j, nTSP, nTSC, asiEquity, n, fCubeful, &h, pbc, pfTmp);
+            BearOff2(i + n - j, j, nTSP, nTSC, asiEquity, n, fCubeful, &h, pbc, pfTmp, NULL);
 
             for (k = 0; k < (fCubeful ? 4 : 1); ++k)
                 WriteEquity(pfTmp, asiEquity[k]);
@@ -1250,15 +1395,20 @@ generate_ts(const int nTSP, const int nTSC,
 
             k = CalcPosition(i, j, n);
 
-            fseek(pfTmp, count * k, SEEK_SET);
-            if (fread(ac, 1, count, pfTmp) != count || fwrite(ac, 1, count, output) != count) {
-                g_printerr(_("failed to read from or write to database file\n"));
-                exit(3);
-            }
+            fseek(pfTmp, (long) count * k, SEEK_SET);
+            if (fread(ac, 1, count, pfTmp) != count)
+                TSWriteError();
+
+            for (m = 0; m < (fCubeful ? 4 : 1); ++m)
+                asiEquity[m] = (short int) ((ac[2 * m] | ac[2 * m + 1] << 8) - 0x8000);
+
+            TSWriterAdd(&tw, asiEquity);
         }
 
     }
 
+    TSWriterClose(&tw);
+
     fclose(pfTmp);
 
     g_unlink(tmpfile);
@@ -1267,6 +1417,239 @@ generate_ts(const int nTSP, const int nTSC,
 }
 
 
+/*
+ * Generation by layers of positions with the same number of pips.
+ *
+ * Every move lowers the pips of the side that moves, so the positions
+ * of a layer only depend on positions of lower layers and can be
+ * calculated in any order by several threads. All positions are kept
+ * in memory and written in the usual order at the end, so the database
+ * is the same as the one generated position by position.
+ */
+
+typedef struct {
+    unsigned int nMaxPips;
+    unsigned int *anPips;       /* pips of each position */
+    unsigned int *aiOrder;      /* the positions by increasing pips */
+    unsigned int *aiStart;      /* index in aiOrder of the first position with i pips */
+} piplayers;
+
+static void
+PipLayersCreate(piplayers * ppl, const unsigned int n, const unsigned int nPoints, const unsigned int nChequers)
+{
+    unsigned int i, j, an[25];
+    unsigned int *aiNext;
+
+    ppl->nMaxPips = nPoints * nChequers;
+    ppl->anPips = g_new(unsigned int, n);
+    ppl->aiOrder = g_new(unsigned int, n);
+    ppl->aiStart = g_new0(unsigned int, ppl->nMaxPips + 2);
+
+    for (i = 0; i < n; ++i) {
+        PositionFromBearoff(an, i, nPoints, nChequers);
+        for (ppl->anPips[i] = 0, j = 0; j < nPoints; ++j)
+            ppl->anPips[i] += (j + 1) * an[j];
+        ++ppl->aiStart[ppl->anPips[i] + 1];
+    }
+
+    for (i = 1; i < ppl->nMaxPips + 2; ++i)
+        ppl->aiStart[i] += ppl->aiStart[i - 1];
+
+    aiNext = g_new(unsigned int, ppl->nMaxPips + 1);
+    memcpy(aiNext, ppl->aiStart, (ppl->nMaxPips + 1) * sizeof(unsigned int));
+    for (i = 0; i < n; ++i)
+        ppl->aiOrder[aiNext[ppl->anPips[i]]++] = i;
+    g_free(aiNext);
+}
+
+static void
+PipLayersDestroy(piplayers * ppl)
+{
+    g_free(ppl->anPips);
+    g_free(ppl->aiOrder);
+    g_free(ppl->aiStart);
+}
+
+typedef struct {
+    unsigned int nPoints;
+    int fGammon;
+    bearoffcontext *pbc;
+    unsigned short int *pus;    /* 64 values per position */
+    const unsigned int *aiPos;  /* the positions of the layer */
+} oslayer;
+
+static void
+OSLayerPosition(void *pv, unsigned int i)
+{
+    const oslayer *pol = (const oslayer *) pv;
+    const unsigned int nId = pol->aiPos[i];
+
+    BearOff((int) nId, pol->nPoints, pol->pus + 64 * (size_t) nId, pol->fGammon, NULL, pol->pbc, FALSE, NULL, NULL,
+            pol->pus);
+}
+
+/*
+ * Generate one sided bearoff database with nThreads threads.
+ *
+ * Returns -1 without writing anything if the database does not fit in
+ * memory.
+ */
+
+static int
+generate_os_layers(const int nOS, const int fHeader, const int fCompress, const int fGammon, bearoffcontext * pbc,
+                   FILE * output, const unsigned int nThreads)
+{
+    const unsigned int n = Combination(nOS + 15, nOS);
+    unsigned int i, nDone = 0, npos = 0;
+    piplayers pl;
+    oslayer ol;
+    int fTTY = isatty(STDERR_FILENO);
+
+    if (!(ol.pus = g_try_malloc((size_t) n * 64 * sizeof(unsigned short int)))) {
+        g_printerr(_("Not enough memory to generate the database with threads\n"));
+        return -1;
+    }
+
+    ol.nPoints = nOS;
+    ol.fGammon = fGammon;
+    ol.pbc = pbc;
+
+    PipLayersCreate(&pl, n, nOS, 15);
+
+    for (i = 0; i <= pl.nMaxPips; ++i) {
+        const unsigned int c = pl.aiStart[i + 1] - pl.aiStart[i];
+
+        ol.aiPos = pl.aiOrder + pl.aiStart[i];
+        MT_ParallelForThreads(c, OSLayerPosition, &ol, nThreads);
+
+        nDone += c;
+        if (fTTY)
+            g_printerr(_("%u pips: %u/%u\r"), i, nDone, n);
+    }
+
+    PipLayersDestroy(&pl);
+
+    /* write header, then index and distributions as generate_os() does */
+
+    if (fHeader) {
+        char sz[41];
+        sprintf(sz, "gnubg-OS-%02d-15-%1d-%1d-0xxxxxxxxxxxxxxxxxxx\n", nOS, fGammon, fCompress);
+        fputs(sz, output);
+    }
+
+    if (fCompress)
+        for (i = 0; i < n; ++i)
+            WriteIndex(&npos, ol.pus + 64 * (size_t) i, fGammon, output);
+
+    for (i = 0; i < n; ++i) {
+        WriteOS(ol.pus + 64 * (size_t) i, fCompress, output);
+        if (fGammon)
+            WriteOS(ol.pus + 64 * (size_t) i + 32, fCompress, output);
+    }
+
+    putc('\n', stderr);
+
+    g_free(ol.pus);
+
+    return 0;
+}
+
+typedef struct {
+    int nTSP, nTSC, n, fCubeful;
+    bearoffcontext *pbc;
+    short int *psi;             /* 4 or 1 values per position */
+    const piplayers *ppl;
+    unsigned int nPips;         /* of both sides in this layer */
+    unsigned int iFirst;        /* in aiOrder, of the first position of the side on roll */
+} tslayer;
+
+/* All positions of the layer with the side on roll at its i'th position */
+static void
+TSLayerPositions(void *pv, unsigned int i)
+{
+    const tslayer *ptl = (const tslayer *) pv;
+    const piplayers *ppl = ptl->ppl;
+    const unsigned int nUs = ppl->aiOrder[ptl->iFirst + i];
+    const unsigned int nThemPips = ptl->nPips - ppl->anPips[nUs];
+    const int c = ptl->fCubeful ? 4 : 1;
+    unsigned int k;
+    short int asiEquity[4];
+
+    for (k = ppl->aiStart[nThemPips]; k < ppl->aiStart[nThemPips + 1]; ++k) {
+        const unsigned int nThem = ppl->aiOrder[k];
+
+        BearOff2((int) nUs, (int) nThem, ptl->nTSP, ptl->nTSC, asiEquity, ptl->n, ptl->fCubeful, NULL, ptl->pbc,
+                 NULL, ptl->psi);
+        memcpy(ptl->psi + ((size_t) nUs * ptl->n + nThem) * c, asiEquity, c * sizeof(short int));
+    }
+}
+
+/*
+ * Generate two sided bearoff database with nThreads threads.
+ *
+ * Returns -1 without writing anything if the database does not fit in
+ * memory.
+ */
+
+static int
+generate_ts_layers(const int nTSP, const int nTSC, const int fHeader, const int fCubeful, const int fCompress,
+                   bearoffcontext * pbc, FILE * output, const unsigned int nThreads)
+{
+    const unsigned int n = Combination(nTSP + nTSC, nTSC);
+    const size_t c = (size_t) n * n * (fCubeful ? 4 : 1);
+    unsigned int i, j;
+    size_t nDone = 0, k;
+    piplayers pl;
+    tslayer tl;
+    tswriter tw;
+    int fTTY = isatty(STDERR_FILENO);
+
+    if (!(tl.psi = g_try_malloc(c * sizeof(short int)))) {
+        g_printerr(_("Not enough memory to generate the database with threads\n"));
+        return -1;
+    }
+
+    tl.nTSP = nTSP;
+    tl.nTSC = nTSC;
+    tl.n = (int) n;
+    tl.fCubeful = fCubeful;
+    tl.pbc = pbc;
+    tl.ppl = &pl;
+
+    PipLayersCreate(&pl, n, nTSP, nTSC);
+
+    for (tl.nPips = 0; tl.nPips <= 2 * pl.nMaxPips; ++tl.nPips) {
+        const unsigned int nLow = tl.nPips > pl.nMaxPips ? tl.nPips - pl.nMaxPips : 0;
+        const unsigned int nHigh = MIN(tl.nPips, pl.nMaxPips);
+
+        tl.iFirst = pl.aiStart[nLow];
+        MT_ParallelForThreads(pl.aiStart[nHigh + 1] - tl.iFirst, TSLayerPositions, &tl, nThreads);
+
+        for (i = nLow; i <= nHigh; ++i) {
+            j = tl.nPips - i;
+            nDone += (size_t) (pl.aiStart[i + 1] - pl.aiStart[i]) * (pl.aiStart[j + 1] - pl.aiStart[j]);
+        }
+        if (fTTY)
+            g_printerr(_("%u pips: %.0f/%.0f\r"), tl.nPips, (double) nDone, (double) n * n);
+    }
+
+    PipLayersDestroy(&pl);
+
+    TSWriterOpen(&tw, output, nTSP, nTSC, fHeader, fCubeful, fCompress);
+
+    for (k = 0; k < c; k += fCubeful ? 4 : 1)
+        TSWriterAdd(&tw, tl.psi + k);
+
+    TSWriterClose(&tw);
+
+    putc('\n', stderr);
+
+    g_free(tl.psi);
+
+    return 0;
+}
+
+
 extern int
 main(int argc, char **argv)
 {
@@ -1281,6 +1664,8 @@ main(int argc, char **argv)
     static int fND = FALSE;
     static char *szOutput = NULL;
     static char *szTwoSided = NULL;
+    static int nThreads = 1;
+    static int fCompressTS = FALSE;
 
     bearoffcontext *pbc = NULL;
     FILE *outfile;
@@ -1302,12 +1687,18 @@ main(int argc, char **argv)
          N_("Do not calculate cubeful equities for two-sided databases"), NULL},
         {"no-compress", 'c', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &fCompress,
          N_("Do not use compression scheme for one-sided databases"), NULL},
+        {"compress-two-sided", 'z', 0, G_OPTION_ARG_NONE, &fCompressTS,
+         N_("Store two-sided databases in compressed blocks"), NULL},
         {"no-gammon", 'g', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &fGammon,
          N_("Do not include gammon distribution for one-sided databases"), NULL},
         {"normal-dist", 'n', 0, G_OPTION_ARG_NONE, &fND,
          N_("Approximate one-sided bearoff database with normal distributions"), NULL},
         {"outfile", 'f', 0, G_OPTION_ARG_STRING, &szOutput,
          N_("Required output filename"), "filename"},
+#if defined(USE_MULTITHREAD)
+        {"threads", 'j', 0, G_OPTION_ARG_INT, &nThreads,
+         N_("Generate exact databases with N threads, in memory"), "N"},
+#endif
         {NULL, 0, 0, (GOptionArg) 0, NULL, NULL, NULL}
     };
 
@@ -1336,6 +1727,11 @@ main(int argc, char **argv)
     if (szTwoSided)
         sscanf(szTwoSided, "%2dx%2d", &nTSP, &nTSC);
 
+    if (nThreads < 1 || nThreads > MAX_NUMTHREADS) {
+        g_printerr(_("The number of threads must be between 1 and %d\n"), MAX_NUMTHREADS);
+        exit(EXIT_FAILURE);
+    }
+
     if (!szOutput) {
         g_printerr(_("Required argument -f missing\n"));
         exit(EXIT_FAILURE);
@@ -1363,6 +1759,7 @@ main(int argc, char **argv)
         g_printerr("%-37s: %12s\n", _("Use compression scheme"), fCompress ? _("yes") : _("no"));
         g_printerr("%-37s: %12s\n", _("Write header"), fHeader ? _("yes") : _("no"));
         g_printerr("%-37s: %12d\n", _("Size of cache"), nHashSize);
+        g_printerr("%-37s: %12d\n", _("Number of threads"), nThreads);
         g_printerr("%-37s: %12s %s\n", _("Reuse old bearoff database"), szOldBearoff ? _("yes") : _("no"),
                 szOldBearoff ? szOldBearoff : "");
 
@@ -1393,7 +1790,8 @@ main(int argc, char **argv)
 
         if (fND) {
             generate_nd(nOS, nHashSize, fHeader, pbc, outfile);
-        } else {
+        } else if (nThreads < 2
+                   || generate_os_layers(nOS, fHeader, fCompress, fGammon, pbc, outfile, (unsigned int) nThreads)) {
             generate_os(nOS, fHeader, fCompress, fGammon, nHashSize, pbc, outfile);
         }
 
@@ -1425,8 +1823,17 @@ main(int argc, char **argv)
         g_printerr("%-37s: %12s\n", _("Write header"), fHeader ? _("yes") : _("no"));
         g_printerr("%-37s: %12d\n", _("Number of one-sided positions"), n);
         g_printerr("%-37s: %12d\n", _("Total number of positions"), n * n);
-        g_printerr("%-37s: %.0f %s (%.1f MB)\n", _("Size of resulting file"), r, _("bytes"), r / 1048576.0);
+        g_printerr("%-37s: %12s\n", _("Use compression scheme"), fCompressTS ? _("yes") : _("no"));
+        if (fCompressTS) {
+            g_printerr("%-37s: %.0f %s (%.1f MB)\n", _("Size of database (uncompressed)"), r, _("bytes"),
+                       r / 1048576.0);
+            r /= 1.4;
+            g_printerr("%-37s: %.0f %s (%.1f MB)\n", _("Estimated size of compressed db"), r, _("bytes"),
+                       r / 1048576.0);
+        } else
+            g_printerr("%-37s: %.0f %s (%.1f MB)\n", _("Size of resulting file"), r, _("bytes"), r / 1048576.0);
         g_printerr("%-37s: %12d\n", _("Size of xhash"), nHashSize);
+        g_printerr("%-37s: %12d\n", _("Number of threads"), nThreads);
         g_printerr("%-37s: %12s %s\n", _("Reuse old bearoff database"), szOldBearoff ? _("yes") : _("no"),
                 szOldBearoff ? szOldBearoff : "");
         /* initialise old bearoff database */
@@ -1443,7 +1850,9 @@ main(int argc, char **argv)
             exit(2);
         }
 
-        generate_ts(nTSP, nTSC, fHeader, fCubeful, nHashSize, pbc, outfile);
+        if (nThreads < 2
+            || generate_ts_layers(nTSP, nTSC, fHeader, fCubeful, fCompressTS, pbc, outfile, (unsigned int) nThreads))
+            generate_ts(nTSP, nTSC, fHeader, fCubeful, fCompressTS, nHashSize, pbc, outfile);
 
         /* close old bearoff database */
 
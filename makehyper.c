@@ -58,9 +58,33 @@ typedef struct {
 
     float arOutput[NUM_OUTPUTS];
     float arEquity[5];
+    float arPad[2];             /* keep zero */
 
 } hyperequity;
 
+/* a hyperequity seen as one vector, so that summing up the rolls is a
+ * single loop of 12 floats the compiler can vectorise */
+#define HYPER_FLOATS 12
+#define HyperFloats(phe) ((float *) (phe))
+
+G_STATIC_ASSERT(sizeof(hyperequity) == HYPER_FLOATS * sizeof(float));
+
+typedef enum {
+    SWEEP_GAUSS_SEIDEL,
+    SWEEP_JACOBI
+} sweeptype;
+
+/* one iteration of CalcNewEquity() */
+typedef struct {
+    int nC;
+    int nPos;
+    int iRow;                   /* the row being calculated */
+    const hyperequity *aheOld;  /* the equities moves are looked up in */
+    hyperequity *aheRow;        /* where row iRow goes */
+    float rOmega;               /* the relaxation factor */
+    float (*aarNorm)[10];       /* the norm of each position of the row */
+} hypersweep;
+
 extern void
 MT_CloseThreads(void)
 {
@@ -290,8 +314,15 @@ CubeEquity(const float rND, const float rDT, const float rDP)
 }
 
 
+/*
+ * Calculate the equities of nUs on roll against nThem from the equities
+ * in aheOld into phe, moving rOmega of the way from the old equities to
+ * the new ones (1 is plain value iteration, over 1 over-relaxation).
+ */
+
 static void
-HyperEquity(const int nUs, const int nThem, hyperequity * phe, const int nC, const hyperequity aheOld[], float arNorm[])
+HyperEquity(const int nUs, const int nThem, const int nC, const int nPos,
+            const hyperequity aheOld[], const float rOmega, hyperequity * phe, float arNorm[])
 {
 
     TanBoard anBoard;
@@ -301,16 +332,11 @@ HyperEquity(const int nUs, const int nThem, hyperequity * phe, const int nC, con
     unsigned int k;
     int nUsNew, nThemNew;
     hyperequity heBest;
-    hyperequity heOld;
     hyperequity heNew;
-    int nPos = Combination(25 + nC, nC);
+    const hyperequity *pheOld = &aheOld[nPos * nUs + nThem];
     const hyperequity *phex;
     float r;
 
-    /* save old hyper equity */
-
-    memcpy(&heOld, phe, sizeof(hyperequity));
-
     /* generate board for position */
 
     PositionFromBearoff(anBoard[0], nThem, 25, nC);
@@ -319,6 +345,8 @@ HyperEquity(const int nUs, const int nThem, hyperequity * phe, const int nC, con
     switch (ClassifyHyper(anBoard)) {
     case HYPER_OVER:
 
+        memset(phe, 0, sizeof(hyperequity));
+
         HyperOver((ConstTanBoard) anBoard, phe->arOutput, nC);
 
         for (k = 0; k < 5; ++k)
@@ -332,15 +360,15 @@ HyperEquity(const int nUs, const int nThem, hyperequity * phe, const int nC, con
 
     case HYPER_ILLEGAL:
 
+        memcpy(phe, pheOld, sizeof(hyperequity));
+
         return;
 
     case HYPER_BEAROFF:
     case HYPER_CONTACT:
 
-        for (k = 0; k < NUM_OUTPUTS; ++k)
-            heNew.arOutput[k] = 0.0f;
-        for (k = 0; k < 5; ++k)
-            heNew.arEquity[k] = 0.0f;
+        memset(&heNew, 0, sizeof(hyperequity));
+        memset(&heBest, 0, sizeof(hyperequity));
 
         for (i = 1; i <= 6; ++i)
             for (j = 1; j <= i; ++j) {
@@ -424,19 +452,31 @@ HyperEquity(const int nUs, const int nThem, hyperequity * phe, const int nC, con
 
                 /* sum up equities */
 
-                for (k = 0; k < NUM_OUTPUTS; ++k)
-                    heNew.arOutput[k] += (i == j) ? heBest.arOutput[k] : 2.0f * heBest.arOutput[k];
-                for (k = 0; k < 5; ++k)
-                    heNew.arEquity[k] += (i == j) ? heBest.arEquity[k] : 2.0f * heBest.arEquity[k];
+                {
+                    const float rWeight = (i == j) ? 1.0f : 2.0f;
+                    const float *prBest = HyperFloats(&heBest);
+                    float *prNew = HyperFloats(&heNew);
+
+                    for (k = 0; k < HYPER_FLOATS; ++k)
+                        prNew[k] += rWeight * prBest[k];
+                }
 
             }
 
-        /* normalise */
+        /* normalise and relax */
 
-        for (k = 0; k < NUM_OUTPUTS; ++k)
-            phe->arOutput[k] = heNew.arOutput[k] / 36.0f;
-        for (k = 0; k < 5; ++k)
-            phe->arEquity[k] = heNew.arEquity[k] / 36.0f;
+        {
+            const float *prOld = HyperFloats(pheOld);
+            const float *prNew = HyperFloats(&heNew);
+            float *pr = HyperFloats(phe);
+
+            if (rOmega == 1.0f)
+                for (k = 0; k < HYPER_FLOATS; ++k)
+                    pr[k] = prNew[k] / 36.0f;
+            else
+                for (k = 0; k < HYPER_FLOATS; ++k)
+                    pr[k] = prOld[k] + rOmega * (prNew[k] / 36.0f - prOld[k]);
+        }
 
         break;
 
@@ -445,13 +485,13 @@ HyperEquity(const int nUs, const int nThem, hyperequity * phe, const int nC, con
     /* calculate contribution to norm */
 
     for (k = 0; k < NUM_OUTPUTS; ++k) {
-        r = fabsf(phe->arOutput[k] - heOld.arOutput[k]);
+        r = fabsf(phe->arOutput[k] - pheOld->arOutput[k]);
         if (r > arNorm[k]) {
             arNorm[k] = r;
         }
     }
     for (k = 0; k < 5; ++k) {
-        r = fabsf(phe->arEquity[k] - heOld.arEquity[k]);
+        r = fabsf(phe->arEquity[k] - pheOld->arEquity[k]);
         if (r > arNorm[5 + k]) {
             arNorm[5 + k] = r;
         }
@@ -462,28 +502,80 @@ HyperEquity(const int nUs, const int nThem, hyperequity * phe, const int nC, con
 
 
 static void
-CalcNewEquity(hyperequity ahe[], const int nC, float arNorm[])
+HyperEquityColumn(void *data, unsigned int j)
 {
+    hypersweep *phs = (hypersweep *) data;
 
-    int i, j;
+    memset(phs->aarNorm[j], 0, sizeof(phs->aarNorm[j]));
+    HyperEquity(phs->iRow, (int) j, phs->nC, phs->nPos, phs->aheOld, phs->rOmega, &phs->aheRow[j], phs->aarNorm[j]);
+}
+
+
+/*
+ * One iteration over all positions, a row (us on roll) at a time with
+ * the positions of a row shared out between nThreads threads.
+ *
+ * Gauss-Seidel: each row is calculated from the equities of the rows
+ * before it in this iteration, which converges in fewer iterations.
+ * The row itself is only replaced when all of it is done, so the result
+ * does not depend on the number of threads.
+ *
+ * Jacobi: all positions are calculated from the previous iteration,
+ * which needs a second table (aheNew) but no waiting between rows.
+ */
+
+static void
+CalcNewEquity(hyperequity ** pahe, hyperequity ** paheNew, const int nC, const sweeptype st,
+              const float rOmega, const unsigned int nThreads, float arNorm[])
+{
+
+    int i, j, k;
     int nPos = Combination(25 + nC, nC);
+    hypersweep hs;
+    hyperequity *aheRow = NULL;
 
     for (i = 0; i < 10; ++i)
         arNorm[i] = 0.0f;
 
+    hs.nC = nC;
+    hs.nPos = nPos;
+    hs.aheOld = *pahe;
+    hs.rOmega = rOmega;
+    hs.aarNorm = g_malloc(nPos * sizeof(*hs.aarNorm));
+
+    if (st == SWEEP_GAUSS_SEIDEL)
+        aheRow = (hyperequity *) g_malloc(nPos * sizeof(hyperequity));
+
     for (i = 0; i < nPos; ++i) {
 
         g_print("\r%d/%d              ", i + 1, nPos);
         fflush(stdout);
 
-        for (j = 0; j < nPos; ++j) {
+        hs.iRow = i;
+        hs.aheRow = (st == SWEEP_GAUSS_SEIDEL) ? aheRow : *paheNew + i * nPos;
 
-            HyperEquity(i, j, &ahe[i * nPos + j], nC, ahe, arNorm);
+        MT_ParallelForThreads(nPos, HyperEquityColumn, &hs, nThreads);
 
-        }
+        if (st == SWEEP_GAUSS_SEIDEL)
+            memcpy(*pahe + i * nPos, aheRow, nPos * sizeof(hyperequity));
+
+        for (j = 0; j < nPos; ++j)
+            for (k = 0; k < 10; ++k)
+                if (hs.aarNorm[j][k] > arNorm[k])
+                    arNorm[k] = hs.aarNorm[j][k];
 
     }
 
+    if (st == SWEEP_JACOBI) {
+        hyperequity *ahe = *pahe;
+
+        *pahe = *paheNew;
+        *paheNew = ahe;
+    }
+
+    g_free(aheRow);
+    g_free(hs.aarNorm);
+
     g_print("\n");
 
 }
@@ -557,6 +649,7 @@ main(int argc, char **argv)
 
     int nC = 3;
     hyperequity *aheEquity;
+    hyperequity *aheNew = NULL;
     int nPos;
     float rNorm;
     float rEpsilon = 1.0e-5f;
@@ -569,6 +662,11 @@ main(int argc, char **argv)
     char *szOutput = NULL;
     char *szRestart = NULL;
     int fCheckPoint = TRUE;
+    gchar *szSweep = NULL;
+    gchar *szOmega = NULL;
+    sweeptype st = SWEEP_GAUSS_SEIDEL;
+    float rOmega = 1.0f;
+    int nThreads = 1;
 
     GOptionEntry ao[] = {
         {"chequers", 'c', 0, G_OPTION_ARG_INT, &nC,
@@ -581,6 +679,15 @@ main(int argc, char **argv)
          N_("Do not write a checkpoint file after each iteration"), NULL},
         {"outfile", 'f', 0, G_OPTION_ARG_STRING, &szOutput,
          N_("Output filename. Default is hyper<C>.bd"), "filename"},
+        {"sweep", 's', 0, G_OPTION_ARG_STRING, &szSweep,
+         N_("Update the equities \"gauss-seidel\" (row by row) or \"jacobi\" "
+            "(all at once, uses twice the memory). Default is gauss-seidel"), "type"},
+        {"relaxation", 'w', 0, G_OPTION_ARG_STRING, &szOmega,
+         N_("The relaxation factor (0<W<2), over 1 may need fewer iterations. Default is 1"), "W"},
+#if defined(USE_MULTITHREAD)
+        {"threads", 'j', 0, G_OPTION_ARG_INT, &nThreads,
+         N_("The number of threads to use. Default is 1"), "N"},
+#endif
         {NULL, 0, 0, (GOptionArg) 0, NULL, NULL, NULL}
     };
 
@@ -616,6 +723,29 @@ main(int argc, char **argv)
         exit(1);
     }
 
+    if (szSweep) {
+        if (!strcmp(szSweep, "gauss-seidel"))
+            st = SWEEP_GAUSS_SEIDEL;
+        else if (!strcmp(szSweep, "jacobi"))
+            st = SWEEP_JACOBI;
+        else {
+            g_printerr(_("Valid sweeps are gauss-seidel and jacobi\n"));
+            exit(1);
+        }
+    }
+
+    if (szOmega)
+        rOmega = (float) g_strtod(szOmega, NULL);
+    if (rOmega <= 0.0f || rOmega >= 2.0f) {
+        g_printerr(_("Valid relaxation factors are 0.0 - 2.0\n"));
+        exit(1);
+    }
+
+    if (nThreads < 1 || nThreads > MAX_NUMTHREADS) {
+        g_printerr(_("Valid numbers of threads are 1 - %d\n"), MAX_NUMTHREADS);
+        exit(1);
+    }
+
     if (nC < 1 || nC > 3) {
         g_printerr(_("Illegal options. Try `makehyper --help' for usage information\n"));
         exit(1);
@@ -637,6 +767,9 @@ main(int argc, char **argv)
     g_print("%-40s: %d %s\n", _("Estimated size of file"), nPos * nPos * 28 + 40,  _("bytes"));
     g_print("%-40s: %s\n", _("Output file"), szOutput);
     g_print("%-40s: %e\n", _("Convergence threshold"), rEpsilon);
+    g_print("%-40s: %s\n", _("Sweep"), st == SWEEP_JACOBI ? "jacobi" : "gauss-seidel");
+    g_print("%-40s: %g\n", _("Relaxation factor"), rOmega);
+    g_print("%-40s: %d\n", _("Number of threads"), nThreads);
 
     /* Iteration 0 */
 
@@ -647,7 +780,9 @@ main(int argc, char **argv)
     SetCubeInfo(&ci, 1, -1, 0, 0, NULL, FALSE, FALSE, FALSE, VARIATION_HYPERGAMMON_1 + nC - 1);
     SetCubeInfo(&ciJacoby, 1, -1, 0, 0, NULL, FALSE, TRUE, FALSE, VARIATION_HYPERGAMMON_1 + nC - 1);
 
-    aheEquity = (hyperequity *) g_malloc(nPos * nPos * sizeof(hyperequity));
+    aheEquity = (hyperequity *) g_malloc0(nPos * nPos * sizeof(hyperequity));
+    if (st == SWEEP_JACOBI)
+        aheNew = (hyperequity *) g_malloc0(nPos * nPos * sizeof(hyperequity));
 
     if (!szRestart) {
         g_print(_("0-vector start guess\n"));
@@ -669,7 +804,7 @@ main(int argc, char **argv)
 
         g_print(_("*** Iteration %03d *** \n"), it);
 
-        CalcNewEquity(aheEquity, nC, arNorm);
+        CalcNewEquity(&aheEquity, &aheNew, nC, st, rOmega, (unsigned int) nThreads, arNorm);
 
         rNorm = NormOO(arNorm, 10);
 
@@ -701,6 +836,7 @@ main(int argc, char **argv)
     g_print(_("Time for writing final file: %d seconds\n"), (int) (t1 - t0));
 
     g_free(aheEquity);
+    g_free(aheNew);
     g_free(szOutput);
 
     time(&t3);
@@ -32,7 +32,8 @@
 static void
 usage(char *prog)
 {
-    g_printerr(_("Usage: %s [[-f] outputfile [inputfile]]\n"
+    g_printerr(_("Usage: %s [-q] [[-f] outputfile [inputfile]]\n"
+            "  -q: Add quantized contact, race and crashed nets\n"
             "  outputfile: Output to file instead of stdout\n"
             "  inputfile: Input from file instead of stdin\n"), prog);
     exit(1);
@@ -42,9 +43,13 @@ extern int
 main(int argc, /*lint -e{818} */ char *argv[])
 {
     neuralnet nn;
+    /* the contact, race and crashed nets, kept for quantization */
+    neuralnet ann[3];
+    static const char *aszNet[3] = { "contact", "race", "crashed" };
     char szFileVersion[16];
     static float ar[2] = { WEIGHTS_MAGIC_BINARY, WEIGHTS_VERSION_BINARY };
-    int c;
+    static float rQuantized = WEIGHTS_MAGIC_QUANTIZED;
+    int c, fQuantize = FALSE;
     FILE *in = stdin, *out = stdout;
 
     if (!setlocale(LC_ALL, "C") || !bindtextdomain(PACKAGE, LOCALEDIR) || !textdomain(PACKAGE)) {
@@ -54,6 +59,12 @@ main(int argc, /*lint -e{818} */ char *argv[])
 
     g_set_printerr_handler(print_utf8_to_locale);
 
+    if (argc > 1 && !StrCaseCmp(argv[1], "-q")) {
+        fQuantize = TRUE;
+        argc--;
+        argv++;
+    }
+
     if (argc > 1) {
         int arg = 1;
         if (!StrCaseCmp(argv[1], "-f"))
@@ -111,11 +122,37 @@ main(int argc, /*lint -e{818} */ char *argv[])
             fclose(out);
             return EXIT_FAILURE;
         }
-        NeuralNetDestroy(&nn);
+        if (fQuantize && c < 3)
+            ann[c] = nn;
+        else
+            NeuralNetDestroy(&nn);
     }
 
     g_printerr(_("%d nets converted\n"), c);
 
+    if (fQuantize) {
+        if (c < 3 || fwrite(&rQuantized, sizeof(rQuantized), 1, out) != 1) {
+            g_printerr(_("Failed to write quantized nets!"));
+            fclose(in);
+            fclose(out);
+            return EXIT_FAILURE;
+        }
+
+        for (c = 0; c < 3; c++) {
+            float rError;
+
+            if (NeuralNetQuantize(&ann[c], &rError) || NeuralNetSaveQuantized(&ann[c], out)) {
+                g_printerr(_("Failed to write quantized nets!"));
+                fclose(in);
+                fclose(out);
+                return EXIT_FAILURE;
+            }
+
+            g_printerr(_("%s net quantized, largest error at a hidden node %.4f\n"), aszNet[c], rError);
+            NeuralNetDestroy(&ann[c]);
+        }
+    }
+
     fclose(in);
     fclose(out);
 
@@ -33,25 +33,122 @@
 
 SSE_ALIGN(ThreadData td);
 
+/* Incremental evaluation state for the race, crashed and contact nets */
+
+static NNState *
+CreateNNStates(void)
+{
+    const neuralnet *apnn[NUM_NN_STATES] = { &nnRace, &nnCrashed, &nnContact };
+    NNState *pnnState = (NNState *) g_malloc(sizeof(NNState) * NUM_NN_STATES);
+
+    for (int i = 0; i < NUM_NN_STATES; i++) {
+        pnnState[i].state = NNSTATE_NONE;
+        pnnState[i].savedBase = g_malloc0(apnn[i]->cHidden * sizeof(float));
+        pnnState[i].savedIBase = g_malloc0(apnn[i]->cInput * sizeof(float));
+    }
+
+    return pnnState;
+}
+
+static void
+FreeNNStates(NNState * pnnState)
+{
+    for (int i = 0; i < NUM_NN_STATES; i++) {
+        g_free(pnnState[i].savedBase);
+        g_free(pnnState[i].savedIBase);
+    }
+
+    g_free(pnnState);
+}
+
 extern ThreadLocalData *
 MT_CreateThreadLocalData(int id)
 {
     ThreadLocalData *tld = (ThreadLocalData *) g_malloc(sizeof(ThreadLocalData));
     tld->id = id;
-    tld->pnnState = (NNState *) g_malloc(sizeof(NNState) * 3);
-    // cppcheck-suppress duplicateExpression
-    tld->pnnState[CLASS_RACE - CLASS_RACE].savedBase = g_malloc0(nnRace.cHidden * sizeof(float));
-    // cppcheck-suppress duplicateExpression
-    tld->pnnState[CLASS_RACE - CLASS_RACE].savedIBase = g_malloc0(nnRace.cInput * sizeof(float));
-    tld->pnnState[CLASS_CRASHED - CLASS_RACE].savedBase = g_malloc0(nnCrashed.cHidden * sizeof(float));
-    tld->pnnState[CLASS_CRASHED - CLASS_RACE].savedIBase = g_malloc0(nnCrashed.cInput * sizeof(float));
-    tld->pnnState[CLASS_CONTACT - CLASS_RACE].savedBase = g_malloc0(nnContact.cHidden * sizeof(float));
-    tld->pnnState[CLASS_CONTACT - CLASS_RACE].savedIBase = g_malloc0(nnContact.cInput * sizeof(float));
+    tld->pnnState = CreateNNStates();
 
     tld->aMoves = (move *) g_malloc0(sizeof(move) * MAX_INCOMPLETE_MOVES);
     return tld;
 }
 
+extern void
+MT_FreeThreadLocalData(ThreadLocalData * tld)
+{
+    g_free(tld->aMoves);
+    FreeNNStates(tld->pnnState);
+    g_free(tld);
+}
+
+/* An MT_ParallelForThreads() in progress */
+typedef struct {
+    ParallelFun fun;
+    void *data;
+    int n;
+    int next;
+} ParallelForThreads;
+
+static void
+ParallelForThreadsRun(ParallelForThreads * ppf)
+{
+    int i;
+
+    while ((i = MT_SafeIncCheck(&ppf->next)) < ppf->n)
+        ppf->fun(ppf->data, (unsigned int) i);
+}
+
+#if defined(USE_MULTITHREAD)
+static gpointer
+ParallelForThread(gpointer p)
+{
+    ThreadLocalData *ptld = MT_CreateThreadLocalData(0);
+
+    TLSSetValue(td.tlsItem, (size_t) ptld);
+    ParallelForThreadsRun((ParallelForThreads *) p);
+    MT_FreeThreadLocalData(ptld);
+
+    return NULL;
+}
+#endif
+
+/*
+ * MT_ParallelFor() for the programs without the worker threads of
+ * multithread.c, such as makebearoff and makehyper: up to nThreads - 1
+ * threads are started for the call and the calling thread is the last.
+ */
+extern void
+MT_ParallelForThreads(unsigned int n, ParallelFun fun, void *data, unsigned int nThreads)
+{
+    ParallelForThreads pf;
+#if defined(USE_MULTITHREAD)
+    GThread *apt[MAX_NUMTHREADS];
+    unsigned int i, cThreads = 0;
+#endif
+
+    pf.fun = fun;
+    pf.data = data;
+    pf.n = (int) n;
+    pf.next = 0;
+
+#if defined(USE_MULTITHREAD)
+    for (i = 1; i < MIN(nThreads, MAX_NUMTHREADS) && i < n; ++i)
+#if GLIB_CHECK_VERSION (2,32,0)
+        if ((apt[cThreads] = g_thread_try_new(NULL, ParallelForThread, &pf, NULL)))
+#else
+        if ((apt[cThreads] = g_thread_create(ParallelForThread, &pf, TRUE, NULL)))
+#endif
+            ++cThreads;
+
+    ParallelForThreadsRun(&pf);
+
+    for (i = 0; i < cThreads; ++i)
+        g_thread_join(apt[i]);
+#else
+    (void) nThreads;
+    ParallelForThreadsRun(&pf);
+#endif
+}
+
 #if defined(USE_MULTITHREAD)
 
 #if defined(DEBUG_MULTITHREADED) && defined(WIN32)
@@ -218,11 +315,36 @@ FreeMutex(Mutex * mutex)
 }
 #endif
 
+#if GLIB_CHECK_VERSION (2,32,0)
+/* Add the time a thread was kept waiting for a lock to its total, see
+ * MT_GetLockWait() */
+static void
+LockWaited(gint64 usWait)
+{
+    const size_t *pValue = (const size_t *) g_private_get(td.tlsItem);
+    gint64 *ausLockWait = td.ausLockWait;
+    int id;
+
+    /* threads of our own only, and not while they are being replaced */
+    if (!pValue || !ausLockWait)
+        return;
+
+    id = ((ThreadLocalData *) * pValue)->id;
+    ausLockWait[id < 0 ? (int) td.numThreads : id] += usWait;
+}
+#endif
+
 extern void
 Mutex_Lock(Mutex * mutex)
 {
 #if GLIB_CHECK_VERSION (2,32,0)
-    g_mutex_lock(mutex);
+    /* only a lock that is held costs the time to measure the wait */
+    if (!g_mutex_trylock(mutex)) {
+        gint64 t = g_get_monotonic_time();
+
+        g_mutex_lock(mutex);
+        LockWaited(g_get_monotonic_time() - t);
+    }
 #else
     g_mutex_lock(*mutex);
 #endif
@@ -247,6 +369,8 @@ MT_InitThreads(void)
     g_assert(g_thread_supported());
 #endif
     td.tasks = NULL;
+    td.aQueue = NULL;
+    MT_SafeSet(&td.queuedTasks, 0);
     MT_SafeSet(&td.doneTasks, 0);
     td.addedTasks = 0;
     td.totalTasks = -1;
@@ -266,28 +390,20 @@ MT_InitThreads(void)
         condMutex = g_mutex_new();
 #endif
     td.numThreads = 0;
+    td.fAffinity = FALSE;
+    td.fNUMA = FALSE;
 }
 
 extern void
 CloseThread(void *UNUSED(unused))
 {
     ThreadLocalData *pTLD;
-    NNState *pnnState;
 
     g_assert(MT_SafeCompare(&td.closingThreads, TRUE));
 
     pTLD = (ThreadLocalData *) TLSGet(td.tlsItem);
-    pnnState = pTLD->pnnState;
-
-    g_free(pTLD->aMoves);
-
-    for (int i = 0; i < 3; i++) {
-        g_free(pnnState[i].savedBase);
-        g_free(pnnState[i].savedIBase);
-    }
 
-    g_free(pnnState);
-    g_free(pTLD);
+    MT_FreeThreadLocalData(pTLD);
 
     MT_SafeInc(&td.result);
 }
@@ -382,19 +498,11 @@ MT_InitThreads(void)
 extern void
 MT_Close(void)
 {
-    int i;
-    NNState *pnnState;
-
     if (!td.tld)
         return;
 
     g_free(td.tld->aMoves);
-    pnnState = td.tld->pnnState;
-    for (i = 0; i < 3; i++) {
-        g_free(pnnState[i].savedBase);
-        g_free(pnnState[i].savedIBase);
-    }
-    g_free(pnnState);
+    FreeNNStates(td.tld->pnnState);
     g_free(td.tld);
 }
 
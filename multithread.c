@@ -25,6 +25,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <glib.h>
+#if defined(HAVE_SCHED_SETAFFINITY)
+#include <sched.h>
+#endif
 #if defined(USE_GTK)
 #include "gtkgame.h"
 #endif
@@ -37,7 +40,14 @@
 
 #if defined(USE_MULTITHREAD)
 
-static GThread* thread[MAX_NUMTHREADS];
+static GThread **thread;
+
+/* Processors the worker threads are pinned to, in turn */
+static unsigned int *aiCPU;
+static unsigned int cCPU;
+
+/* The threads being created flush their part of the evaluation cache */
+static int fFlushParts;
 
 extern unsigned int
 MT_GetNumThreads(void)
@@ -45,22 +55,130 @@ MT_GetNumThreads(void)
     return td.numThreads;
 }
 
+extern unsigned int
+MT_GetMaxThreads(void)
+{
+#if GLIB_CHECK_VERSION (2,36,0)
+    return MAX(MAX_NUMTHREADS, g_get_num_processors());
+#else
+    return MAX_NUMTHREADS;
+#endif
+}
+
 extern void
-MT_CloseThreads(void)
+MT_ResetLockWait(void)
+{
+    if (td.ausLockWait)
+        memset(td.ausLockWait, 0, (td.numThreads + 1) * sizeof(gint64));
+}
+
+/* Seconds the worker thread id, or the main thread if id is -1, has
+ * waited for locks since MT_ResetLockWait() */
+extern double
+MT_GetLockWait(int id)
+{
+    if (!td.ausLockWait || id >= (int) td.numThreads)
+        return 0.0;
+
+    return (double) td.ausLockWait[id < 0 ? (int) td.numThreads : id] / 1.0e6;
+}
+
+static void
+GetCPUs(void)
 {
     unsigned int i;
 
-    MT_SafeSet(&td.closingThreads, TRUE);
-    mt_add_tasks(td.numThreads, CloseThread, NULL, NULL);
-    if (MT_WaitForTasks(NULL, 0, FALSE) != (int) td.numThreads)
-        g_print(_("Error closing threads!\n"));
-    for (i = 0; i < td.numThreads; i++)
-        g_thread_join(thread[i]);
+    g_free(aiCPU);
+    aiCPU = NULL;
+    cCPU = 0;
+
+#if defined(HAVE_SCHED_SETAFFINITY)
+    {
+        cpu_set_t set;
+
+        if (sched_getaffinity(0, sizeof(set), &set) != 0)
+            return;
+
+        aiCPU = g_new(unsigned int, CPU_COUNT(&set));
+        for (i = 0; i < CPU_SETSIZE; i++)
+            if (CPU_ISSET(i, &set))
+                aiCPU[cCPU++] = i;
+    }
+#elif defined(WIN32)
+    {
+        DWORD_PTR dwProcess, dwSystem;
+
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &dwProcess, &dwSystem))
+            return;
+
+        aiCPU = g_new(unsigned int, 8 * sizeof(DWORD_PTR));
+        for (i = 0; i < 8 * sizeof(DWORD_PTR); i++)
+            if (dwProcess & ((DWORD_PTR) 1 << i))
+                aiCPU[cCPU++] = i;
+    }
+#else
+    (void) i;
+#endif
+}
+
+static void
+PinThread(unsigned int id)
+{
+    if (cCPU == 0)
+        return;
+
+#if defined(HAVE_SCHED_SETAFFINITY)
+    {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(aiCPU[id % cCPU], &set);
+        /* if this fails the thread just runs anywhere */
+        (void) sched_setaffinity(0, sizeof(set), &set);
+    }
+#elif defined(WIN32)
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << aiCPU[id % cCPU]);
+#endif
+}
+
+/* An MT_ParallelFor() in progress; lives on the stack of the calling thread */
+typedef struct {
+    ParallelFun fun;
+    void *data;
+    int n;
+    int next;                   /* next index to hand out */
+    int pending;                /* helpers queued or still running */
+    Task *aHelper;
+} ParallelFor;
+
+static void
+ParallelForRun(ParallelFor * ppf)
+{
+    int i;
+
+    while ((i = MT_SafeIncCheck(&ppf->next)) < ppf->n)
+        ppf->fun(ppf->data, (unsigned int) i);
+}
+
+static void
+ParallelForHelper(void *data)
+{
+    ParallelFor *ppf = (ParallelFor *) data;
+
+    ParallelForRun(ppf);
+    /* the caller may return as soon as this reaches zero */
+    MT_SafeDec(&ppf->pending);
 }
 
 static void
 MT_TaskDone(Task * pt)
 {
+    if (pt && pt->fun == ParallelForHelper) {
+        /* helper removed from the queue without running; not a counted task */
+        MT_SafeDec(&((ParallelFor *) pt->data)->pending);
+        return;
+    }
+
     MT_SafeInc(&td.doneTasks);
 
     if (pt) {
@@ -69,29 +187,183 @@ MT_TaskDone(Task * pt)
     }
 }
 
+/*
+ * Each worker thread has its own queue.  A worker takes the tasks of its
+ * own queue in order and, when that is empty, steals from the others.
+ * Tasks added by a worker (nested tasks) go to its own queue, tasks added
+ * by any other thread are dealt out over the queues in turn.
+ * td.queuedTasks counts the tasks in all queues; td.activity is set while
+ * it is positive, both changes being made under td.queueLock.
+ */
+
+static void
+QueueInit(TaskQueue * pq)
+{
+    InitMutex(&pq->lock);
+    pq->cAlloc = 16;
+    pq->apTask = g_new(Task *, pq->cAlloc);
+    pq->iFirst = 0;
+    pq->cTasks = 0;
+}
+
+static void
+QueueFree(TaskQueue * pq)
+{
+    g_free(pq->apTask);
+    FreeMutex(&pq->lock);
+}
+
+/* Add a task at the end of a queue; the queue must be locked */
+static void
+QueuePush(TaskQueue * pq, Task * pt)
+{
+    unsigned int c = (unsigned int) pq->cTasks;
+
+    if (c == pq->cAlloc) {
+        Task **apTask = g_new(Task *, 2 * pq->cAlloc);
+        unsigned int i;
+
+        for (i = 0; i < c; i++)
+            apTask[i] = pq->apTask[(pq->iFirst + i) % pq->cAlloc];
+        g_free(pq->apTask);
+        pq->apTask = apTask;
+        pq->cAlloc *= 2;
+        pq->iFirst = 0;
+    }
+
+    pq->apTask[(pq->iFirst + c) % pq->cAlloc] = pt;
+    MT_SafeInc(&pq->cTasks);
+}
+
+/* Take the first task of a queue, if any (and if it is a helper when fHelper is set) */
 static Task *
-MT_GetTask(void)
+QueuePop(TaskQueue * pq, int fHelper)
 {
-    Task *task = NULL;
+    Task *pt = NULL;
+
+    if (!MT_SafeGet(&pq->cTasks))
+        return NULL;
+
+    Mutex_Lock(&pq->lock);
+    if (pq->cTasks > 0) {
+        pt = pq->apTask[pq->iFirst];
+        if (!fHelper || pt->fun == ParallelForHelper) {
+            pq->iFirst = (pq->iFirst + 1) % pq->cAlloc;
+            MT_SafeDec(&pq->cTasks);
+        } else
+            pt = NULL;
+    }
+    Mutex_Release(&pq->lock);
+
+    return pt;
+}
+
+/* Take a given task out of a queue; returns FALSE if it is not there any more */
+static int
+QueueRemove(TaskQueue * pq, const Task * pt)
+{
+    unsigned int i, c;
+    int fFound = FALSE;
+
+    Mutex_Lock(&pq->lock);
+    c = (unsigned int) pq->cTasks;
+    for (i = 0; i < c; i++)
+        if (pq->apTask[(pq->iFirst + i) % pq->cAlloc] == pt)
+            break;
+    if (i < c) {
+        /* close the gap, keeping the order of the others */
+        for (; i + 1 < c; i++)
+            pq->apTask[(pq->iFirst + i) % pq->cAlloc] = pq->apTask[(pq->iFirst + i + 1) % pq->cAlloc];
+        MT_SafeDec(&pq->cTasks);
+        fFound = TRUE;
+    }
+    Mutex_Release(&pq->lock);
+
+    return fFound;
+}
+
+/* The queue new tasks of the calling thread go to */
+static TaskQueue *
+MT_SubmitQueue(void)
+{
+    int id = MT_GetThreadID();
+
+    if (id >= 0 && (unsigned int) id < td.numThreads)
+        return &td.aQueue[id];
+    else
+        return &td.aQueue[(unsigned int) MT_SafeIncCheck(&td.nextQueue) % td.numThreads];
+}
+
+static void
+TasksQueued(int n)
+{
+    MT_SafeAdd(&td.queuedTasks, n);
 
-    multi_debug("get task asks lock (queueLock)");
     Mutex_Lock(&td.queueLock);
-    multi_debug("get task gets lock (queueLock)");
+    SetManualEvent(td.activity);
+    Mutex_Release(&td.queueLock);
+}
 
-    if (g_list_length(td.tasks) > 0) {
-        task = (Task *) g_list_first(td.tasks)->data;
-        td.tasks = g_list_delete_link(td.tasks, g_list_first(td.tasks));
-        if (g_list_length(td.tasks) == 0) {
+static void
+TaskUnqueued(void)
+{
+    if (MT_SafeDecCheck(&td.queuedTasks)) {
+        Mutex_Lock(&td.queueLock);
+        /* another thread may have queued something in the meantime */
+        if (MT_SafeGet(&td.queuedTasks) == 0)
             ResetManualEvent(td.activity);
-        }
+        Mutex_Release(&td.queueLock);
     }
+}
 
-    Mutex_Release(&td.queueLock);
-    multi_debug("get task unlocks (queueLock)");
+static Task *
+MT_GetTaskFromQueues(int fHelper)
+{
+    Task *task = NULL;
+    int id = MT_GetThreadID();
+    unsigned int i, iFirst = (id >= 0) ? (unsigned int) id : 0;
+
+    if (!MT_SafeGet(&td.queuedTasks) || td.aQueue == NULL)
+        return NULL;
+
+    /* own queue first, then steal from the next ones */
+    for (i = 0; i < td.numThreads && !task; i++)
+        task = QueuePop(&td.aQueue[(iFirst + i) % td.numThreads], fHelper);
+
+    if (task)
+        TaskUnqueued();
 
     return task;
 }
 
+static Task *
+MT_GetTask(void)
+{
+    return MT_GetTaskFromQueues(FALSE);
+}
+
+extern void
+MT_CloseThreads(void)
+{
+    unsigned int i;
+
+    MT_SafeSet(&td.closingThreads, TRUE);
+    mt_add_tasks(td.numThreads, CloseThread, NULL, NULL);
+    if (MT_WaitForTasks(NULL, 0, FALSE) != (int) td.numThreads)
+        g_print(_("Error closing threads!\n"));
+    for (i = 0; i < td.numThreads; i++)
+        g_thread_join(thread[i]);
+    g_free(thread);
+    thread = NULL;
+
+    for (i = 0; i < td.numThreads; i++)
+        QueueFree(&td.aQueue[i]);
+    g_free(td.aQueue);
+    td.aQueue = NULL;
+    g_free(td.ausLockWait);
+    td.ausLockWait = NULL;
+}
+
 extern void
 MT_AbortTasks(void)
 {
@@ -104,7 +376,7 @@ MT_AbortTasks(void)
 }
 
 static SIMD_STACKALIGN gpointer
-MT_WorkerThreadFunction(void *tld)
+MT_WorkerThreadFunction(void *data)
 {
 #if 0
     /* why do we need this align ? - because of a gcc bug */
@@ -122,20 +394,38 @@ MT_WorkerThreadFunction(void *tld)
 
 #endif
     {
-        ThreadLocalData *pTLD = (ThreadLocalData *) tld;
+        unsigned int id = GPOINTER_TO_UINT(data);
+        ThreadLocalData *pTLD;
+        AsyncFun fun = NULL;
+
+        if (td.fAffinity)
+            PinThread(id);
+
+        /* Allocated here, so that it is in this thread's memory on NUMA
+         * systems (the pages go to the node of the thread first using them) */
+        pTLD = MT_CreateThreadLocalData((int) id);
         TLSSetValue(td.tlsItem, (size_t) pTLD);
 
+        if (fFlushParts)
+            EvalCacheFlushPart(id, td.numThreads);
+
         MT_SafeInc(&td.result);
         MT_TaskDone(NULL);      /* Thread created */
+        /* Each thread runs exactly one CloseThread task before leaving;
+         * closingThreads is set before they are queued */
         do {
             Task *task;
             WaitForManualEvent(td.activity);
             task = MT_GetTask();
             if (task) {
-                task->fun(task->data);
-                MT_TaskDone(task);
+                fun = task->fun;
+
+                fun(task->data);
+                /* a finished helper's task may be gone already */
+                if (fun != ParallelForHelper)
+                    MT_TaskDone(task);
             }
-        } while (MT_SafeCompare(&td.closingThreads, FALSE));
+        } while (fun != CloseThread);
 
 #if 0
 #if __GNUC__ && defined(WIN32)
@@ -167,13 +457,24 @@ MT_CreateThreads(void)
 #endif
     MT_SafeSet(&td.result, 0);
     MT_SafeSet(&td.closingThreads, FALSE);
-    for (i = 0; i < td.numThreads; i++) {
-        ThreadLocalData *pTLD = MT_CreateThreadLocalData(i);
+    td.aQueue = g_new(TaskQueue, td.numThreads);
+    for (i = 0; i < td.numThreads; i++)
+        QueueInit(&td.aQueue[i]);
+    thread = g_new(GThread *, td.numThreads);
+    td.ausLockWait = g_new0(gint64, td.numThreads + 1);
+
+    if (td.fAffinity)
+        GetCPUs();
+
+    /* Let each thread flush its part of the cache in new memory; a cache
+     * in a file stays where it is */
+    fFlushParts = td.fNUMA && EvalCacheReallocate() == 0;
 
+    for (i = 0; i < td.numThreads; i++) {
 #if GLIB_CHECK_VERSION (2,32,0)
-        if (!(thread[i] = g_thread_try_new(NULL, MT_WorkerThreadFunction, pTLD, NULL)))
+        if (!(thread[i] = g_thread_try_new(NULL, MT_WorkerThreadFunction, GUINT_TO_POINTER(i), NULL)))
 #else
-        if (!(thread[i] = g_thread_create(MT_WorkerThreadFunction, pTLD, TRUE, NULL)))
+        if (!(thread[i] = g_thread_create(MT_WorkerThreadFunction, GUINT_TO_POINTER(i), TRUE, NULL)))
 #endif
             printf(_("Failed to create thread\n"));
 #if defined(DEBUG_MULTITHREADED)
@@ -186,8 +487,12 @@ MT_CreateThreads(void)
     }
     td.addedTasks = td.numThreads;
     /* Wait for all the threads to be created (timeout after 1 second) */
-    if (MT_WaitForTasks(WaitingForThreads, 1000, FALSE) != (int) td.numThreads)
+    if (MT_WaitForTasks(WaitingForThreads, 1000, FALSE) != (int) td.numThreads) {
         g_print(_("Error creating threads!\n"));
+        if (fFlushParts)
+            EvalCacheFlushPart(0, 1);
+    }
+    fFlushParts = FALSE;
 }
 
 void
@@ -205,6 +510,8 @@ MT_SetNumThreads(unsigned int num)
             ScoreMove = ScoreMoveNoLocking;
             FindBestMove = FindBestMoveNoLocking;
             FindnSaveBestMoves = FindnSaveBestMovesNoLocking;
+            FillMovesCache = FillMovesCacheNoLocking;
+            FindBestMoves = FindBestMovesNoLocking;
             BasicCubefulRollout = BasicCubefulRolloutNoLocking;
         } else {                /* Locking version of evals */
             EvaluatePosition = EvaluatePositionWithLocking;
@@ -213,11 +520,30 @@ MT_SetNumThreads(unsigned int num)
             ScoreMove = ScoreMoveWithLocking;
             FindBestMove = FindBestMoveWithLocking;
             FindnSaveBestMoves = FindnSaveBestMovesWithLocking;
+            FillMovesCache = FillMovesCacheWithLocking;
+            FindBestMoves = FindBestMovesWithLocking;
             BasicCubefulRollout = BasicCubefulRolloutWithLocking;
         }
     }
 }
 
+/* Pin the worker threads to processors, and let each place its part of
+ * the evaluation cache in its own memory; running threads are restarted */
+extern void
+MT_SetPlacement(int fAffinity, int fNUMA)
+{
+    if (fAffinity == td.fAffinity && fNUMA == td.fNUMA)
+        return;
+
+    td.fAffinity = fAffinity;
+    td.fNUMA = fNUMA;
+
+    if (td.numThreads != 0) {
+        MT_CloseThreads();
+        MT_CreateThreads();
+    }
+}
+
 extern void
 MT_StartThreads(void)
 {
@@ -232,49 +558,130 @@ MT_StartThreads(void)
     }
 }
 
+/*
+ * The queues lock themselves; lock is kept for the callers that used to
+ * hold the single queue lock.  Tasks added from inside a task are counted
+ * like the others, so only the main thread should add them unless it
+ * waits for them with MT_WaitForTasks().
+ */
 void
 MT_AddTask(Task * pt, gboolean lock)
 {
-    if (lock) {
-        multi_debug("add task asks lock (queueLock)");
-        Mutex_Lock(&td.queueLock);
-        multi_debug("add task gets lock (queueLock)");
-    }
-    if (td.addedTasks == 0)
+    TaskQueue *pq = MT_SubmitQueue();
+
+    (void) lock;
+    if (MT_SafeIncCheck(&td.addedTasks) == 0)
         MT_SafeSet(&td.result, 0);          /* Reset result for new tasks */
-    td.addedTasks++;
-    td.tasks = g_list_append(td.tasks, pt);
-    if (g_list_length(td.tasks) == 1) { /* New tasks */
-        SetManualEvent(td.activity);
-    }
-    if (lock) {
-        Mutex_Release(&td.queueLock);
-        multi_debug("add task unlocks");
-    }
+
+    multi_debug("add task asks lock (queue)");
+    Mutex_Lock(&pq->lock);
+    QueuePush(pq, pt);
+    Mutex_Release(&pq->lock);
+    multi_debug("add task unlocks (queue)");
+
+    TasksQueued(1);
 }
 
 extern void
 mt_add_tasks(unsigned int num_tasks, AsyncFun pFun, void *taskData, gpointer linked)
 {
+    unsigned int i, j;
+    int id = MT_GetThreadID();
+    unsigned int iQueue = (id >= 0) ? (unsigned int) id : (unsigned int) MT_SafeIncCheck(&td.nextQueue);
+    /* a worker keeps its tasks, anyone else deals them out over all the queues */
+    unsigned int cQueues = (id >= 0) ? 1 : MIN(num_tasks, td.numThreads);
+
+    if (num_tasks == 0)
+        return;
+
+    if (MT_SafeGet(&td.addedTasks) == 0)
+        MT_SafeSet(&td.result, 0);          /* Reset result for new tasks */
+    MT_SafeAdd(&td.addedTasks, (int) num_tasks);
+
+    /* one lock per queue for the whole batch */
+    for (j = 0; j < cQueues; j++) {
+        TaskQueue *pq = &td.aQueue[(iQueue + j) % td.numThreads];
+
+        multi_debug("add tasks asks lock (queue)");
+        Mutex_Lock(&pq->lock);
+        for (i = j; i < num_tasks; i += cQueues) {
+            Task *pt = (Task *) g_malloc(sizeof(Task));
+            pt->fun = pFun;
+            pt->data = taskData;
+            pt->pLinkedTask = linked;
+            QueuePush(pq, pt);
+        }
+        Mutex_Release(&pq->lock);
+        multi_debug("add tasks unlocks (queue)");
+    }
+
+    TasksQueued((int) num_tasks);
+}
+
+/*
+ * Call fun(data, i) for every i below n, spreading the calls over the
+ * worker threads.  The calling thread takes its share of the work and
+ * returns when all calls have finished.  The helper tasks go to the
+ * caller's own queue for idle threads to steal and are not counted as
+ * tasks, so this may be used from inside a task and may be nested.
+ * While it waits for the last calls the caller helps other fan-outs.
+ */
+extern void
+MT_ParallelFor(unsigned int n, ParallelFun fun, void *data)
+{
+    ParallelFor pf;
+    Task aHelper[32];
+    TaskQueue *pq = NULL;
     unsigned int i;
-    {
-#if defined(DEBUG_MULTITHREADED)
-        multi_debug("add %u task%s asks lock (queueLock)", num_tasks, (num_tasks > 1 ? "s" : ""));
-        Mutex_Lock(&td.queueLock);
-        multi_debug("add tasks gets lock (queueLock)");
-#else
-        Mutex_Lock(&td.queueLock);
-#endif
+    unsigned int cHelpers = MIN(td.numThreads, n);
+
+    pf.fun = fun;
+    pf.data = data;
+    pf.n = (int) n;
+    pf.next = 0;
+    pf.pending = 0;
+    pf.aHelper = aHelper;
+
+    if (cHelpers > 1 && td.aQueue) {
+        cHelpers--;
+        pq = MT_SubmitQueue();
+        pf.aHelper = (cHelpers <= G_N_ELEMENTS(aHelper)) ? aHelper : g_new(Task, cHelpers);
+
+        Mutex_Lock(&pq->lock);
+        for (i = 0; i < cHelpers; i++) {
+            pf.aHelper[i].fun = ParallelForHelper;
+            pf.aHelper[i].data = &pf;
+            pf.aHelper[i].pLinkedTask = NULL;
+            QueuePush(pq, &pf.aHelper[i]);
+        }
+        pf.pending = (int) cHelpers;
+        Mutex_Release(&pq->lock);
+
+        TasksQueued((int) cHelpers);
     }
-    for (i = 0; i < num_tasks; i++) {
-        Task *pt = (Task *) g_malloc(sizeof(Task));
-        pt->fun = pFun;
-        pt->data = taskData;
-        pt->pLinkedTask = linked;
-        MT_AddTask(pt, FALSE);
+
+    ParallelForRun(&pf);
+
+    if (MT_SafeGet(&pf.pending)) {
+        /* take back the helpers no thread has picked up yet */
+        for (i = 0; i < cHelpers; i++)
+            if (QueueRemove(pq, &pf.aHelper[i])) {
+                MT_SafeDec(&pf.pending);
+                TaskUnqueued();
+            }
+
+        while (MT_SafeGet(&pf.pending)) {
+            Task *task = MT_GetTaskFromQueues(TRUE);
+
+            if (task)
+                task->fun(task->data);
+            else
+                g_thread_yield();
+        }
     }
-    Mutex_Release(&td.queueLock);
-    multi_debug("add tasks unlocks (queueLock)");
+
+    if (pq && pf.aHelper != aHelper)
+        g_free(pf.aHelper);
 }
 
 static gboolean
@@ -493,6 +900,15 @@ MT_GetDoneTasks(void)
     return MT_SafeGet(&td.doneTasks);
 }
 
+extern void
+MT_ParallelFor(unsigned int n, ParallelFun fun, void *data)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++)
+        fun(data, i);
+}
+
 int
 MT_WaitForTasks(gboolean(*pCallback) (gpointer), int callbackTime, int autosave)
 {
@@ -59,6 +59,9 @@ typedef struct {
     matchstate ms;
 } AnalyseMoveTask;
 
+/* Body of MT_ParallelFor(); called once for every index below n */
+typedef void (*ParallelFun) (void *data, unsigned int i);
+
 typedef struct {
     int id;
     move *aMoves;
@@ -82,6 +85,15 @@ typedef GMutex Mutex;
 typedef GMutex *Mutex;
 #endif
 
+/* Tasks queued for one worker thread, kept in a ring buffer */
+typedef struct {
+    Mutex lock;
+    Task **apTask;
+    unsigned int cAlloc;
+    unsigned int iFirst;
+    int cTasks;
+} TaskQueue;
+
 typedef struct {
     GList *tasks;
     int doneTasks;
@@ -90,6 +102,9 @@ typedef struct {
 
 #if defined(USE_MULTITHREAD)
     ManualEvent activity;
+    TaskQueue *aQueue;          /* one per worker thread */
+    int queuedTasks;
+    int nextQueue;
     TLSItem tlsItem;
     Mutex queueLock;
     Mutex multiLock;
@@ -101,6 +116,10 @@ typedef struct {
 
     int closingThreads;
     unsigned int numThreads;
+    int fAffinity;              /* pin each worker thread to a processor */
+    int fNUMA;                  /* workers place their part of the cache */
+    gint64 *ausLockWait;        /* microseconds each worker thread, and last
+                                 * the main thread, waited in Mutex_Lock() */
 #endif
 } ThreadData;
 
@@ -114,6 +133,9 @@ extern void MT_Close(void);
 extern void MT_CloseThreads(void);
 extern void CloseThread(void *unused);
 extern ThreadLocalData *MT_CreateThreadLocalData(int id);
+extern void MT_FreeThreadLocalData(ThreadLocalData * tld);
+extern void MT_ParallelFor(unsigned int n, ParallelFun fun, void *data);
+extern void MT_ParallelForThreads(unsigned int n, ParallelFun fun, void *data, unsigned int nThreads);
 
 extern ThreadData td;
 
@@ -132,6 +154,8 @@ extern void FreeMutex(Mutex * mutex);
 
 #define TLSGet(item) *((size_t*)g_private_get(item))
 
+/* The number of threads can be raised to the number of processors,
+ * and on smaller machines to this */
 #if !defined(MAX_NUMTHREADS)
 #define MAX_NUMTHREADS 48
 #endif
@@ -140,12 +164,16 @@ extern void MT_Release(void);
 extern void MT_Exclusive(void);
 extern void MT_StartThreads(void);
 extern void MT_SetNumThreads(unsigned int num);
+extern void MT_SetPlacement(int fAffinity, int fNUMA);
 extern void MT_SyncInit(void);
 extern void MT_SyncStart(void);
 extern double MT_SyncEnd(void);
 extern void MT_SetResultFailed(void);
 extern void TLSCreate(TLSItem * pItem);
 extern unsigned int MT_GetNumThreads(void);
+extern unsigned int MT_GetMaxThreads(void);
+extern void MT_ResetLockWait(void);
+extern double MT_GetLockWait(int id);
 
 #define MT_GetTLD() ((ThreadLocalData *)TLSGet(td.tlsItem))
 #define MT_GetThreadID() ((ThreadLocalData *)TLSGet(td.tlsItem))->id
@@ -179,6 +207,9 @@ extern int asyncRet;
 #define MT_Exclusive() {}
 #define MT_Release() {}
 #define MT_GetNumThreads() 1
+#define MT_GetMaxThreads() 1
+#define MT_ResetLockWait() {}
+#define MT_GetLockWait(x) 0.0
 #define MT_SetResultFailed() asyncRet = -1
 #define MT_SafeInc(x) (++(*x))
 #define MT_SafeIncValue(x) (++(*x))
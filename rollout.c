@@ -37,6 +37,7 @@
 #include "format.h"
 #include "multithread.h"
 #include "rollout.h"
+#include "rolloutnet.h"
 #include "lib/simd.h"
 
 #define LogCubeClamped(n) (n < (1 << STAT_MAXCUBE) ? LogCube(n) : (STAT_MAXCUBE - 1))
@@ -47,28 +48,72 @@ f_BasicCubefulRollout BasicCubefulRollout = BasicCubefulRolloutNoLocking;
 #define BasicCubefulRollout BasicCubefulRolloutNoLocking
 
 int log_rollouts = 0;
+unsigned int nRolloutBatch = 1;
+int fRolloutAdaptive = FALSE;
+int fRolloutCubeStop = FALSE;
+float rRolloutCubeLimit = 2.33f;
 char *log_file_name = 0;
+char *szRolloutJournal = NULL;
 static unsigned int initial_game_count;
 
-/* make sgf files of rollouts if log_rollouts is true and we have a file
- * name template to work with
- */
+/* With log_rollouts set and a file name to work with, the games rolled
+ * out are kept in one trace file per rollout, see TraceOpen(); "rollout
+ * trace" turns the games of a trial into .sgf files.  The plays of a
+ * game are collected by log_cube() and log_move() as fixed size
+ * records. */
+
+typedef enum {
+    TRACE_MOVE,
+    TRACE_TAKE,
+    TRACE_DROP
+} tracetype;
+
+typedef struct {
+    guint8 nType;               /* tracetype << 1 | side */
+    guint8 nDice;               /* 16 * die0 + die1 */
+    gint8 anMove[8];            /* as from FindBestMove() */
+} tracerecord;
 
 extern void
-log_cube(FILE * logfp, const char *action, int side)
+log_cube(GArray * paTrace, int side, int fTake)
 {
-    if (!logfp)
+    tracerecord tr;
+
+    if (!paTrace)
         return;
-    fprintf(logfp, ";%s[%s]\n", side ? "B" : "W", action);
+
+    memset(&tr, 0, sizeof(tr));
+    tr.nType = (guint8) (((fTake ? TRACE_TAKE : TRACE_DROP) << 1) | (side ? 1 : 0));
+    g_array_append_val(paTrace, tr);
 }
 
 extern void
-log_move(FILE * logfp, const int *anMove, int side, int die0, int die1)
+log_move(GArray * paTrace, const int *anMove, int side, int die0, int die1)
 {
+    tracerecord tr;
     int i;
-    if (!logfp)
+
+    if (!paTrace)
         return;
 
+    tr.nType = (guint8) ((TRACE_MOVE << 1) | (side ? 1 : 0));
+    tr.nDice = (guint8) (16 * die0 + die1);
+    for (i = 0; i < 8; i++)
+        tr.anMove[i] = (gint8) anMove[i];
+    g_array_append_val(paTrace, tr);
+}
+
+static void
+sgf_cube(FILE * logfp, const char *action, int side)
+{
+    fprintf(logfp, ";%s[%s]\n", side ? "B" : "W", action);
+}
+
+static void
+sgf_move(FILE * logfp, const int *anMove, int side, int die0, int die1)
+{
+    int i;
+
     fprintf(logfp, ";%s[%d%d", side ? "B" : "W", die0, die1);
 
     for (i = 0; i < 8; i += 2) {
@@ -115,7 +160,7 @@ board_to_sgf(FILE * logfp, const unsigned int anBoard[25], int direction)
 }
 
 static FILE *
-log_game_start(const char *name, const cubeinfo * pci, int fCubeful, TanBoard anBoard)
+log_game_start(const char *name, const cubeinfo * pci, int fCubeful, ConstTanBoard anBoard)
 {
     time_t t = time(0);
 #if defined(USE_MULTITHREAD) && defined(HAVE_LOCALTIME_R)
@@ -144,7 +189,7 @@ log_game_start(const char *name, const cubeinfo * pci, int fCubeful, TanBoard an
         if (!fCubeful) {
             rule = "RU[NoCube:Crawford]";
         } else if (fAutoCrawford) {
-            rule = (ms.fCrawford) ? "RU[Crawford:CrawfordGame]" : "RU[Crawford]";
+            rule = (pci->fCrawford) ? "RU[Crawford:CrawfordGame]" : "RU[Crawford]";
         } else {
             rule = "";
         }
@@ -300,545 +345,621 @@ static volatile unsigned int initial_game_count;
 static void initRolloutstat(rolloutstat * prs);
 #endif
 
-/* called with
- * cube decision                  move rollout
- * aanBoard       2 copies of same board         1 board
- * aarOutput      2 arrays for eval              1 array
- * iTurn          player on roll                 same
- * iGame          game number                    same
- * cubeinfo       2 structs for double/nodouble  1 cubeinfo
- * or take/pass
- * CubeDecTop     array of 2 boolean             1 boolean
- * (TRUE if a cube decision is valid on turn 0)
- * cci            2 (number of rollouts to do)   1
- * prc            1 rollout context              same
- * aarsStatistics 2 arrays of stats for the      NULL
- * two alternatives of
- * cube rollouts
- *
- * returns -1 on error/interrupt, fInterrupt TRUE if stopped by user
- * aarOutput array(s) contain results
- */
+/* The evaluations a rollout plays with, shared by the games it plays */
+typedef struct {
+    rolloutcontext *prc;
+    int nLateEvals;
+    /* variance reduction: the moves for all 21 rolls are found on ply 0
+     * and evaluated one ply less than the chequer play */
+    evalcontext aecZero[2];
+    evalcontext aecVarRedn[2];
+    /* the evaluations for the turn being played, see SetRolloutTurn() */
+    evalcontext *apecCube[2];
+    evalcontext *apecChequer[2];
+    movefilter(*aaamf)[MAX_FILTER_PLIES][MAX_FILTER_PLIES];
+} rolloutevals;
+
+/* One game of a rollout */
+typedef struct {
+    unsigned int (*anBoard)[25];
+    float *arOutput;
+    const cubeinfo *pciStart;   /* the cube the game started with */
+    cubeinfo ci;                /* local copy, modified by doubles */
+    int fCubeDecTop;
+    rolloutstat *ars;           /* statistics for each side, or NULL */
+    GArray *paTrace;            /* tracerecords of the game, or NULL */
+    int fPlaying;
+    float arVarRedn[NUM_ROLLOUT_OUTPUTS];
+    int afHit[2];
+    int afClosedOut[2];
+} rolloutgame;
 
-extern int
-BasicCubefulRollout(unsigned int aanBoard[][2][25],
-                    float aarOutput[][NUM_ROLLOUT_OUTPUTS],
-                    int iTurn, int iGame,
-                    const cubeinfo aci[], int afCubeDecTop[], unsigned int cci,
-                    rolloutcontext * prc,
-                    rolloutstat aarsStatistics[][2],
-                    int nBasisCube, perArray * dicePerms, rngcontext * rngctxRollout, FILE * logfp)
+static void
+InitRolloutEvals(rolloutevals * pre, rolloutcontext * prc)
 {
+    int i;
 
-    unsigned int anDice[2];
-    unsigned int cUnfinished = cci;
-    cubeinfo *pci;
-    cubedecision cd;
-    int *pf;
-    unsigned int i, j, k, ici;
-    evalcontext ec;
-
-    positionclass pc, pcBefore;
-    unsigned int nPipsBefore = 0, nPipsAfter, nPipsDice;
-    unsigned int anPips[2];
-    int afClosedBoard[2];
-
-    float arDouble[NUM_CUBEFUL_OUTPUTS];
-    float aar[2][NUM_ROLLOUT_OUTPUTS];
-
-    unsigned int aiBar[2];
-
-    int afClosedOut[2] = { FALSE, FALSE };
-    int afHit[2] = { FALSE, FALSE };
-
-    float rDP;
-    float r;
+    pre->prc = prc;
+    pre->nLateEvals = prc->fLateEvals ? prc->nLate : 0x7fffffff;
 
-    int nTruncate = prc->fDoTruncate ? prc->nTruncate : 0x7fffffff;
+    /*
+     * Create evaluation context one ply deep
+     */
 
-    int nLateEvals = prc->fLateEvals ? prc->nLate : 0x7fffffff;
+    for (i = 0; i < 2; i++) {
+        pre->aecZero[i] = pre->aecVarRedn[i] = prc->aecChequer[i];
+        pre->aecZero[i].nPlies = 0;
+        if (pre->aecVarRedn[i].nPlies)
+            pre->aecVarRedn[i].nPlies--;
+        pre->aecZero[i].fDeterministic = pre->aecVarRedn[i].fDeterministic = 1;
+        pre->aecZero[i].rNoise = pre->aecVarRedn[i].rNoise = 0.0f;
+    }
+}
 
-    int useVarRedn = prc->fVarRedn;
+static void
+SetRolloutTurn(rolloutevals * pre, int iTurn)
+{
+    rolloutcontext *prc = pre->prc;
+
+    if (iTurn < pre->nLateEvals) {
+        pre->apecCube[0] = prc->aecCube;
+        pre->apecCube[1] = prc->aecCube + 1;
+        pre->apecChequer[0] = prc->aecChequer;
+        pre->apecChequer[1] = prc->aecChequer + 1;
+        pre->aaamf = prc->aaamfChequer;
+    } else {
+        pre->apecCube[0] = prc->aecCubeLate;
+        pre->apecCube[1] = prc->aecCubeLate + 1;
+        pre->apecChequer[0] = prc->aecChequerLate;
+        pre->apecChequer[1] = prc->aecChequerLate + 1;
+        pre->aaamf = prc->aaamfLate;
+    }
+}
 
+static void
+InitRolloutGame(rolloutgame * prg, unsigned int anBoard[2][25], float arOutput[NUM_ROLLOUT_OUTPUTS],
+                const cubeinfo * pci, int fCubeDecTop, rolloutstat ars[2], GArray * paTrace)
+{
+    prg->anBoard = anBoard;
+    prg->arOutput = arOutput;
+    prg->pciStart = pci;
     /* Make local copy of cubeinfo struct, since it
      * may be modified */
-    cubeinfo *pciLocal = g_alloca(cci * sizeof(cubeinfo));
-    int *pfFinished = g_alloca(cci * sizeof(int));
-    float (*aarVarRedn)[NUM_ROLLOUT_OUTPUTS] = g_alloca(cci * NUM_ROLLOUT_OUTPUTS * sizeof(float));
+    memcpy(&prg->ci, pci, sizeof(cubeinfo));
+    prg->fCubeDecTop = fCubeDecTop;
+    prg->ars = ars;
+    prg->paTrace = paTrace;
+    prg->fPlaying = TRUE;
+    memset(prg->arVarRedn, 0, sizeof(prg->arVarRedn));
+    prg->afHit[0] = prg->afHit[1] = FALSE;
+    prg->afClosedOut[0] = prg->afClosedOut[1] = FALSE;
+}
 
-    /* variables for variance reduction */
+/* The cube decision of the player on roll, after checking for
+ * truncation at the bearoff databases; clears prg->fPlaying if that
+ * ends the game */
 
-    evalcontext aecVarRedn[2];
-    evalcontext aecZero[2];
-    float arMean[NUM_ROLLOUT_OUTPUTS];
-    unsigned int aaanBoard[6][6][2][25];
-    int aanMoves[6][6][8];
-#if defined(USE_SIMD_INSTRUCTIONS)
-#define NUM_ROLLOUT_OUTPUTS_PADDED (NUM_ROLLOUT_OUTPUTS + VEC_SIZE - (NUM_ROLLOUT_OUTPUTS % VEC_SIZE))
-    SSE_ALIGN(float aaar[6][6][NUM_ROLLOUT_OUTPUTS_PADDED]);
-#else
-    float aaar[6][6][NUM_ROLLOUT_OUTPUTS];
-#endif
+static int
+RolloutCube(const rolloutevals * pre, rolloutgame * prg, int iTurn)
+{
+    const rolloutcontext *prc = pre->prc;
+    cubeinfo *pci = &prg->ci;
+    float *arOutput = prg->arOutput;
+    positionclass pc;
+    cubedecision cd;
+    float arDouble[NUM_CUBEFUL_OUTPUTS];
+    float aar[2][NUM_ROLLOUT_OUTPUTS];
+    float rDP;
+    unsigned int i;
 
     evalcontext ecCubeless0ply = { .fCubeful = FALSE, .nPlies = 0, .fUsePrune = FALSE, .fDeterministic = TRUE, .rNoise = 0.0f };
     evalcontext ecCubeful0ply = { .fCubeful = TRUE, .nPlies = 0, .fUsePrune = FALSE, .fDeterministic = TRUE, .rNoise = 0.0f };
 
-    /* local pointers to the eval contexts to use */
-    evalcontext *pecCube[2], *pecChequer[2];
+    /* check for truncation at bearoff databases */
 
-    if (useVarRedn) {
+    pc = ClassifyPosition((ConstTanBoard) prg->anBoard, pci->bgv);
 
-        /*
-         * Create evaluation context one ply deep
-         */
+    if (prc->fTruncBearoff2 && pc <= CLASS_PERFECT &&
+        prc->fCubeful && !pci->nMatchTo && ((prg->fCubeDecTop && !prc->fInitial) || iTurn > 0)) {
 
-        for (ici = 0; ici < cci; ici++)
-            for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
-                aarVarRedn[ici][i] = 0.0f;
+        /* truncate at two sided bearoff if money game */
 
-        for (i = 0; i < 2; i++) {
-            aecZero[i] = aecVarRedn[i] = prc->aecChequer[i];
-            aecZero[i].nPlies = 0;
-            if (aecVarRedn[i].nPlies)
-                aecVarRedn[i].nPlies--;
-            aecZero[i].fDeterministic = aecVarRedn[i].fDeterministic = 1;
-            aecZero[i].rNoise = aecVarRedn[i].rNoise = 0.0f;
-        }
+        if (GeneralEvaluationE(arOutput, (ConstTanBoard) prg->anBoard, pci, &ecCubeful0ply) < 0)
+            return -1;
 
-    }
+        if (iTurn & 1)
+            InvertEvaluationR(arOutput, pci);
 
-    for (ici = 0; ici < cci; ici++)
-        pfFinished[ici] = TRUE;
+        prg->fPlaying = FALSE;
+        return 0;
 
-    memcpy(pciLocal, aci, cci * sizeof(cubeinfo));
+    } else if (((prc->fTruncBearoff2 && pc <= CLASS_PERFECT) ||
+                (prc->fTruncBearoffOS && pc <= CLASS_BEAROFF_OS)) && !prc->fCubeful) {
 
-    while ((!nTruncate || iTurn < nTruncate) && cUnfinished) {
-        if (iTurn < nLateEvals) {
-            pecCube[0] = prc->aecCube;
-            pecCube[1] = prc->aecCube + 1;
-            pecChequer[0] = prc->aecChequer;
-            pecChequer[1] = prc->aecChequer + 1;
-        } else {
-            pecCube[0] = prc->aecCubeLate;
-            pecCube[1] = prc->aecCubeLate + 1;
-            pecChequer[0] = prc->aecChequerLate;
-            pecChequer[1] = prc->aecChequerLate + 1;
-        }
+        /* cubeless rollout, requested to truncate at bearoff db */
 
-        /* Cube decision */
+        if (GeneralEvaluationE(arOutput, (ConstTanBoard) prg->anBoard, pci, &ecCubeless0ply) < 0)
+            return -1;
 
-        for (ici = 0, pci = pciLocal, pf = pfFinished; ici < cci; ici++, pci++, pf++) {
+        /* rollout result is for player on play (even iTurn).
+         * This point is pre play, so if opponent is on roll, invert */
 
-            /* check for truncation at bearoff databases */
+        if (iTurn & 1)
+            InvertEvaluationR(arOutput, pci);
 
-            pc = ClassifyPosition((ConstTanBoard) aanBoard[ici], pci->bgv);
+        prg->fPlaying = FALSE;
+        return 0;
 
-            if (prc->fTruncBearoff2 && pc <= CLASS_PERFECT &&
-                prc->fCubeful && *pf && !pci->nMatchTo && ((afCubeDecTop[ici] && !prc->fInitial) || iTurn > 0)) {
+    }
 
-                /* truncate at two sided bearoff if money game */
+    if (!prc->fCubeful || !GetDPEq(NULL, &rDP, pci) || !(iTurn > 0 || (prg->fCubeDecTop && !prc->fInitial)))
+        return 0;
 
-                if (GeneralEvaluationE(aarOutput[ici], (ConstTanBoard) aanBoard[ici], pci, &ecCubeful0ply) < 0)
-                    return -1;
+    if (GeneralCubeDecisionE(aar, (ConstTanBoard) prg->anBoard, pci, pre->apecCube[pci->fMove], 0) < 0)
+        return -1;
 
-                if (iTurn & 1)
-                    InvertEvaluationR(aarOutput[ici], pci);
+    cd = FindCubeDecision(arDouble, aar, pci);
 
-                *pf = FALSE;
-                cUnfinished--;
+    switch (cd) {
 
-            } else if (((prc->fTruncBearoff2 && pc <= CLASS_PERFECT) ||
-                        (prc->fTruncBearoffOS && pc <= CLASS_BEAROFF_OS)) && !prc->fCubeful && *pf) {
+    case DOUBLE_TAKE:
+    case DOUBLE_BEAVER:
+    case REDOUBLE_TAKE:
+        log_cube(prg->paTrace, pci->fMove, TRUE);
 
-                /* cubeless rollout, requested to truncate at bearoff db */
+        /* update statistics */
+        if (prg->ars)
+            MT_SafeInc(&prg->ars[pci->fMove].acDoubleTake[LogCubeClamped(pci->nCube)]);
 
-                if (GeneralEvaluationE(aarOutput[ici], (ConstTanBoard) aanBoard[ici], pci, &ecCubeless0ply) < 0)
-                    return -1;
+        SetCubeInfo(pci, 2 * pci->nCube, !pci->fMove, pci->fMove, pci->nMatchTo,
+                    pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
+
+        break;
 
-                /* rollout result is for player on play (even iTurn).
-                 * This point is pre play, so if opponent is on roll, invert */
+    case DOUBLE_PASS:
+    case REDOUBLE_PASS:
+        log_cube(prg->paTrace, pci->fMove, FALSE);
 
-                if (iTurn & 1)
-                    InvertEvaluationR(aarOutput[ici], pci);
+        prg->fPlaying = FALSE;
 
-                *pf = FALSE;
-                cUnfinished--;
+        /* assign outputs */
 
-            }
+        for (i = 0; i <= OUTPUT_EQUITY; i++)
+            arOutput[i] = aar[0][i];
 
-            if (*pf) {
+        /*
+         * assign equity for double, pass:
+         * - mwc for match play
+         * - normalized equity for money play (i.e, rDP=1)
+         */
 
-                if (prc->fCubeful && GetDPEq(NULL, &rDP, pci) && (iTurn > 0 || (afCubeDecTop[ici] && !prc->fInitial))) {
+        arOutput[OUTPUT_CUBEFUL_EQUITY] = rDP;
 
-                    if (GeneralCubeDecisionE(aar, (ConstTanBoard) aanBoard[ici], pci, pecCube[pci->fMove], 0) < 0)
-                        return -1;
+        /* invert evaluations if required */
 
-                    cd = FindCubeDecision(arDouble, aar, pci);
+        if (iTurn & 1)
+            InvertEvaluationR(arOutput, pci);
 
-                    switch (cd) {
+        /* update statistics */
 
-                    case DOUBLE_TAKE:
-                    case DOUBLE_BEAVER:
-                    case REDOUBLE_TAKE:
-                        if (logfp) {
-                            log_cube(logfp, "double", pci->fMove);
-                            log_cube(logfp, "take", !pci->fMove);
-                        }
+        if (prg->ars) {
+            MT_SafeInc(&prg->ars[pci->fMove].acDoubleDrop[LogCubeClamped(pci->nCube)]);
+            MT_SafeInc(&prg->ars[pci->fMove].acWin[LogCubeClamped(pci->nCube)]);
+        }
 
-                        /* update statistics */
-                        if (aarsStatistics)
-                            MT_SafeInc(&aarsStatistics[ici][pci->fMove].acDoubleTake[LogCubeClamped(pci->nCube)]);
+        break;
 
-                        SetCubeInfo(pci, 2 * pci->nCube, !pci->fMove, pci->fMove, pci->nMatchTo,
-                                    pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
+    case NODOUBLE_TAKE:
+    case TOOGOOD_TAKE:
+    case TOOGOOD_PASS:
+    case NODOUBLE_BEAVER:
+    case NO_REDOUBLE_TAKE:
+    case TOOGOODRE_TAKE:
+    case TOOGOODRE_PASS:
+    case NO_REDOUBLE_BEAVER:
+    case OPTIONAL_DOUBLE_BEAVER:
+    case OPTIONAL_DOUBLE_TAKE:
+    case OPTIONAL_REDOUBLE_TAKE:
+    case OPTIONAL_DOUBLE_PASS:
+    case OPTIONAL_REDOUBLE_PASS:
+    case NODOUBLE_DEADCUBE:
+    case NO_REDOUBLE_DEADCUBE:
+    case NOT_AVAILABLE:
+    default:
+
+        /* no op */
+        break;
 
-                        break;
+    }
 
-                    case DOUBLE_PASS:
-                    case REDOUBLE_PASS:
-                        if (logfp) {
-                            log_cube(logfp, "double", pci->fMove);
-                            log_cube(logfp, "drop", !pci->fMove);
-                        }
+    return 0;
+}
 
-                        *pf = FALSE;
-                        cUnfinished--;
+/* The chequer play of the player on roll with anDice, including the
+ * variance reduction terms; clears prg->fPlaying if the game is over */
 
-                        /* assign outputs */
+static int
+RolloutChequer(rolloutevals * pre, rolloutgame * prg, int iTurn, const unsigned int anDice[2])
+{
+    const rolloutcontext *prc = pre->prc;
+    cubeinfo *pci = &prg->ci;
+    float *arOutput = prg->arOutput;
+    unsigned int i, j, k;
+    positionclass pc, pcBefore;
+    unsigned int nPipsBefore = 0, nPipsAfter, nPipsDice;
+    unsigned int anPips[2];
+    int afClosedBoard[2];
+    unsigned int aiBar[2];
+    float r;
 
-                        for (i = 0; i <= OUTPUT_EQUITY; i++)
-                            aarOutput[ici][i] = aar[0][i];
+    /* variables for variance reduction */
 
-                        /*
-                         * assign equity for double, pass:
-                         * - mwc for match play
-                         * - normalized equity for money play (i.e, rDP=1)
-                         */
+    float arMean[NUM_ROLLOUT_OUTPUTS];
+    unsigned int aaanBoard[6][6][2][25];
+    int aanMoves[6][6][8];
+#if defined(USE_SIMD_INSTRUCTIONS)
+#define NUM_ROLLOUT_OUTPUTS_PADDED (NUM_ROLLOUT_OUTPUTS + VEC_SIZE - (NUM_ROLLOUT_OUTPUTS % VEC_SIZE))
+    SSE_ALIGN(float aaar[6][6][NUM_ROLLOUT_OUTPUTS_PADDED]);
+#else
+    float aaar[6][6][NUM_ROLLOUT_OUTPUTS];
+#endif
 
-                        aarOutput[ici][OUTPUT_CUBEFUL_EQUITY] = rDP;
+    /* Save number of chequers on bar */
 
-                        /* invert evaluations if required */
+    for (i = 0; i < 2; i++)
+        aiBar[i] = prg->anBoard[i][24];
 
-                        if (iTurn & 1)
-                            InvertEvaluationR(aarOutput[ici], pci);
+    /* Save number of pips (for bearoff only) */
 
-                        /* update statistics */
+    pcBefore = ClassifyPosition((ConstTanBoard) prg->anBoard, pci->bgv);
+    if (prg->ars && pcBefore <= CLASS_BEAROFF1) {
+        PipCount((ConstTanBoard) prg->anBoard, anPips);
+        nPipsBefore = anPips[1];
+    }
 
-                        if (aarsStatistics) {
-                            MT_SafeInc(&aarsStatistics[ici][pci->fMove].acDoubleDrop[LogCubeClamped(pci->nCube)]);
-                            MT_SafeInc(&aarsStatistics[ici][pci->fMove].acWin[LogCubeClamped(pci->nCube)]);
-                        }
+    /* Find best move :-) */
 
-                        break;
+    if (prc->fVarRedn) {
 
-                    case NODOUBLE_TAKE:
-                    case TOOGOOD_TAKE:
-                    case TOOGOOD_PASS:
-                    case NODOUBLE_BEAVER:
-                    case NO_REDOUBLE_TAKE:
-                    case TOOGOODRE_TAKE:
-                    case TOOGOODRE_PASS:
-                    case NO_REDOUBLE_BEAVER:
-                    case OPTIONAL_DOUBLE_BEAVER:
-                    case OPTIONAL_DOUBLE_TAKE:
-                    case OPTIONAL_REDOUBLE_TAKE:
-                    case OPTIONAL_DOUBLE_PASS:
-                    case OPTIONAL_REDOUBLE_PASS:
-                    case NODOUBLE_DEADCUBE:
-                    case NO_REDOUBLE_DEADCUBE:
-                    case NOT_AVAILABLE:
-                    default:
+        /* Variance reduction */
 
-                        /* no op */
-                        break;
+        TanBoard aanRollBoard[21];
+        unsigned int aanRollDice[21][2];
+        int aanRollMove[21][8];
+        unsigned int n = 0;
 
-                    }
-                }               /* cube */
+        for (i = 0; i < 6; i++)
+            for (j = 0; j <= i; j++) {
+                if (prc->fInitial && !iTurn && j == i)
+                    /* no doubles possible for first roll when rolling
+                     * out as initial position */
+                    continue;
+                aanRollDice[n][0] = i + 1;
+                aanRollDice[n++][1] = j + 1;
             }
-        }                       /* loop over ci */
 
-        /* Chequer play */
+        /* Find the best move for each roll on ply 0 only, with the
+         * candidate moves of all of them evaluated together */
 
-        if (RolloutDice(iTurn, iGame, prc->fInitial, anDice,
-                        &prc->rngRollout, rngctxRollout, prc->fRotate, dicePerms) < 0)
+        if (FindBestMoves(aanRollMove, aanRollBoard, (const unsigned int (*)[2]) aanRollDice, n,
+                          (ConstTanBoard) prg->anBoard, pci, &pre->aecZero[pci->fMove]) < 0)
             return -1;
 
-        if (anDice[0] < anDice[1])
-            swap_us(anDice, anDice + 1);
-
+        for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
+            arMean[i] = 0.0f;
 
-        for (ici = 0, pci = pciLocal, pf = pfFinished; ici < cci; ici++, pci++, pf++) {
+        for (n = 0, i = 0; i < 6; i++)
+            for (j = 0; j <= i; j++) {
 
-            if (*pf) {
+                if (prc->fInitial && !iTurn && j == i)
+                    continue;
 
-                /* Save number of chequers on bar */
+                memcpy(aanMoves[i][j], aanRollMove[n], sizeof(aanMoves[i][j]));
+                memcpy(aaanBoard[i][j], aanRollBoard[n++], sizeof(TanBoard));
 
-                for (i = 0; i < 2; i++)
-                    aiBar[i] = aanBoard[ici][i][24];
+                SwapSides(aaanBoard[i][j]);
 
-                /* Save number of pips (for bearoff only) */
+                /* re-evaluate the chosen move at ply n-1 */
 
-                pcBefore = ClassifyPosition((ConstTanBoard) aanBoard[ici], pci->bgv);
-                if (aarsStatistics && pcBefore <= CLASS_BEAROFF1) {
-                    PipCount((ConstTanBoard) aanBoard[ici], anPips);
-                    nPipsBefore = anPips[1];
-                }
+                pci->fMove = !pci->fMove;
+                if (GeneralEvaluationE(aaar[i][j],
+                                       (ConstTanBoard) aaanBoard[i][j], pci, &pre->aecVarRedn[pci->fMove]) < 0)
+                    return -1;
+                pci->fMove = !pci->fMove;
 
-                /* Find best move :-) */
+                if (!(iTurn & 1))
+                    InvertEvaluationR(aaar[i][j], pci);
 
-                if (useVarRedn) {
+                /* Calculate arMean: the n-ply evaluation of the position */
 
-                    /* Variance reduction */
+                for (k = 0; k < NUM_ROLLOUT_OUTPUTS; k++)
+                    arMean[k] += ((i == j) ? aaar[i][j][k] : (aaar[i][j][k] * 2.0f));
 
-                    for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
-                        arMean[i] = 0.0f;
+            }
 
-                    for (i = 0; i < 6; i++)
-                        for (j = 0; j <= i; j++) {
+        if (prc->fInitial && !iTurn)
+            /* no doubles ... */
+            for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
+                arMean[i] /= 30.0f;
+        else
+            for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
+                arMean[i] /= 36.0f;
 
-                            if (prc->fInitial && !iTurn && j == i)
-                                /* no doubles possible for first roll when rolling
-                                 * out as initial position */
-                                continue;
+        /* Find best move */
 
-                            memcpy(&aaanBoard[i][j][0][0], &aanBoard[ici][0][0], 2 * 25 * sizeof(int));
+        if (pre->apecChequer[pci->fMove]->nPlies ||
+            pre->aecZero[pci->fMove].fCubeful != pre->apecChequer[pci->fMove]->fCubeful ||
+            pre->apecChequer[pci->fMove]->rNoise > 0.0f)
 
-                            /* Find the best move for each roll on ply 0 only */
+            /* the user requested n-ply (n>0), or the chequer play of
+             * this turn differs from the ply 0 search above. Another
+             * call to FindBestMove is required */
 
-                            if (FindBestMove(aanMoves[i][j], i + 1, j + 1,
-                                             aaanBoard[i][j], pci, &aecZero[pci->fMove], defaultFilters) < 0)
-                                return -1;
+            FindBestMove(aanMoves[anDice[0] - 1][anDice[1] - 1],
+                         anDice[0], anDice[1],
+                         prg->anBoard, pci, pre->apecChequer[pci->fMove], pre->aaamf[pci->fMove]);
 
-                            SwapSides(aaanBoard[i][j]);
+        else {
 
-                            /* re-evaluate the chosen move at ply n-1 */
+            /* 0-ply play: best move is already recorded */
 
-                            pci->fMove = !pci->fMove;
-                            if (GeneralEvaluationE(aaar[i][j],
-                                                   (ConstTanBoard) aaanBoard[i][j], pci, &aecVarRedn[pci->fMove]) < 0)
-                                return -1;
-                            pci->fMove = !pci->fMove;
+            memcpy(&prg->anBoard[0][0], &aaanBoard[anDice[0] - 1][anDice[1] - 1][0][0], 2 * 25 * sizeof(int));
 
-                            if (!(iTurn & 1))
-                                InvertEvaluationR(aaar[i][j], pci);
+            SwapSides(prg->anBoard);
 
-                            /* Calculate arMean: the n-ply evaluation of the position */
+        }
 
-                            for (k = 0; k < NUM_ROLLOUT_OUTPUTS; k++)
-                                arMean[k] += ((i == j) ? aaar[i][j][k] : (aaar[i][j][k] * 2.0f));
 
-                        }
+        /* Accumulate variance reduction terms */
 
-                    if (prc->fInitial && !iTurn)
-                        /* no doubles ... */
-                        for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
-                            arMean[i] /= 30.0f;
-                    else
-                        for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
-                            arMean[i] /= 36.0f;
+        if (pci->nMatchTo)
+            for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
+                prg->arVarRedn[i] += arMean[i] - aaar[anDice[0] - 1][anDice[1] - 1][i];
+        else {
+            for (i = 0; i <= OUTPUT_EQUITY; i++)
+                prg->arVarRedn[i] += arMean[i] - aaar[anDice[0] - 1][anDice[1] - 1][i];
 
-                    /* Find best move */
+            r = arMean[OUTPUT_CUBEFUL_EQUITY] - aaar[anDice[0] - 1][anDice[1] - 1]
+                [OUTPUT_CUBEFUL_EQUITY];
+            prg->arVarRedn[OUTPUT_CUBEFUL_EQUITY] += r * (float) (pci->nCube / prg->pciStart->nCube);
+        }
 
-                    if (pecChequer[pci->fMove]->nPlies ||
-                        prc->fCubeful != pecChequer[pci->fMove]->fCubeful || pecChequer[pci->fMove]->rNoise > 0.0f)
+    } else {
 
-                        /* the user requested n-ply (n>0). Another call to
-                         * FindBestMove is required */
+        /* no variance reduction */
 
-                        FindBestMove(aanMoves[anDice[0] - 1][anDice[1] - 1],
-                                     anDice[0], anDice[1],
-                                     aanBoard[ici], pci,
-                                     pecChequer[pci->fMove],
-                                     (iTurn < nLateEvals) ? prc->aaamfChequer[pci->fMove] : prc->aaamfLate[pci->fMove]);
+        FindBestMove(aanMoves[anDice[0] - 1][anDice[1] - 1],
+                     anDice[0], anDice[1],
+                     prg->anBoard, pci, pre->apecChequer[pci->fMove], pre->aaamf[pci->fMove]);
 
-                    else {
+    }
 
-                        /* 0-ply play: best move is already recorded */
+    log_move(prg->paTrace, aanMoves[anDice[0] - 1][anDice[1] - 1], pci->fMove, anDice[0], anDice[1]);
 
-                        memcpy(&aanBoard[ici][0][0],
-                               &aaanBoard[anDice[0] - 1][anDice[1] - 1][0][0], 2 * 25 * sizeof(int));
+    /* Save hit statistics */
 
-                        SwapSides(aanBoard[ici]);
+    /* FIXME: record double hit, triple hits etc. ? */
 
-                    }
+    if (prg->ars && !prg->afHit[pci->fMove] && (aiBar[0] < prg->anBoard[0][24])) {
+        MT_SafeInc(&prg->ars[pci->fMove].nOpponentHit);
+        MT_SafeAdd(&prg->ars[pci->fMove].rOpponentHitMove, iTurn);
+        prg->afHit[pci->fMove] = TRUE;
 
+    }
 
-                    /* Accumulate variance reduction terms */
+    if (MT_SafeGet(&fInterrupt))
+        return -1;
 
-                    if (pci->nMatchTo)
-                        for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
-                            aarVarRedn[ici][i] += arMean[i] - aaar[anDice[0] - 1][anDice[1] - 1][i];
-                    else {
-                        for (i = 0; i <= OUTPUT_EQUITY; i++)
-                            aarVarRedn[ici][i] += arMean[i] - aaar[anDice[0] - 1][anDice[1] - 1][i];
+    /* Calculate number of wasted pips */
 
-                        r = arMean[OUTPUT_CUBEFUL_EQUITY] - aaar[anDice[0] - 1][anDice[1] - 1]
-                            [OUTPUT_CUBEFUL_EQUITY];
-                        aarVarRedn[ici][OUTPUT_CUBEFUL_EQUITY] += r * (float) (pci->nCube / aci[ici].nCube);
-                    }
+    pc = ClassifyPosition((ConstTanBoard) prg->anBoard, pci->bgv);
 
-                } else {
+    if (prg->ars && pc <= CLASS_BEAROFF1 && pcBefore <= CLASS_BEAROFF1) {
 
-                    /* no variance reduction */
+        PipCount((ConstTanBoard) prg->anBoard, anPips);
+        nPipsAfter = anPips[1];
+        nPipsDice = anDice[0] + anDice[1];
+        if (anDice[0] == anDice[1])
+            nPipsDice *= 2;
 
-                    FindBestMove(aanMoves[anDice[0] - 1][anDice[1] - 1],
-                                 anDice[0], anDice[1],
-                                 aanBoard[ici], pci,
-                                 pecChequer[pci->fMove],
-                                 (iTurn < nLateEvals) ? prc->aaamfChequer[pci->fMove] : prc->aaamfLate[pci->fMove]);
+        MT_SafeInc(&prg->ars[pci->fMove].nBearoffMoves);
+        MT_SafeAdd(&prg->ars[pci->fMove].nBearoffPipsLost, nPipsDice - (nPipsBefore - nPipsAfter));
 
-                }
+    }
 
-                if (logfp) {
-                    log_move(logfp, aanMoves[anDice[0] - 1][anDice[1] - 1], pci->fMove, anDice[0], anDice[1]);
-                }
+    /* Opponent closed out */
 
-                /* Save hit statistics */
+    if (prg->ars && !prg->afClosedOut[pci->fMove]
+        && prg->anBoard[0][24]) {
 
-                /* FIXME: record double hit, triple hits etc. ? */
+        /* opponent is on bar */
 
-                if (aarsStatistics && !afHit[pci->fMove] && (aiBar[0] < aanBoard[ici][0][24])) {
-                    MT_SafeInc(&aarsStatistics[ici][pci->fMove].nOpponentHit);
-                    MT_SafeAdd(&aarsStatistics[ici][pci->fMove].rOpponentHitMove, iTurn);
-                    afHit[pci->fMove] = TRUE;
+        ClosedBoard(afClosedBoard, (ConstTanBoard) prg->anBoard);
 
-                }
+        if (afClosedBoard[pci->fMove]) {
+            MT_SafeInc(&prg->ars[pci->fMove].nOpponentClosedOut);
+            MT_SafeAdd(&prg->ars[pci->fMove].rOpponentClosedOutMove, iTurn);
+            prg->afClosedOut[pci->fMove] = TRUE;
+        }
 
-                if (MT_SafeGet(&fInterrupt))
-                    return -1;
+    }
 
-                /* Calculate number of wasted pips */
 
-                pc = ClassifyPosition((ConstTanBoard) aanBoard[ici], pci->bgv);
+    /* check if game is over */
 
-                if (aarsStatistics && pc <= CLASS_BEAROFF1 && pcBefore <= CLASS_BEAROFF1) {
+    if (pc == CLASS_OVER) {
+        if (GeneralEvaluationE(arOutput, (ConstTanBoard) prg->anBoard, pci, pre->apecCube[pci->fMove]) < 0)
+            return -1;
 
-                    PipCount((ConstTanBoard) aanBoard[ici], anPips);
-                    nPipsAfter = anPips[1];
-                    nPipsDice = anDice[0] + anDice[1];
-                    if (anDice[0] == anDice[1])
-                        nPipsDice *= 2;
+        /* Since the game is over: cubeless equity = cubeful equity
+         * (convert to mwc for match play) */
 
-                    MT_SafeInc(&aarsStatistics[ici][pci->fMove].nBearoffMoves);
-                    MT_SafeAdd(&aarsStatistics[ici][pci->fMove].nBearoffPipsLost,
-                               nPipsDice - (nPipsBefore - nPipsAfter));
+        arOutput[OUTPUT_CUBEFUL_EQUITY] = (pci->nMatchTo) ? eq2mwc(arOutput[OUTPUT_EQUITY], pci) : arOutput[OUTPUT_EQUITY];
 
-                }
+        if (iTurn & 1)
+            InvertEvaluationR(arOutput, pci);
 
-                /* Opponent closed out */
+        prg->fPlaying = FALSE;
 
-                if (aarsStatistics && !afClosedOut[pci->fMove]
-                    && aanBoard[ici][0][24]) {
+        /* update statistics */
 
-                    /* opponent is on bar */
+        if (prg->ars)
+            switch (GameStatus((ConstTanBoard) prg->anBoard, pci->bgv)) {
+            case 1:
+                MT_SafeInc(&prg->ars[pci->fMove].acWin[LogCubeClamped(pci->nCube)]);
+                break;
+            case 2:
+                MT_SafeInc(&prg->ars[pci->fMove].acWinGammon[LogCubeClamped(pci->nCube)]);
+                break;
+            case 3:
+                MT_SafeInc(&prg->ars[pci->fMove].acWinBackgammon[LogCubeClamped(pci->nCube)]);
+                break;
+            }
 
-                    ClosedBoard(afClosedBoard, (ConstTanBoard) aanBoard[ici]);
+    }
 
-                    if (afClosedBoard[pci->fMove]) {
-                        MT_SafeInc(&aarsStatistics[ici][pci->fMove].nOpponentClosedOut);
-                        MT_SafeAdd(&aarsStatistics[ici][pci->fMove].rOpponentClosedOutMove, iTurn);
-                        afClosedOut[pci->fMove] = TRUE;
-                    }
+    /* Invert board and more */
 
-                }
+    SwapSides(prg->anBoard);
 
+    SetCubeInfo(pci, pci->nCube, pci->fCubeOwner,
+                !pci->fMove, pci->nMatchTo, pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
 
-                /* check if game is over */
+    return 0;
+}
 
-                if (pc == CLASS_OVER) {
-                    if (GeneralEvaluationE(aarOutput[ici], (ConstTanBoard) aanBoard[ici], pci, pecCube[pci->fMove]) < 0)
-                        return -1;
+/* The evaluation at truncation of a game still being played, and the
+ * final output of every game */
 
-                    /* Since the game is over: cubeless equity = cubeful equity
-                     * (convert to mwc for match play) */
+static int
+RolloutTruncate(const rolloutevals * pre, rolloutgame * prg, int iTurn, int nBasisCube)
+{
+    const rolloutcontext *prc = pre->prc;
+    cubeinfo *pci = &prg->ci;
+    float *arOutput = prg->arOutput;
+    evalcontext ec;
+    unsigned int i;
 
-                    aarOutput[ici][OUTPUT_CUBEFUL_EQUITY] =
-                        (pci->nMatchTo) ? eq2mwc(aarOutput[ici][OUTPUT_EQUITY], pci) : aarOutput[ici][OUTPUT_EQUITY];
+    if (prg->fPlaying) {
 
-                    if (iTurn & 1)
-                        InvertEvaluationR(aarOutput[ici], pci);
+        /* ensure cubeful evaluation at truncation */
 
-                    *pf = FALSE;
-                    cUnfinished--;
+        memcpy(&ec, &prc->aecCubeTrunc, sizeof(ec));
+        ec.fCubeful = prc->fCubeful;
 
-                    /* update statistics */
-
-                    if (aarsStatistics)
-                        switch (GameStatus((ConstTanBoard) aanBoard[ici], pci->bgv)) {
-                        case 1:
-                            MT_SafeInc(&aarsStatistics[ici][pci->fMove].acWin[LogCubeClamped(pci->nCube)]);
-                            break;
-                        case 2:
-                            MT_SafeInc(&aarsStatistics[ici][pci->fMove].acWinGammon[LogCubeClamped(pci->nCube)]);
-                            break;
-                        case 3:
-                            MT_SafeInc(&aarsStatistics[ici][pci->fMove].acWinBackgammon[LogCubeClamped(pci->nCube)]);
-                            break;
-                        }
+        /* evaluation at truncation */
 
-                }
+        if (GeneralEvaluationE(arOutput, (ConstTanBoard) prg->anBoard, pci, &ec) < 0)
+            return -1;
 
-                /* Invert board and more */
+        if (iTurn & 1)
+            InvertEvaluationR(arOutput, pci);
 
-                SwapSides(aanBoard[ici]);
+    }
 
-                SetCubeInfo(pci, pci->nCube, pci->fCubeOwner,
-                            !pci->fMove, pci->nMatchTo,
-                            pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
-            }
-        }
+    /* the final output is the sum of the resulting evaluation and
+     * all variance reduction terms */
 
-        iTurn++;
+    if (!pci->nMatchTo)
+        arOutput[OUTPUT_CUBEFUL_EQUITY] *= (float) (pci->nCube / prg->pciStart->nCube);
 
-    }                           /* loop truncate */
+    if (prc->fVarRedn)
+        for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
+            arOutput[i] += prg->arVarRedn[i];
 
+    /* multiply money equities */
 
-    /* evaluation at truncation */
+    if (!pci->nMatchTo)
+        arOutput[OUTPUT_CUBEFUL_EQUITY] *= (float) (prg->pciStart->nCube / nBasisCube);
 
-    for (ici = 0, pci = pciLocal, pf = pfFinished; ici < cci; ici++, pci++, pf++) {
+    return 0;
+}
 
-        if (*pf) {
+/* called with
+ * cube decision                  move rollout
+ * aanBoard       2 copies of same board         1 board
+ * aarOutput      2 arrays for eval              1 array
+ * iTurn          player on roll                 same
+ * iGame          game number                    same
+ * cubeinfo       2 structs for double/nodouble  1 cubeinfo
+ * or take/pass
+ * CubeDecTop     array of 2 boolean             1 boolean
+ * (TRUE if a cube decision is valid on turn 0)
+ * cci            2 (number of rollouts to do)   1
+ * prc            1 rollout context              same
+ * aarsStatistics 2 arrays of stats for the      NULL
+ * two alternatives of
+ * cube rollouts
+ *
+ * returns -1 on error/interrupt, fInterrupt TRUE if stopped by user
+ * aarOutput array(s) contain results
+ */
 
-            /* ensure cubeful evaluation at truncation */
+extern int
+BasicCubefulRollout(unsigned int aanBoard[][2][25],
+                    float aarOutput[][NUM_ROLLOUT_OUTPUTS],
+                    int iTurn, int iGame,
+                    const cubeinfo aci[], int afCubeDecTop[], unsigned int cci,
+                    rolloutcontext * prc,
+                    rolloutstat aarsStatistics[][2],
+                    int nBasisCube, perArray * dicePerms, rngcontext * rngctxRollout, GArray * paTrace)
+{
 
-            memcpy(&ec, &prc->aecCubeTrunc, sizeof(ec));
-            ec.fCubeful = prc->fCubeful;
+    unsigned int anDice[2];
+    unsigned int cUnfinished = cci;
+    unsigned int ici;
+    rolloutevals re;
+    rolloutgame *arg = g_alloca(cci * sizeof(rolloutgame));
 
-            /* evaluation at truncation */
+    int nTruncate = prc->fDoTruncate ? prc->nTruncate : 0x7fffffff;
 
-            if (GeneralEvaluationE(aarOutput[ici], (ConstTanBoard) aanBoard[ici], pci, &ec) < 0)
-                return -1;
+    InitRolloutEvals(&re, prc);
 
-            if (iTurn & 1)
-                InvertEvaluationR(aarOutput[ici], pci);
+    for (ici = 0; ici < cci; ici++)
+        InitRolloutGame(arg + ici, aanBoard[ici], aarOutput[ici], aci + ici, afCubeDecTop[ici],
+                        aarsStatistics ? aarsStatistics[ici] : NULL, paTrace);
 
-        }
+    while ((!nTruncate || iTurn < nTruncate) && cUnfinished) {
 
-        /* the final output is the sum of the resulting evaluation and
-         * all variance reduction terms */
+        SetRolloutTurn(&re, iTurn);
 
-        if (!pci->nMatchTo)
-            aarOutput[ici][OUTPUT_CUBEFUL_EQUITY] *= (float) (pci->nCube / aci[ici].nCube);
+        /* Cube decision */
 
-        if (useVarRedn)
-            for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
-                aarOutput[ici][i] += aarVarRedn[ici][i];
+        for (ici = 0; ici < cci; ici++)
+            if (arg[ici].fPlaying) {
+                if (RolloutCube(&re, arg + ici, iTurn) < 0)
+                    return -1;
+                if (!arg[ici].fPlaying)
+                    cUnfinished--;
+            }
 
-        /* multiply money equities */
+        /* Chequer play */
 
-        if (!pci->nMatchTo)
-            aarOutput[ici][OUTPUT_CUBEFUL_EQUITY] *= (float) (aci[ici].nCube / nBasisCube);
+        if (RolloutDice(iTurn, iGame, prc->fInitial, anDice,
+                        &prc->rngRollout, rngctxRollout, prc->fRotate, dicePerms) < 0)
+            return -1;
 
+        if (anDice[0] < anDice[1])
+            swap_us(anDice, anDice + 1);
 
+        for (ici = 0; ici < cci; ici++)
+            if (arg[ici].fPlaying) {
+                if (RolloutChequer(&re, arg + ici, iTurn, anDice) < 0)
+                    return -1;
+                if (!arg[ici].fPlaying)
+                    cUnfinished--;
+            }
 
-        /*        if ( pci->nMatchTo ) */
-        /*          aarOutput[ ici ][ OUTPUT_CUBEFUL_EQUITY ] = */
-        /*            eq2mwc ( aarOutput[ ici ][ OUTPUT_CUBEFUL_EQUITY ], pci ); */
-        /*        else */
-        /*          aarOutput[ ici ][ OUTPUT_CUBEFUL_EQUITY ] *= */
-        /*            pci->nCube / aci [ ici ].nCube; */
+        iTurn++;
 
-    }
+    }                           /* loop truncate */
+
+
+    /* evaluation at truncation */
+
+    for (ici = 0; ici < cci; ici++)
+        if (RolloutTruncate(&re, arg + ici, iTurn, nBasisCube) < 0)
+            return -1;
 
     return 0;
 }
@@ -922,12 +1043,18 @@ comp_jsdinfo_order(const void *a, const void *b)
 /* Lots of shared variables - should probably not be globals... */
 static int cGames;
 static cubeinfo *aciLocal;
-static int show_jsds;
+
+/* Mean and sum of squared deviations (Welford) of the trials of one
+ * alternative */
+typedef struct {
+    unsigned int n;
+    double arMean[NUM_ROLLOUT_OUTPUTS];
+    double arM2[NUM_ROLLOUT_OUTPUTS];
+} rolloutacc;
 
 static float (*aarMu)[NUM_ROLLOUT_OUTPUTS];
 static float (*aarSigma)[NUM_ROLLOUT_OUTPUTS];
-static float (*aarResult)[NUM_ROLLOUT_OUTPUTS];
-static float (*aarVariance)[NUM_ROLLOUT_OUTPUTS];
+static rolloutacc *aAcc;        /* all merged trials, under MT_Exclusive() */
 static int *fNoMore;
 static jsdinfo *ajiJSD;
 
@@ -937,221 +1064,1261 @@ static ConstTanBoard *ro_apBoard;
 static const cubeinfo **ro_apci;
 static int **ro_apCubeDecTop;
 static rolloutstat(*ro_aarsStatistics)[2];
-static int ro_fCubeRollout;
-static int ro_fInvert;
 static int ro_NextTrial;
 static unsigned int *altGameCount;
 static int *altTrialCount;
-
-static void
-check_jsds(int *active)
+static float *arAllocation;     /* share of the trials for each alternative, see AllocateTrials() */
+static int nAllocationMinimum;
+
+/* The alternatives of one decision.  A rollout may play the trials of
+ * several decisions together, see RolloutDecisions(), and applies the
+ * stop rules to each of them on its own. */
+typedef struct {
+    int iFirst;                 /* its alternatives */
+    int cAlternatives;
+    int fInvert;
+    int fCubeRollout;
+    int fJsd;                   /* compare the alternatives by JSD; not for initial positions */
+    int fStopOnJsd;
+    int fStopOnSTD;
+    int fStopOnCube;            /* see check_cube() */
+    int cPrevious;              /* alternatives with trials from before */
+    int fDone;                  /* stopped by the stop rules */
+} decisioninfo;
+
+static decisioninfo *ro_adi;
+static int ro_decisions;
+static int *aiDecision;         /* the decision of each alternative */
+
+static decisioninfo *
+AltDecision(int alt)
 {
-    int alt;
-    float v, s, denominator;
-
-    for (alt = 0; alt < ro_alternatives; ++alt) {
+    return &ro_adi[aiDecision[alt]];
+}
 
-        /* 1) For each move, calculate the cubeful (or cubeless if that's what we're doing)
-         * equity */
-        rolloutcontext *prc = &ro_apes[alt]->rc;
+/* The cubeinfo the equities of an alternative are expressed with; a
+ * cube rollout uses the one from before the double */
+static const cubeinfo *
+AltCubeInfo(int alt)
+{
+    const decisioninfo *pdi = AltDecision(alt);
 
-        if (prc->fCubeful) {
-            v = aarMu[alt][OUTPUT_CUBEFUL_EQUITY];
-            s = aarSigma[alt][OUTPUT_CUBEFUL_EQUITY];
+    return &aciLocal[pdi->fCubeRollout ? pdi->iFirst : alt];
+}
 
-            /* if we're doing a cube rollout, we need aciLocal[0] for generating the
-             * equity. If we're doing moves, we use the cubeinfo that goes with this move. */
-            if (ms.nMatchTo && !fOutputMWC) {
-                v = mwc2eq(v, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
-                s = se_mwc2eq(s, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
-            }
-        } else {
-            v = aarMu[alt][OUTPUT_EQUITY];
-            s = aarSigma[alt][OUTPUT_EQUITY];
+/* The cubeful (or cubeless if that's what we're doing) equity of an
+ * alternative and its standard error, as the stop rules compare them */
+static void
+AlternativeEquity(int alt, float *prEquity, float *prSE)
+{
+    rolloutcontext *prc = &ro_apes[alt]->rc;
+    float v, s;
+
+    if (prc->fCubeful) {
+        v = aarMu[alt][OUTPUT_CUBEFUL_EQUITY];
+        s = aarSigma[alt][OUTPUT_CUBEFUL_EQUITY];
+
+        /* if we're doing a cube rollout, we need aciLocal[0] for generating the
+         * equity. If we're doing moves, we use the cubeinfo that goes with this move. */
+        if (ms.nMatchTo && !fOutputMWC) {
+            v = mwc2eq(v, AltCubeInfo(alt));
+            s = se_mwc2eq(s, AltCubeInfo(alt));
+        }
+    } else {
+        v = aarMu[alt][OUTPUT_EQUITY];
+        s = aarSigma[alt][OUTPUT_EQUITY];
 
-            if (ms.nMatchTo && fOutputMWC) {
-                v = eq2mwc(v, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
-                s = se_eq2mwc(s, &aciLocal[(ro_fCubeRollout ? 0 : alt)]);
+        if (ms.nMatchTo && fOutputMWC) {
+            v = eq2mwc(v, AltCubeInfo(alt));
+            s = se_eq2mwc(s, AltCubeInfo(alt));
 
-            }
         }
-        ajiJSD[alt].rEquity = v;
-        ajiJSD[alt].rJSD = s;
     }
 
-    if (!ro_fCubeRollout) {
+    *prEquity = v;
+    *prSE = s;
+}
+
+static void
+check_jsds(decisioninfo * pdi, int *active)
+{
+    jsdinfo *aji = ajiJSD + pdi->iFirst;
+    int alt;
+    float v, s, denominator;
+
+    /* 1) For each move, calculate the equity */
+    for (alt = 0; alt < pdi->cAlternatives; ++alt)
+        AlternativeEquity(pdi->iFirst + alt, &aji[alt].rEquity, &aji[alt].rJSD);
+
+    if (!pdi->fCubeRollout) {
         /* 2 sort the list in order of decreasing equity (best move first) */
-        qsort((void *) ajiJSD, ro_alternatives, sizeof(jsdinfo), comp_jsdinfo_equity);
+        qsort((void *) aji, pdi->cAlternatives, sizeof(jsdinfo), comp_jsdinfo_equity);
 
-        /* 3 replace the equities with the equity difference from the best move (ajiJSD[0]), the JSDs
+        /* 3 replace the equities with the equity difference from the best move (aji[0]), the JSDs
          * with the number of JSDs the equity difference represents and decide if we should either stop
          * or resume rolling a move out */
-        v = ajiJSD[0].rEquity;
-        s = ajiJSD[0].rJSD;
+        v = aji[0].rEquity;
+        s = aji[0].rJSD;
         s *= s;
-        for (alt = ro_alternatives - 1; alt > 0; --alt) {
+        for (alt = pdi->cAlternatives - 1; alt > 0; --alt) {
 
-            ajiJSD[alt].nRank = alt;
-            ajiJSD[alt].rEquity = v - ajiJSD[alt].rEquity;
+            aji[alt].nRank = alt;
+            aji[alt].rEquity = v - aji[alt].rEquity;
 
-            denominator = sqrtf(s + ajiJSD[alt].rJSD * ajiJSD[alt].rJSD);
+            denominator = sqrtf(s + aji[alt].rJSD * aji[alt].rJSD);
 
             if (denominator < 1e-8f)
                 denominator = 1e-8f;
 
-            ajiJSD[alt].rJSD = ajiJSD[alt].rEquity / denominator;
+            aji[alt].rJSD = aji[alt].rEquity / denominator;
 
-            if ((rcRollout.fStopOnJsd) && (altGameCount[ajiJSD[alt].nOrder] >= (rcRollout.nMinimumJsdGames))) {
-                if (ajiJSD[alt].rJSD > rcRollout.rJsdLimit) {
+            if ((pdi->fStopOnJsd) && (altGameCount[aji[alt].nOrder] >= (rcRollout.nMinimumJsdGames))) {
+                if (aji[alt].rJSD > rcRollout.rJsdLimit) {
                     /* This move is no longer worth rolling out */
 
-                    fNoMore[ajiJSD[alt].nOrder] = 1;
-                    ro_apes[alt]->rc.rStoppedOnJSD = ajiJSD[alt].rJSD;
+                    fNoMore[aji[alt].nOrder] = 1;
+                    ro_apes[pdi->iFirst + alt]->rc.rStoppedOnJSD = aji[alt].rJSD;
 
                     (*active)--;
 
                 } else {
                     /* this move needs to roll out further. It may need to be caught up
                      * with other moves, because it's been stopped for a few trials */
-                    if (fNoMore[ajiJSD[alt].nOrder]) {
+                    if (fNoMore[aji[alt].nOrder]) {
                         /* it was stopped, catch it up to the other moves and resume
                          * rolling it out. While we're catching up, we don't want to do
                          * these calculations any more so we'll change the minimum
                          * games to do */
-                        fNoMore[ajiJSD[alt].nOrder] = 0;
+                        fNoMore[aji[alt].nOrder] = 0;
                         (*active)++;
                     }
                 }
             }
-        }
+        }
+
+        /* fill out details of best move */
+        aji[0].rEquity = aji[0].rJSD = 0.0f;
+        aji[0].nRank = 0;
+
+        /* rearrange aji in move order rather than equity order */
+        qsort((void *) aji, pdi->cAlternatives, sizeof(jsdinfo), comp_jsdinfo_order);
+
+    } else {
+        float eq_dp = fOutputMWC ? eq2mwc(1.0f, &aciLocal[pdi->iFirst]) : 1.0f;
+        float eq_dt = aji[1].rEquity;
+
+        if (eq_dp < eq_dt) {
+            /* compare nd to dp */
+            aji[0].rEquity = aji[0].rEquity - eq_dp;
+            denominator = aji[0].rJSD;
+            if (denominator < 1e-8f)
+                denominator = 1e-8f;
+            aji[0].rJSD = fabsf(aji[0].rEquity / denominator);
+        } else {
+            /* compare nd to dt */
+            aji[0].rEquity = aji[0].rEquity - aji[1].rEquity;
+            denominator = sqrtf(aji[0].rJSD * aji[0].rJSD + aji[1].rJSD * aji[1].rJSD);
+            if (denominator < 1e-8f)
+                denominator = 1e-8f;
+            aji[0].rJSD = fabsf(aji[0].rEquity / denominator);
+        }
+        /* compare dt to dp */
+        aji[1].rEquity = aji[1].rEquity - eq_dp;
+        denominator = aji[1].rJSD;
+        if (denominator < 1e-8f)
+            denominator = 1e-8f;
+        aji[1].rJSD = fabsf(aji[1].rEquity / denominator);
+        if (pdi->fStopOnJsd &&
+            (altGameCount[pdi->iFirst] >= (rcRollout.nMinimumJsdGames)) &&
+            rcRollout.rJsdLimit < MIN(aji[0].rJSD, aji[1].rJSD)) {
+            ro_apes[pdi->iFirst]->rc.rStoppedOnJSD = aji[0].rJSD;
+            ro_apes[pdi->iFirst + 1]->rc.rStoppedOnJSD = aji[1].rJSD;
+            fNoMore[pdi->iFirst] = 1;
+            fNoMore[pdi->iFirst + 1] = 1;
+            *active = 0;
+        }
+    }
+}
+
+static void
+check_sds(decisioninfo * pdi, int *active)
+{
+    int alt;
+    for (alt = pdi->iFirst; alt < pdi->iFirst + pdi->cAlternatives; ++alt) {
+        float s;
+        int ioutput;
+        int err_too_big = 0;
+        rolloutcontext *prc;
+        if (fNoMore[alt] || altGameCount[alt] < (rcRollout.nMinimumGames))
+            continue;
+        prc = &ro_apes[alt]->rc;
+        for (ioutput = OUTPUT_EQUITY; ioutput < NUM_ROLLOUT_OUTPUTS; ioutput++) {
+            if (ioutput == OUTPUT_EQUITY) {     /* cubeless */
+                if (!ms.nMatchTo) {     /* money game */
+                    s = fabsf(aarSigma[alt][ioutput]);
+                    if (pdi->fCubeRollout) {
+                        s *= (float) (aciLocal[alt].nCube / aciLocal[pdi->iFirst].nCube);
+                    }
+                } else {        /* match play */
+                    s = fabsf(se_mwc2eq(se_eq2mwc(aarSigma[alt][ioutput],
+                                                  &aciLocal[alt]), AltCubeInfo(alt)));
+                }
+            } else {
+                if (!prc->fCubeful)
+                    continue;
+                /* cubeful */
+                if (!ms.nMatchTo) {     /* money game */
+                    s = fabsf(aarSigma[alt][ioutput]);
+                } else {
+                    s = fabsf(se_mwc2eq(aarSigma[alt][ioutput], AltCubeInfo(alt)));
+                }
+            }
+
+            if (rcRollout.rStdLimit < s) {
+                err_too_big = 1;
+                break;
+            }
+        }                       /* for (ioutput = OUTPUT_EQUITY; ioutput < NUM_ROLLOUT_OUTPUTS; ioutput++) */
+
+        if (!err_too_big) {
+            fNoMore[alt] = 1;
+            (*active)--;
+        }
+
+    }                           /* for (alt = pdi->iFirst; ...) */
+    if (pdi->fCubeRollout && (!fNoMore[pdi->iFirst] || !fNoMore[pdi->iFirst + 1])) {
+        /* cube rollouts should run the same number
+         * of trials for nd and dt */
+        fNoMore[pdi->iFirst] = fNoMore[pdi->iFirst + 1] = 0;
+        *active = 2;
+    }
+
+}
+
+/* The equity difference a - b and the number of joint standard errors
+ * it is from 0 */
+static float
+ZScore(float a, float sa, float b, float sb)
+{
+    float denominator = sqrtf(sa * sa + sb * sb);
+
+    if (denominator < 1e-8f)
+        denominator = 1e-8f;
+
+    return fabsf(a - b) / denominator;
+}
+
+/* Stop a cube rollout once the action FindCubeDecision() takes on the
+ * results so far can no longer change: the doubler's choice between no
+ * double and the opponent's best answer to a double, and the
+ * opponent's between take and pass (and beaver), must all be at least
+ * rRolloutCubeLimit joint standard errors apart. */
+static void
+check_cube(decisioninfo * pdi, int *active)
+{
+    const cubeinfo *pci = &aciLocal[pdi->iFirst];
+    float arDouble[4], arSE[4];
+    float rAnswer, rAnswerSE, z;
+    cubedecision cd;
+    int i;
+
+    if (fNoMore[pdi->iFirst] || altGameCount[pdi->iFirst] < rcRollout.nMinimumGames)
+        return;
+
+    cd = FindCubeDecision(arDouble, aarMu + pdi->iFirst, pci);
+
+    /* the same normalized money equities as arDouble */
+    for (i = 0; i < 2; ++i) {
+        arSE[OUTPUT_NODOUBLE + i] = aarSigma[pdi->iFirst + i][OUTPUT_CUBEFUL_EQUITY];
+        if (pci->nMatchTo)
+            arSE[OUTPUT_NODOUBLE + i] = se_mwc2eq(arSE[OUTPUT_NODOUBLE + i], pci);
+    }
+    arSE[OUTPUT_DROP] = 0.0f;
+
+    if (arDouble[OUTPUT_TAKE] < arDouble[OUTPUT_DROP]) {
+        rAnswer = arDouble[OUTPUT_TAKE];
+        rAnswerSE = arSE[OUTPUT_TAKE];
+    } else {
+        rAnswer = arDouble[OUTPUT_DROP];
+        rAnswerSE = arSE[OUTPUT_DROP];
+    }
+    z = MIN(ZScore(arDouble[OUTPUT_NODOUBLE], arSE[OUTPUT_NODOUBLE], rAnswer, rAnswerSE),
+            ZScore(arDouble[OUTPUT_TAKE], arSE[OUTPUT_TAKE], arDouble[OUTPUT_DROP], arSE[OUTPUT_DROP]));
+
+    switch (cd) {
+    case NOT_AVAILABLE:
+    case NODOUBLE_DEADCUBE:
+    case NO_REDOUBLE_DEADCUBE:
+        /* nothing to decide */
+        z = rRolloutCubeLimit;
+        break;
+
+    case DOUBLE_BEAVER:
+    case NODOUBLE_BEAVER:
+    case NO_REDOUBLE_BEAVER:
+    case OPTIONAL_DOUBLE_BEAVER:
+        /* beaver rather than take, and no double against a beaver */
+        z = MIN(z, ZScore(arDouble[OUTPUT_TAKE], arSE[OUTPUT_TAKE], 0.0f, 0.0f));
+        z = MIN(z, ZScore(arDouble[OUTPUT_NODOUBLE], arSE[OUTPUT_NODOUBLE],
+                          2.0f * arDouble[OUTPUT_TAKE], 2.0f * arSE[OUTPUT_TAKE]));
+        break;
+
+    default:
+        break;
+    }
+
+    if (z >= rRolloutCubeLimit) {
+        fNoMore[pdi->iFirst] = fNoMore[pdi->iFirst + 1] = 1;
+        *active = 0;
+    }
+}
+
+/* the alternatives play this many trials before any is held back */
+#define ALLOCATION_MINIMUM 144
+
+/* Share out the next trials of a move rollout between the alternatives
+ * the way Optimal Computing Budget Allocation (Chen et al.) would: each
+ * alternative i other than the best b gets trials in proportion to
+ * (sd_i / (equity_b - equity_i))^2, and b gets sd_b times the square
+ * root of the sum of n_i^2 / sd_i^2 over the others, where sd is the
+ * standard deviation of a single trial.  The alternative with the most
+ * gets a trial every cycle and the others a fraction arAllocation[] of
+ * the cycles, see ClaimTrials().  Call with MT_Exclusive() held. */
+static void
+AllocateTrials(const decisioninfo * pdi)
+{
+    float *arEquity = g_alloca(ro_alternatives * sizeof(float));
+    float *arSD = g_alloca(ro_alternatives * sizeof(float));
+    double *arWeight = g_alloca(ro_alternatives * sizeof(double));
+    double rSum = 0.0, rMax = 0.0;
+    int const iEnd = pdi->iFirst + pdi->cAlternatives;
+    int alt, iBest = pdi->iFirst;
+
+    for (alt = pdi->iFirst; alt < iEnd; ++alt) {
+        /* too few trials to tell the alternatives apart */
+        if (altGameCount[alt] < (unsigned int) nAllocationMinimum && !fNoMore[alt])
+            return;
+
+        AlternativeEquity(alt, &arEquity[alt], &arSD[alt]);
+        arSD[alt] *= sqrtf((float) altGameCount[alt]);
+
+        if (arEquity[alt] > arEquity[iBest])
+            iBest = alt;
+    }
+
+    for (alt = pdi->iFirst; alt < iEnd; ++alt) {
+        /* moves that are as good as the best are told apart by the
+         * JSD rule, not here */
+        double rDelta = MAX(arEquity[iBest] - arEquity[alt], 1e-4f);
+
+        if (alt == iBest || arSD[alt] < 1e-6f) {
+            arWeight[alt] = 0.0;
+            continue;
+        }
+
+        arWeight[alt] = (arSD[alt] / rDelta) * (arSD[alt] / rDelta);
+        rSum += (arWeight[alt] / arSD[alt]) * (arWeight[alt] / arSD[alt]);
+    }
+    arWeight[iBest] = arSD[iBest] * sqrt(rSum);
+
+    for (alt = pdi->iFirst; alt < iEnd; ++alt)
+        if (!fNoMore[alt] && arWeight[alt] > rMax)
+            rMax = arWeight[alt];
+
+    for (alt = pdi->iFirst; alt < iEnd; ++alt)
+        arAllocation[alt] = rMax > 0.0 ? (float) (arWeight[alt] / rMax) : 1.0f;
+}
+
+static void
+AccAdd(rolloutacc * pacc, const float ar[NUM_ROLLOUT_OUTPUTS])
+{
+    unsigned int j;
+
+    pacc->n++;
+    for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
+        double rDelta = ar[j] - pacc->arMean[j];
+
+        pacc->arMean[j] += rDelta / pacc->n;
+        pacc->arM2[j] += rDelta * (ar[j] - pacc->arMean[j]);
+    }
+}
+
+/* Add the trials of paccFrom to pacc (Chan, Golub and LeVeque) */
+static void
+AccMerge(rolloutacc * pacc, const rolloutacc * paccFrom)
+{
+    unsigned int const n = pacc->n + paccFrom->n;
+    unsigned int j;
+
+    if (paccFrom->n == 0)
+        return;
+
+    for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
+        double rDelta = paccFrom->arMean[j] - pacc->arMean[j];
+
+        pacc->arMean[j] += rDelta * paccFrom->n / n;
+        pacc->arM2[j] += paccFrom->arM2[j] + rDelta * rDelta * pacc->n * paccFrom->n / n;
+    }
+    pacc->n = n;
+}
+
+/* Merge the trials a thread has finished into the shared results and
+ * update what the progress display and the stop rules see; call with
+ * MT_Exclusive() held */
+static void
+MergeResults(rolloutacc * aAccThread)
+{
+    int alt;
+    unsigned int j;
+
+    for (alt = 0; alt < ro_alternatives; ++alt) {
+        rolloutacc *pacc = &aAcc[alt];
+        rolloutcontext *prc = &ro_apes[alt]->rc;
+
+        if (aAccThread[alt].n == 0)
+            continue;
+
+        AccMerge(pacc, &aAccThread[alt]);
+        memset(&aAccThread[alt], 0, sizeof(rolloutacc));
+
+        altGameCount[alt] = pacc->n;
+
+        for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
+            /* for n == 1 the variance is not defined */
+            double rVariance = pacc->n > 1 ? pacc->arM2[j] / (pacc->n - 1) : 0.0;
+
+            aarMu[alt][j] = (float) pacc->arMean[j];
+
+            if (j < OUTPUT_EQUITY) {
+                if (aarMu[alt][j] < 0.0f)
+                    aarMu[alt][j] = 0.0f;
+                else if (aarMu[alt][j] > 1.0f)
+                    aarMu[alt][j] = 1.0f;
+            }
+
+            aarSigma[alt][j] = (float) sqrt(rVariance / pacc->n);
+        }
+
+        /* For normal alternatives nGamesDone and altGameCount will be equal. For cube decisions,
+         * however, the two may differ by the trials other threads have not merged yet. So we cheat
+         * a little bit, but it would be better if the double and nodouble alternatives weren't linked */
+        if (prc->nGamesDone < (int) altGameCount[alt])
+            prc->nGamesDone = (int) altGameCount[alt];
+    }
+}
+
+/* The journal keeps the outputs of every trial added to the results, so
+ * that a rollout which was stopped can later go on with the trials it
+ * had not finished.  It is a header followed by fixed size records,
+ * appended to under MT_Exclusive() whenever a thread merges its trials. */
+#define JOURNAL_MAGIC "GNU Backgammon rollout journal 1\n"
+
+typedef struct {
+    guint64 nKey;               /* the rollout, see JournalKey() */
+    guint32 iTrial;
+    guint32 iAlt;
+    guint32 cAlternatives;
+    float ar[NUM_ROLLOUT_OUTPUTS];      /* as added to the results */
+} journalrecord;
+
+static FILE *pfJournal;
+static guint64 nJournalKey;
+static int nJournalError;
+static unsigned char **aafTrialDone;    /* the trials found in the journal */
+
+/* FNV-1a */
+static guint64
+JournalHash(guint64 n, const void *p, size_t cb)
+{
+    const unsigned char *pch = p;
+
+    while (cb--)
+        n = (n ^ *pch++) * G_GUINT64_CONSTANT(0x100000001b3);
+
+    return n;
+}
+
+static guint64
+JournalHashEval(guint64 n, const evalcontext * pec)
+{
+    int an[4];
+
+    an[0] = pec->fCubeful;
+    an[1] = pec->nPlies;
+    an[2] = pec->fUsePrune;
+    an[3] = pec->fDeterministic;
+
+    n = JournalHash(n, an, sizeof(an));
+    return JournalHash(n, &pec->rNoise, sizeof(pec->rNoise));
+}
+
+/* Identify the rollout by everything that decides the games of its
+ * trials, but not by how many trials it will have */
+static guint64
+JournalKey(void)
+{
+    guint64 n = G_GUINT64_CONSTANT(0xcbf29ce484222325);
+    int an[3];
+    int alt, i;
+
+    for (i = 0; i < ro_decisions; ++i) {
+        an[0] = ro_adi[i].cAlternatives;
+        an[1] = ro_adi[i].fInvert;
+        an[2] = ro_adi[i].fCubeRollout;
+        n = JournalHash(n, an, sizeof(an));
+    }
+
+    for (alt = 0; alt < ro_alternatives; ++alt) {
+        const rolloutcontext *prc = &ro_apes[alt]->rc;
+        guint64 nSeed = prc->nSeed;
+        int anFlags[12];
+
+        anFlags[0] = prc->fCubeful;
+        anFlags[1] = prc->fVarRedn;
+        anFlags[2] = prc->fInitial;
+        anFlags[3] = prc->fRotate;
+        anFlags[4] = prc->fTruncBearoff2;
+        anFlags[5] = prc->fTruncBearoffOS;
+        anFlags[6] = prc->fLateEvals;
+        anFlags[7] = prc->fDoTruncate;
+        anFlags[8] = prc->nTruncate;
+        anFlags[9] = prc->nLate;
+        anFlags[10] = prc->rngRollout;
+        anFlags[11] = *ro_apCubeDecTop[alt];
+
+        n = JournalHash(n, ro_apBoard[alt], sizeof(TanBoard));
+        n = JournalHash(n, ro_apci[alt], sizeof(cubeinfo));
+        n = JournalHash(n, anFlags, sizeof(anFlags));
+        n = JournalHash(n, &nSeed, sizeof(nSeed));
+
+        for (i = 0; i < 2; i++) {
+            n = JournalHashEval(n, &prc->aecCube[i]);
+            n = JournalHashEval(n, &prc->aecChequer[i]);
+            n = JournalHashEval(n, &prc->aecCubeLate[i]);
+            n = JournalHashEval(n, &prc->aecChequerLate[i]);
+        }
+        n = JournalHashEval(n, &prc->aecCubeTrunc);
+        n = JournalHashEval(n, &prc->aecChequerTrunc);
+
+        n = JournalHash(n, prc->aaamfChequer, sizeof(prc->aaamfChequer));
+        n = JournalHash(n, prc->aaamfLate, sizeof(prc->aaamfLate));
+    }
+
+    return n;
+}
+
+/* Open the journal and add the trials of this rollout found in it to
+ * the results; RolloutLoopMT() will not play them again */
+static void
+JournalOpen(void)
+{
+    char achMagic[sizeof(JOURNAL_MAGIC) - 1];
+    journalrecord jr;
+    rolloutacc *aAccJournal;
+    unsigned int cRecords = 0, cTrials = 0;
+    int alt;
+
+    if (!szRolloutJournal)
+        return;
+
+    nJournalKey = JournalKey();
+
+    if (!(pfJournal = g_fopen(szRolloutJournal, "r+b")) && errno == ENOENT)
+        pfJournal = g_fopen(szRolloutJournal, "w+b");
+
+    if (!pfJournal) {
+        outputerrf(_("Cannot open the rollout journal `%s': %s\n"), szRolloutJournal, strerror(errno));
+        return;
+    }
+
+    if (fread(achMagic, sizeof(achMagic), 1, pfJournal) < 1) {
+        /* a new journal */
+        rewind(pfJournal);
+        if (fwrite(JOURNAL_MAGIC, sizeof(achMagic), 1, pfJournal) < 1 || fflush(pfJournal)) {
+            outputerrf(_("Cannot write the rollout journal `%s': %s\n"), szRolloutJournal, strerror(errno));
+            fclose(pfJournal);
+            pfJournal = NULL;
+        }
+        return;
+    }
+
+    if (memcmp(achMagic, JOURNAL_MAGIC, sizeof(achMagic))) {
+        outputerrf(_("`%s' is not a rollout journal\n"), szRolloutJournal);
+        fclose(pfJournal);
+        pfJournal = NULL;
+        return;
+    }
+
+    aafTrialDone = g_new0(unsigned char *, ro_alternatives);
+    aAccJournal = g_new0(rolloutacc, ro_alternatives);
+
+    for (; fread(&jr, sizeof(jr), 1, pfJournal) == 1; cRecords++) {
+        /* trials below altTrialCount are in the results we started from */
+        if (jr.nKey != nJournalKey || jr.cAlternatives != (guint32) ro_alternatives ||
+            jr.iAlt >= (guint32) ro_alternatives || jr.iTrial >= (guint32) cGames ||
+            (int) jr.iTrial < altTrialCount[jr.iAlt])
+            continue;
+
+        if (!aafTrialDone[jr.iAlt])
+            aafTrialDone[jr.iAlt] = g_new0(unsigned char, cGames);
+        else if (aafTrialDone[jr.iAlt][jr.iTrial])
+            continue;
+
+        aafTrialDone[jr.iAlt][jr.iTrial] = TRUE;
+        AccAdd(&aAccJournal[jr.iAlt], jr.ar);
+        cTrials++;
+    }
+
+    /* append after the last whole record; one cut short when gnubg
+     * was stopped is overwritten */
+    if (fseek(pfJournal, (long) (sizeof(achMagic) + cRecords * sizeof(jr)), SEEK_SET)) {
+        outputerrf(_("Cannot write the rollout journal `%s': %s\n"), szRolloutJournal, strerror(errno));
+        fclose(pfJournal);
+        pfJournal = NULL;
+    }
+
+    if (cTrials) {
+        for (alt = 0; alt < ro_alternatives; ++alt)
+            initial_game_count += aAccJournal[alt].n;
+
+        MergeResults(aAccJournal);
+        outputf(_("Resuming the rollout with %u trials from the journal.\n"), cTrials);
+    }
+
+    g_free(aAccJournal);
+}
+
+/* Append the trials of a thread to the journal; call with MT_Exclusive()
+ * held */
+static void
+JournalWrite(GArray * pajr)
+{
+    if (pfJournal && pajr->len) {
+        if (fwrite(pajr->data, sizeof(journalrecord), pajr->len, pfJournal) < pajr->len || fflush(pfJournal)) {
+            /* reported by JournalClose() */
+            nJournalError = errno;
+            fclose(pfJournal);
+            pfJournal = NULL;
+        }
+    }
+
+    g_array_set_size(pajr, 0);
+}
+
+static void
+JournalClose(void)
+{
+    int alt;
+
+    if (pfJournal) {
+        fclose(pfJournal);
+        pfJournal = NULL;
+    }
+
+    if (nJournalError) {
+        outputerrf(_("Cannot write the rollout journal `%s': %s\n"), szRolloutJournal, strerror(nJournalError));
+        nJournalError = 0;
+    }
+
+    if (aafTrialDone) {
+        for (alt = 0; alt < ro_alternatives; ++alt)
+            g_free(aafTrialDone[alt]);
+        g_free(aafTrialDone);
+        aafTrialDone = NULL;
+    }
+}
+
+static void
+JournalAdd(GArray * pajr, int alt, int iTrial, const float ar[NUM_ROLLOUT_OUTPUTS])
+{
+    journalrecord jr;
+
+    jr.nKey = nJournalKey;
+    jr.iTrial = (guint32) iTrial;
+    jr.iAlt = (guint32) alt;
+    jr.cAlternatives = (guint32) ro_alternatives;
+    memcpy(jr.ar, ar, sizeof(jr.ar));
+    g_array_append_val(pajr, jr);
+}
+
+/* The trace is a header, the starting position of each alternative and
+ * then the games, each a tracegame followed by its tracerecords.  The
+ * games of a thread are buffered and appended with the journal. */
+#define TRACE_MAGIC "GNU Backgammon rollout trace 1\n"
+
+typedef struct {
+    guint32 nCube;
+    guint32 nMatchTo;
+    guint32 anScore[2];
+    gint8 fCubeOwner;
+    guint8 fMove;
+    guint8 fCrawford;
+    guint8 fJacoby;
+    guint8 bgv;
+    guint8 fCubeful;
+    guint8 anBoard[2][25];
+} tracealternative;
+
+typedef struct {
+    guint32 iTrial;
+    guint16 iAlt;
+    guint16 cRecords;
+} tracegame;
+
+static FILE *pfTrace;
+static char *szTrace;
+static int nTraceError;
+
+static void
+TraceOpen(void)
+{
+    const char achMagic[sizeof(TRACE_MAGIC) - 1] = TRACE_MAGIC;
+    guint32 cAlternatives = (guint32) ro_alternatives;
+    int alt, i, j;
+
+    if (!log_rollouts || !log_file_name || !*log_file_name)
+        return;
+
+    szTrace = g_strdup_printf("%s.trace", log_file_name);
+
+    if (!(pfTrace = g_fopen(szTrace, "wb"))) {
+        outputerrf(_("Cannot open the rollout trace `%s': %s\n"), szTrace, strerror(errno));
+        return;
+    }
+
+    if (fwrite(achMagic, sizeof(achMagic), 1, pfTrace) < 1 ||
+        fwrite(&cAlternatives, sizeof(cAlternatives), 1, pfTrace) < 1)
+        nTraceError = errno;
+
+    for (alt = 0; alt < ro_alternatives && !nTraceError; ++alt) {
+        const cubeinfo *pci = ro_apci[alt];
+        tracealternative ta;
+
+        memset(&ta, 0, sizeof(ta));
+        ta.nCube = (guint32) pci->nCube;
+        ta.nMatchTo = (guint32) pci->nMatchTo;
+        ta.anScore[0] = (guint32) pci->anScore[0];
+        ta.anScore[1] = (guint32) pci->anScore[1];
+        ta.fCubeOwner = (gint8) pci->fCubeOwner;
+        ta.fMove = (guint8) pci->fMove;
+        ta.fCrawford = (guint8) pci->fCrawford;
+        ta.fJacoby = (guint8) pci->fJacoby;
+        ta.bgv = (guint8) pci->bgv;
+        ta.fCubeful = (guint8) ro_apes[alt]->rc.fCubeful;
+        for (i = 0; i < 2; i++)
+            for (j = 0; j < 25; j++)
+                ta.anBoard[i][j] = (guint8) ro_apBoard[alt][i][j];
+
+        if (fwrite(&ta, sizeof(ta), 1, pfTrace) < 1)
+            nTraceError = errno;
+    }
+
+    if (nTraceError) {
+        fclose(pfTrace);
+        pfTrace = NULL;
+    }
+}
+
+/* Append the games of a thread to the trace; call with MT_Exclusive()
+ * held */
+static void
+TraceWrite(GByteArray * pbaTrace)
+{
+    if (pfTrace && pbaTrace->len) {
+        if (fwrite(pbaTrace->data, 1, pbaTrace->len, pfTrace) < pbaTrace->len) {
+            /* reported by TraceClose() */
+            nTraceError = errno;
+            fclose(pfTrace);
+            pfTrace = NULL;
+        }
+    }
+
+    g_byte_array_set_size(pbaTrace, 0);
+}
+
+static void
+TraceClose(void)
+{
+    if (pfTrace) {
+        if (fclose(pfTrace))
+            nTraceError = errno;
+        pfTrace = NULL;
+    }
+
+    if (nTraceError) {
+        outputerrf(_("Cannot write the rollout trace `%s': %s\n"), szTrace, strerror(nTraceError));
+        nTraceError = 0;
+    }
+
+    g_free(szTrace);
+    szTrace = NULL;
+}
+
+static void
+TraceAdd(GByteArray * pbaTrace, int alt, int iTrial, const GArray * paTrace)
+{
+    tracegame tg;
+
+    if (paTrace->len > G_MAXUINT16)
+        return;
+
+    tg.iTrial = (guint32) iTrial;
+    tg.iAlt = (guint16) alt;
+    tg.cRecords = (guint16) paTrace->len;
+    g_byte_array_append(pbaTrace, (const guint8 *) &tg, sizeof(tg));
+    g_byte_array_append(pbaTrace, (const guint8 *) paTrace->data, paTrace->len * sizeof(tracerecord));
+}
+
+/* Write the games of a trial in a rollout trace as .sgf files, named
+ * as the trace with the trial and alternative */
+extern void
+CommandRolloutTrace(char *sz)
+{
+    char *szFile = NextToken(&sz);
+    char achMagic[sizeof(TRACE_MAGIC) - 1];
+    guint32 cAlternatives;
+    tracealternative *ata = NULL;
+    tracegame tg;
+    tracerecord *atr = NULL;
+    char *szBase;
+    FILE *pf;
+    int iTrial, c = 0;
+
+    if (!szFile || !*szFile) {
+        outputl(_("You must specify a rollout trace file and a trial (see `help rollout trace')."));
+        return;
+    }
+
+    if ((iTrial = ParseNumber(&sz)) < 0) {
+        outputl(_("You must specify the trial to write (see `help rollout trace')."));
+        return;
+    }
+
+    if (!(pf = g_fopen(szFile, "rb"))) {
+        outputerrf(_("Cannot open the rollout trace `%s': %s\n"), szFile, strerror(errno));
+        return;
+    }
+
+    if (fread(achMagic, sizeof(achMagic), 1, pf) < 1 || memcmp(achMagic, TRACE_MAGIC, sizeof(achMagic)) ||
+        fread(&cAlternatives, sizeof(cAlternatives), 1, pf) < 1 || cAlternatives > G_MAXUINT16 ||
+        fread(ata = g_new(tracealternative, cAlternatives), sizeof(tracealternative), cAlternatives, pf)
+        < cAlternatives) {
+        outputerrf(_("`%s' is not a rollout trace\n"), szFile);
+        g_free(ata);
+        fclose(pf);
+        return;
+    }
+
+    szBase = g_str_has_suffix(szFile, ".trace") ? g_strndup(szFile, strlen(szFile) - 6) : g_strdup(szFile);
+    atr = g_new(tracerecord, G_MAXUINT16);
+
+    while (fread(&tg, sizeof(tg), 1, pf) == 1 && fread(atr, sizeof(tracerecord), tg.cRecords, pf) == tg.cRecords) {
+        const tracealternative *pta = ata + tg.iAlt;
+        TanBoard anBoard;
+        cubeinfo ci;
+        int anScore[2];
+        char *szSGF;
+        FILE *logfp;
+        unsigned int i, j;
+
+        if (tg.iTrial != (guint32) iTrial || tg.iAlt >= cAlternatives)
+            continue;
+
+        for (i = 0; i < 2; i++)
+            for (j = 0; j < 25; j++)
+                anBoard[i][j] = pta->anBoard[i][j];
+
+        anScore[0] = (int) pta->anScore[0];
+        anScore[1] = (int) pta->anScore[1];
+        SetCubeInfo(&ci, (int) pta->nCube, pta->fCubeOwner, pta->fMove, (int) pta->nMatchTo,
+                    anScore, pta->fCrawford, pta->fJacoby, FALSE, (bgvariation) pta->bgv);
+
+        szSGF = g_strdup_printf("%s-%7.7d-%c.sgf", szBase, iTrial, tg.iAlt + 'a');
+
+        if (!(logfp = log_game_start(szSGF, &ci, pta->fCubeful, (ConstTanBoard) anBoard))) {
+            outputerrf(_("Cannot write `%s': %s\n"), szSGF, strerror(errno));
+            g_free(szSGF);
+            break;
+        }
+
+        for (i = 0; i < tg.cRecords; i++) {
+            int side = atr[i].nType & 1;
+            int anMove[8];
+
+            switch (atr[i].nType >> 1) {
+            case TRACE_MOVE:
+                for (j = 0; j < 8; j++)
+                    anMove[j] = atr[i].anMove[j];
+                sgf_move(logfp, anMove, side, atr[i].nDice >> 4, atr[i].nDice & 15);
+                break;
+            case TRACE_TAKE:
+                sgf_cube(logfp, "double", side);
+                sgf_cube(logfp, "take", !side);
+                break;
+            case TRACE_DROP:
+                sgf_cube(logfp, "double", side);
+                sgf_cube(logfp, "drop", !side);
+                break;
+            }
+        }
+
+        log_game_over(logfp);
+        outputf(_("%s written.\n"), szSGF);
+        g_free(szSGF);
+        c++;
+    }
+
+    if (!c)
+        outputf(_("Trial %d is not in the rollout trace `%s'.\n"), iTrial, szFile);
+
+    g_free(atr);
+    g_free(szBase);
+    g_free(ata);
+    fclose(pf);
+}
+
+/* Trials claimed for a worker that was lost, for another thread to
+ * play; under MT_Exclusive() */
+typedef struct {
+    int iAlt;
+    int iTrial;
+} trialid;
+
+static GArray *paRetry;
+static int cRetry;              /* paRetry->len, for looking without the lock */
+
+static void
+GiveBackTrials(int alt, const int aiTrial[], unsigned int c)
+{
+    unsigned int k;
+
+    MT_Exclusive();
+    for (k = 0; k < c; k++) {
+        trialid ti;
+
+        ti.iAlt = alt;
+        ti.iTrial = aiTrial[k];
+        g_array_append_val(paRetry, ti);
+    }
+    MT_SafeAdd(&cRetry, (int) c);
+    MT_Release();
+}
+
+/* Claim up to c trials of alternative alt for a thread, the ones given
+ * back by lost workers first; returns how many */
+static unsigned int
+ClaimTrials(int alt, unsigned int c, int aiTrial[])
+{
+    unsigned int n = 0;
+
+    if (MT_SafeGet(&cRetry)) {
+        unsigned int i = 0;
+
+        MT_Exclusive();
+        while (i < paRetry->len && n < c) {
+            trialid *pti = &g_array_index(paRetry, trialid, i);
+
+            if (pti->iAlt != alt) {
+                i++;
+                continue;
+            }
+            /* the trials of alternatives that were stopped are dropped */
+            if (!fNoMore[alt] && !AltDecision(alt)->fDone)
+                aiTrial[n++] = pti->iTrial;
+            g_array_remove_index(paRetry, i);
+            MT_SafeDec(&cRetry);
+        }
+        MT_Release();
+    }
+
+    while (n < c) {
+        int trial = MT_SafeIncValue(&altTrialCount[alt]) - 1;
+        /* skip this one if it's already finished */
+        if (fNoMore[alt] || AltDecision(alt)->fDone || (trial >= cGames)) {
+            MT_SafeDec(&altTrialCount[alt]);
+            break;
+        }
+        /* or has had its share of the trials for now */
+        if (arAllocation && trial >= nAllocationMinimum
+            && trial >= arAllocation[alt] * MT_SafeGet(&ro_NextTrial)) {
+            MT_SafeDec(&altTrialCount[alt]);
+            break;
+        }
+        /* or played before the rollout was stopped */
+        if (aafTrialDone && aafTrialDone[alt] && aafTrialDone[alt][trial])
+            continue;
+        aiTrial[n++] = trial;
+    }
+
+    return n;
+}
+
+/* Merge the trials a thread has finished into the results, the journal
+ * and the trace, and apply the stop rules; returns FALSE when the
+ * rollout is done */
+static int
+MergeTrials(rolloutacc * aAccThread, GArray * pajr, GByteArray * pbaTrace)
+{
+    int fDone = TRUE;
+    int i;
+
+    /* Stop rolling out moves whose Equity is more than a user selected multiple of the joint standard
+     * deviation of the equity difference with the best move in the list. */
+
+    multi_debug("exclusive lock: rollout cycle update");
+    MT_Exclusive();
+    if (pajr)
+        JournalWrite(pajr);
+    if (pbaTrace)
+        TraceWrite(pbaTrace);
+    MergeResults(aAccThread);
+    for (i = 0; i < ro_decisions; ++i) {
+        decisioninfo *pdi = &ro_adi[i];
+        int active_alternatives = pdi->cAlternatives;
+
+        if (pdi->fDone)
+            continue;
+
+        if (pdi->fJsd) {
+            check_jsds(pdi, &active_alternatives);
+        }
+        if (pdi->fStopOnSTD) {
+            check_sds(pdi, &active_alternatives);
+        }
+        if (pdi->fStopOnCube) {
+            check_cube(pdi, &active_alternatives);
+        }
+        if (arAllocation && pdi->fJsd && !pdi->fCubeRollout && pdi->cAlternatives > 1)
+            AllocateTrials(pdi);
+
+        if ((active_alternatives < 2 && pdi->fStopOnJsd) || active_alternatives < 1)
+            pdi->fDone = TRUE;
+        else
+            fDone = FALSE;
+    }
+    multi_debug(fDone ? "exclusive release: rollout done early" : "exclusive release: rollout cycle update");
+    MT_Release();
+
+    return !fDone;
+}
+
+static void
+AddRolloutstat(rolloutstat * prs, const rolloutstat * prsFrom)
+{
+    int i;
+
+    for (i = 0; i < STAT_MAXCUBE; i++) {
+        prs->acWin[i] += prsFrom->acWin[i];
+        prs->acWinGammon[i] += prsFrom->acWinGammon[i];
+        prs->acWinBackgammon[i] += prsFrom->acWinBackgammon[i];
+        prs->acDoubleDrop[i] += prsFrom->acDoubleDrop[i];
+        prs->acDoubleTake[i] += prsFrom->acDoubleTake[i];
+    }
+
+    prs->nOpponentHit += prsFrom->nOpponentHit;
+    prs->rOpponentHitMove += prsFrom->rOpponentHitMove;
+    prs->nBearoffMoves += prsFrom->nBearoffMoves;
+    prs->nBearoffPipsLost += prsFrom->nBearoffPipsLost;
+    prs->nOpponentClosedOut += prsFrom->nOpponentClosedOut;
+    prs->rOpponentClosedOutMove += prsFrom->rOpponentClosedOutMove;
+}
+
+/* Whether the trials of a rollout with prc may be played in lockstep
+ * by BatchCubefulRollout() with the same results as one at a time */
+static int
+RolloutBatchable(const rolloutcontext * prc)
+{
+    int i;
+
+    /* the quasi random dice of the initial position share nSkip between
+     * the games, and manual dice must come in order */
+    if ((prc->fInitial && prc->fRotate) || prc->rngRollout == RNG_MANUAL)
+        return FALSE;
+
+    /* noise would draw random numbers in a different order */
+    for (i = 0; i < 2; i++)
+        if (prc->aecChequer[i].rNoise > 0.0f || prc->aecCube[i].rNoise > 0.0f ||
+            prc->aecChequerLate[i].rNoise > 0.0f || prc->aecCubeLate[i].rNoise > 0.0f)
+            return FALSE;
+
+    return TRUE;
+}
+
+/* Play the trials aiGame[0..cGames-1] of one alternative in lockstep,
+ * a half-move at a time for all of them.  Each trial has its own dice
+ * generator arngctx[k], seeded as for BasicCubefulRollout(), so the
+ * results are the same as playing them one after the other.  Before the
+ * chequer play of each half-move, the 0-ply evaluations of the candidate
+ * moves of all the games are run as batches through the neural nets
+ * (with variance reduction, those of the 21 rolls of each game are). */
+
+static int
+BatchCubefulRollout(TanBoard aanBoard[], float aarOutput[][NUM_ROLLOUT_OUTPUTS],
+                    const int aiGame[], const unsigned int cGames,
+                    const cubeinfo * pci, int fCubeDecTop, rolloutcontext * prc,
+                    rolloutstat ars[2], int nBasisCube, perArray * dicePerms, rngcontext * arngctx[], GArray * apaTrace[])
+{
+    rolloutevals re;
+    rolloutgame *arg = g_new(rolloutgame, cGames);
+    unsigned int (*aanDice)[2] = g_malloc(cGames * sizeof(*aanDice));
+    /* the positions and rolls to find moves for */
+    TanBoard *aanMove = g_new(TanBoard, cGames);
+    unsigned int (*aanMoveDice)[2] = g_malloc(cGames * sizeof(*aanMoveDice));
+    const cubeinfo **apciMove = g_new(const cubeinfo *, cGames);
+    unsigned int cUnfinished = cGames;
+    unsigned int k;
+    int iTurn = 0;
+    int f, r = 0;
+
+    int nTruncate = prc->fDoTruncate ? prc->nTruncate : 0x7fffffff;
+
+    InitRolloutEvals(&re, prc);
+
+    for (k = 0; k < cGames; k++)
+        InitRolloutGame(arg + k, aanBoard[k], aarOutput[k], pci, fCubeDecTop, ars, apaTrace[k]);
+
+    while ((!nTruncate || iTurn < nTruncate) && cUnfinished) {
+
+        SetRolloutTurn(&re, iTurn);
+
+        /* Cube decision */
+
+        for (k = 0; k < cGames; k++)
+            if (arg[k].fPlaying) {
+                if ((r = RolloutCube(&re, arg + k, iTurn)) < 0)
+                    goto done;
+                if (!arg[k].fPlaying)
+                    cUnfinished--;
+            }
 
-        /* fill out details of best move */
-        ajiJSD[0].rEquity = ajiJSD[0].rJSD = 0.0f;
-        ajiJSD[0].nRank = 0;
+        /* Dice */
 
-        /* rearrange ajiJSD in move order rather than equity order */
-        qsort((void *) ajiJSD, ro_alternatives, sizeof(jsdinfo), comp_jsdinfo_order);
+        for (k = 0; k < cGames; k++)
+            if (arg[k].fPlaying) {
+                if ((r = RolloutDice(iTurn, aiGame[k], prc->fInitial, aanDice[k],
+                                     &prc->rngRollout, arngctx[k], prc->fRotate, dicePerms)) < 0)
+                    goto done;
 
-    } else {
-        float eq_dp = fOutputMWC ? eq2mwc(1.0f, &aciLocal[0]) : 1.0f;
-        float eq_dt = ajiJSD[1].rEquity;
+                if (aanDice[k][0] < aanDice[k][1])
+                    swap_us(aanDice[k], aanDice[k] + 1);
+            }
 
-        if (eq_dp < eq_dt) {
-            /* compare nd to dp */
-            ajiJSD[0].rEquity = ajiJSD[0].rEquity - eq_dp;
-            denominator = ajiJSD[0].rJSD;
-            if (denominator < 1e-8f)
-                denominator = 1e-8f;
-            ajiJSD[0].rJSD = fabsf(ajiJSD[0].rEquity / denominator);
-        } else {
-            /* compare nd to dt */
-            ajiJSD[0].rEquity = ajiJSD[0].rEquity - ajiJSD[1].rEquity;
-            denominator = sqrtf(ajiJSD[0].rJSD * ajiJSD[0].rJSD + ajiJSD[1].rJSD * ajiJSD[1].rJSD);
-            if (denominator < 1e-8f)
-                denominator = 1e-8f;
-            ajiJSD[0].rJSD = fabsf(ajiJSD[0].rEquity / denominator);
-        }
-        /* compare dt to dp */
-        ajiJSD[1].rEquity = ajiJSD[1].rEquity - eq_dp;
-        denominator = ajiJSD[1].rJSD;
-        if (denominator < 1e-8f)
-            denominator = 1e-8f;
-        ajiJSD[1].rJSD = fabsf(ajiJSD[1].rEquity / denominator);
-        if (rcRollout.fStopOnJsd &&
-            (altGameCount[0] >= (rcRollout.nMinimumJsdGames)) &&
-            rcRollout.rJsdLimit < MIN(ajiJSD[0].rJSD, ajiJSD[1].rJSD)) {
-            ro_apes[0]->rc.rStoppedOnJSD = ajiJSD[0].rJSD;
-            ro_apes[1]->rc.rStoppedOnJSD = ajiJSD[1].rJSD;
-            fNoMore[0] = 1;
-            fNoMore[1] = 1;
-            *active = 0;
-        }
-    }
-}
+        /* Candidate moves of all the games, for each player on roll;
+         * with variance reduction RolloutChequer() batches the 21 rolls
+         * of each game itself */
 
-static void
-check_sds(int *active)
-{
-    int alt;
-    for (alt = 0; alt < ro_alternatives; ++alt) {
-        float s;
-        int ioutput;
-        int err_too_big = 0;
-        rolloutcontext *prc;
-        if (fNoMore[alt] || altGameCount[alt] < (rcRollout.nMinimumGames))
-            continue;
-        prc = &ro_apes[alt]->rc;
-        for (ioutput = OUTPUT_EQUITY; ioutput < NUM_ROLLOUT_OUTPUTS; ioutput++) {
-            if (ioutput == OUTPUT_EQUITY) {     /* cubeless */
-                if (!ms.nMatchTo) {     /* money game */
-                    s = fabsf(aarSigma[alt][ioutput]);
-                    if (ro_fCubeRollout) {
-                        s *= (float) (aciLocal[alt].nCube / aciLocal[0].nCube);
-                    }
-                } else {        /* match play */
-                    s = fabsf(se_mwc2eq(se_eq2mwc(aarSigma[alt][ioutput],
-                                                  &aciLocal[alt]), &aciLocal[(ro_fCubeRollout ? 0 : alt)]));
-                }
-            } else {
-                if (!prc->fCubeful)
+        for (f = 0; f < 2 && !prc->fVarRedn; f++) {
+            evalcontext *pec = re.apecChequer[f];
+            unsigned int n = 0;
+
+            if (pec->nPlies)
+                continue;
+
+            for (k = 0; k < cGames; k++) {
+                if (!arg[k].fPlaying || arg[k].ci.fMove != f)
                     continue;
-                /* cubeful */
-                if (!ms.nMatchTo) {     /* money game */
-                    s = fabsf(aarSigma[alt][ioutput]);
-                } else {
-                    s = fabsf(se_mwc2eq(aarSigma[alt][ioutput], &aciLocal[(ro_fCubeRollout ? 0 : alt)]));
-                }
-            }
 
-            if (rcRollout.rStdLimit < s) {
-                err_too_big = 1;
-                break;
+                memcpy(aanMove[n], arg[k].anBoard, sizeof(TanBoard));
+                aanMoveDice[n][0] = aanDice[k][0];
+                aanMoveDice[n][1] = aanDice[k][1];
+                apciMove[n++] = &arg[k].ci;
             }
-        }                       /* for (ioutput = OUTPUT_EQUITY; ioutput < NUM_ROLLOUT_OUTPUTS; ioutput++) */
 
-        if (!err_too_big) {
-            fNoMore[alt] = 1;
-            (*active)--;
+            FillMovesCache((const TanBoard *) aanMove, (const unsigned int (*)[2]) aanMoveDice, apciMove, n, pec);
         }
 
-    }                           /* alt = 0; alt < ro_alternatives; ++alt) */
-    if (ro_fCubeRollout && (!fNoMore[0] || !fNoMore[1])) {
-        /* cube rollouts should run the same number
-         * of trials for nd and dt */
-        fNoMore[0] = fNoMore[1] = 0;
-        *active = 2;
+        /* Chequer play */
+
+        for (k = 0; k < cGames; k++)
+            if (arg[k].fPlaying) {
+                if ((r = RolloutChequer(&re, arg + k, iTurn, aanDice[k])) < 0)
+                    goto done;
+                if (!arg[k].fPlaying)
+                    cUnfinished--;
+            }
+
+        iTurn++;
+
     }
 
+    /* evaluation at truncation */
+
+    for (k = 0; k < cGames; k++)
+        if ((r = RolloutTruncate(&re, arg + k, iTurn, nBasisCube)) < 0)
+            break;
+
+  done:
+    g_free(apciMove);
+    g_free(aanMoveDice);
+    g_free(aanMove);
+    g_free(aanDice);
+    g_free(arg);
+
+    return r < 0 ? -1 : 0;
 }
 
+/* Threads merge their trials after as many trial cycles as there are
+ * threads, or after this many milliseconds if sooner */
+#define MERGE_INTERVAL_MS 5.0
+
 extern void
 RolloutLoopMT(void *UNUSED(unused))
 {
-    TanBoard anBoardEval;
-    float aar[NUM_ROLLOUT_OUTPUTS];
-    int active_alternatives;
-    unsigned int j;
     int alt;
-    FILE *logfp = NULL;
     rolloutcontext *prc = NULL;
-    /* Each thread gets a copy of the rngctxRollout */
-    rngcontext *rngctxMTRollout = CopyRNGContext(rngctxRollout);
     perArray dicePerms;
+    /* Trials finished by this thread and not yet in aAcc */
+    rolloutacc *aAccThread = g_new0(rolloutacc, ro_alternatives);
+    unsigned int cCycles = 0;
+    double rMerged = get_time();
+    /* Trials played together, see BatchCubefulRollout() */
+    unsigned int nBatch = 1;
+    TanBoard *aanBoardEval;
+    float (*aar)[NUM_ROLLOUT_OUTPUTS];
+    int *aiTrial;
+    GArray **apaTrace;
+    rngcontext **arngctx;
+    /* Trials finished by this thread and not yet in the journal */
+    GArray *pajr = pfJournal ? g_array_new(FALSE, FALSE, sizeof(journalrecord)) : NULL;
+    /* ... and the trace */
+    GByteArray *pbaTrace = pfTrace ? g_byte_array_new() : NULL;
+    unsigned int k;
+
     dicePerms.nPermutationSeed = -1;
 
+    for (alt = 0; alt < ro_alternatives; ++alt)
+        if (RolloutBatchable(&ro_apes[alt]->rc))
+            nBatch = nRolloutBatch;
+
+    aanBoardEval = g_new(TanBoard, nBatch);
+    aar = g_malloc(nBatch * sizeof(*aar));
+    aiTrial = g_new(int, nBatch);
+    apaTrace = g_new0(GArray *, nBatch);
+    if (pbaTrace)
+        for (k = 0; k < nBatch; k++)
+            apaTrace[k] = g_array_new(FALSE, FALSE, sizeof(tracerecord));
+    /* Each trial gets a copy of the rngctxRollout */
+    arngctx = g_new(rngcontext *, nBatch);
+    for (k = 0; k < nBatch; k++)
+        arngctx[k] = CopyRNGContext(rngctxRollout);
+
     /* ============ begin rollout loop ============= */
 
-    while (MT_SafeIncValue(&ro_NextTrial) <= cGames) {
-        active_alternatives = ro_alternatives;
+    while (MT_SafeIncValue(&ro_NextTrial) <= cGames || MT_SafeGet(&cRetry)) {
+        unsigned int cCycle = 1;
+        int fClaimed = FALSE;
+
+        /* play the trials of several cycles together */
+        while (cCycle < nBatch && MT_SafeIncValue(&ro_NextTrial) <= cGames)
+            cCycle++;
 
         for (alt = 0; alt < ro_alternatives; ++alt) {
-            int trial = MT_SafeIncValue(&altTrialCount[alt]) - 1;
-            /* skip this one if it's already finished */
-            if (fNoMore[alt] || (trial > cGames)) {
-                MT_SafeDec(&altTrialCount[alt]);
+            unsigned int c = ClaimTrials(alt, cCycle, aiTrial);
+
+            if (!c)
                 continue;
-            }
 
+            fClaimed = TRUE;
 
             prc = &ro_apes[alt]->rc;
 
@@ -1159,106 +2326,277 @@ RolloutLoopMT(void *UNUSED(unused))
             if (prc->fRotate)
                 QuasiRandomSeed(&dicePerms, (int) prc->nSeed);
 
-            MT_SafeSet(&nSkip, 0);      /* not multi-thread safe do quasi random dice for initial positions */
+            for (k = 0; k < c; k++) {
+                /* ... and the RNG */
+                if (prc->rngRollout != RNG_MANUAL)
+                    InitRNGSeed((unsigned int) (prc->nSeed + (aiTrial[k] << 8)), prc->rngRollout, arngctx[k]);
 
-            /* ... and the RNG */
-            if (prc->rngRollout != RNG_MANUAL)
-                InitRNGSeed((unsigned int) (prc->nSeed + (trial << 8)), prc->rngRollout, rngctxMTRollout);
+                memcpy(aanBoardEval[k], ro_apBoard[alt], sizeof(TanBoard));
 
-            memcpy(&anBoardEval, ro_apBoard[alt], sizeof(anBoardEval));
+                if (apaTrace[k])
+                    g_array_set_size(apaTrace[k], 0);
+            }
 
             /* roll something out */
-            if (log_rollouts && log_file_name) {
-                char *log_name = g_strdup_printf("%s-%7.7d-%c.sgf", log_file_name, trial, alt + 'a');
-                logfp = log_game_start(log_name, ro_apci[alt], prc->fCubeful, anBoardEval);
-                g_free(log_name);
-            }
-            BasicCubefulRollout(&anBoardEval, &aar, 0, trial, ro_apci[alt],
-                                ro_apCubeDecTop[alt], 1, prc,
-                                ro_aarsStatistics ? ro_aarsStatistics + alt : NULL,
-                                aciLocal[ro_fCubeRollout ? 0 : alt].nCube, &dicePerms, rngctxMTRollout, logfp);
+            if (c > 1 && RolloutBatchable(prc))
+                BatchCubefulRollout(aanBoardEval, aar, aiTrial, c, ro_apci[alt],
+                                    *ro_apCubeDecTop[alt], prc,
+                                    ro_aarsStatistics ? ro_aarsStatistics[alt] : NULL,
+                                    AltCubeInfo(alt)->nCube, &dicePerms, arngctx, apaTrace);
+            else
+                for (k = 0; k < c && !MT_SafeGet(&fInterrupt); k++) {
+                    MT_SafeSet(&nSkip, 0);      /* not multi-thread safe do quasi random dice for initial positions */
 
-            if (logfp) {
-                log_game_over(logfp);
-            }
+                    BasicCubefulRollout(aanBoardEval + k, aar + k, 0, aiTrial[k], ro_apci[alt],
+                                        ro_apCubeDecTop[alt], 1, prc,
+                                        ro_aarsStatistics ? ro_aarsStatistics + alt : NULL,
+                                        AltCubeInfo(alt)->nCube, &dicePerms, arngctx[k], apaTrace[k]);
+                }
 
             if (MT_SafeGet(&fInterrupt))
                 break;
 
-            multi_debug("exclusive lock: update result for alternative");
-            MT_Exclusive();
-            altGameCount[alt]++;
+            for (k = 0; k < c; k++) {
+                if (AltDecision(alt)->fInvert)
+                    InvertEvaluationR(aar[k], ro_apci[alt]);
+
+                AccAdd(&aAccThread[alt], aar[k]);
+
+                if (pajr)
+                    JournalAdd(pajr, alt, aiTrial[k], aar[k]);
+
+                if (pbaTrace)
+                    TraceAdd(pbaTrace, alt, aiTrial[k], apaTrace[k]);
+            }
+        }                       /* for (alt = 0; alt < ro_alternatives; ++alt) */
+
+        if (MT_SafeGet(&fInterrupt))
+            break;
 
-            if (ro_fInvert)
-                InvertEvaluationR(aar, ro_apci[alt]);
+        /* the trials given back by a lost worker went to other threads;
+         * let them get on with them instead of spinning until they are
+         * done */
+        if (!fClaimed)
+            g_thread_yield();
 
-            /* apply the results */
-            for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
-                float rMuNew;
+#if !defined(USE_MULTITHREAD)
+        ProcessEvents();
+#endif
 
-                aarResult[alt][j] += aar[j];
-                rMuNew = aarResult[alt][j] / (float) altGameCount[alt];
+        /* With several threads the shared results, and the stop rules
+         * looking at them, are only brought up to date now and then */
+        if ((cCycles += cCycle) < MT_GetNumThreads() && get_time() - rMerged < MERGE_INTERVAL_MS)
+            continue;
 
-                if (altGameCount[alt] > 1) {    /* for i == 0 aarVariance is not defined */
-                    float rDelta = rMuNew - aarMu[alt][j];
+        cCycles = 0;
+        rMerged = get_time();
 
-                    aarVariance[alt][j] =
-                        aarVariance[alt][j] * (1.0f - 1.0f / (float) (altGameCount[alt] - 1)) +
-                        (float) (altGameCount[alt]) * rDelta * rDelta;
-                }
+        /* we've rolled everything out for this trial, check stopping conditions */
+        if (!MergeTrials(aAccThread, pajr, pbaTrace))
+            break;
+    }
 
-                aarMu[alt][j] = rMuNew;
+    /* the games this thread finished since it last merged */
+    multi_debug("exclusive lock: rollout thread done");
+    MT_Exclusive();
+    if (pajr)
+        JournalWrite(pajr);
+    if (pbaTrace)
+        TraceWrite(pbaTrace);
+    MergeResults(aAccThread);
+    MT_Release();
+    multi_debug("exclusive release: rollout thread done");
+
+    if (pajr)
+        g_array_free(pajr, TRUE);
+    if (pbaTrace)
+        g_byte_array_free(pbaTrace, TRUE);
+
+    for (k = 0; k < nBatch; k++) {
+        g_free(arngctx[k]);
+        if (apaTrace[k])
+            g_array_free(apaTrace[k], TRUE);
+    }
+    g_free(arngctx);
+    g_free(apaTrace);
+    g_free(aiTrial);
+    g_free(aar);
+    g_free(aanBoardEval);
+    g_free(aAccThread);
+}
 
-                if (j < OUTPUT_EQUITY) {
-                    if (aarMu[alt][j] < 0.0f)
-                        aarMu[alt][j] = 0.0f;
-                    else if (aarMu[alt][j] > 1.0f)
-                        aarMu[alt][j] = 1.0f;
-                }
+/* The trials a worker plays for a rollout server, see RolloutTrials() */
+typedef struct {
+    ConstTanBoard anBoard;
+    const cubeinfo *pci;
+    int fCubeDecTop;
+    int nBasisCube;
+    rolloutcontext *prc;
+    const int *aiTrial;
+    float (*aarOutput)[NUM_ROLLOUT_OUTPUTS];
+    rolloutstat(*aars)[2];
+    perArray dicePerms;
+    int fFailed;
+} rollouttrials;
 
-                aarSigma[alt][j] = sqrtf(aarVariance[alt][j] / (float) altGameCount[alt]);
-            }                   /* for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++ ) */
+static void
+RolloutTrial(void *data, unsigned int i)
+{
+    rollouttrials *prt = data;
+    unsigned int aanBoard[1][2][25];
+    int afCubeDecTop[1];
+    rngcontext *rngctx = CopyRNGContext(rngctxRollout);
 
-            /* For normal alternatives nGamesDone and altGameCount will be equal. For cube decisions,
-             * however, the two may differ by the number of threads minus 1. So we cheat a little bit, but
-             * it would be better if the double and nodouble alternatives weren't linked */
-            if (prc->nGamesDone < altGameCount[alt])
-                prc->nGamesDone = altGameCount[alt];
+    InitRNGSeed((unsigned int) (prt->prc->nSeed + (prt->aiTrial[i] << 8)), prt->prc->rngRollout, rngctx);
 
-            MT_Release();
-            multi_debug("exclusive release: update result for alternative");
+    memcpy(aanBoard[0], prt->anBoard, sizeof(TanBoard));
+    afCubeDecTop[0] = prt->fCubeDecTop;
 
-        }                       /* for (alt = 0; alt < ro_alternatives; ++alt) */
+    if (BasicCubefulRollout(aanBoard, prt->aarOutput + i, 0, prt->aiTrial[i], prt->pci, afCubeDecTop, 1, prt->prc,
+                            prt->aars + i, prt->nBasisCube, &prt->dicePerms, rngctx, NULL) < 0)
+        MT_SafeSet(&prt->fFailed, TRUE);
 
-        if (MT_SafeGet(&fInterrupt))
-            break;
+    g_free(rngctx);
+}
 
-        /* we've rolled everything out for this trial, check stopping conditions */
-        /* Stop rolling out moves whose Equity is more than a user selected multiple of the joint standard
-         * deviation of the equity difference with the best move in the list. */
+/* Play trials of a rollout for a rollout server, one on each thread;
+ * the statistics of all of them are returned in ars */
+extern int
+RolloutTrials(ConstTanBoard anBoard, const cubeinfo * pci, int fCubeDecTop, int nBasisCube,
+              rolloutcontext * prc, const int aiTrial[], unsigned int cTrials,
+              float aarOutput[][NUM_ROLLOUT_OUTPUTS], rolloutstat ars[2])
+{
+    rollouttrials *prt = g_new0(rollouttrials, 1);
+    unsigned int i;
+    int r;
+
+    prt->anBoard = anBoard;
+    prt->pci = pci;
+    prt->fCubeDecTop = fCubeDecTop;
+    prt->nBasisCube = nBasisCube;
+    prt->prc = prc;
+    prt->aiTrial = aiTrial;
+    prt->aarOutput = aarOutput;
+    prt->aars = g_malloc0(cTrials * sizeof(*prt->aars));
+
+    prt->dicePerms.nPermutationSeed = -1;
+    if (prc->fRotate)
+        QuasiRandomSeed(&prt->dicePerms, (int) prc->nSeed);
+
+    MT_ParallelFor(cTrials, RolloutTrial, prt);
+
+    initRolloutstat(&ars[0]);
+    initRolloutstat(&ars[1]);
+    for (i = 0; i < cTrials; i++) {
+        AddRolloutstat(&ars[0], &prt->aars[i][0]);
+        AddRolloutstat(&ars[1], &prt->aars[i][1]);
+    }
 
-#if !defined(USE_MULTITHREAD)
-        ProcessEvents();
-#endif
+    r = prt->fFailed ? -1 : 0;
 
-        multi_debug("exclusive lock: rollout cycle update");
-        MT_Exclusive();
-        if (show_jsds) {
-            check_jsds(&active_alternatives);
-        }
-        if (rcRollout.fStopOnSTD) {
-            check_sds(&active_alternatives);
+    g_free(prt->aars);
+    g_free(prt);
+
+    return r;
+}
+
+#if defined(USE_MULTITHREAD) && defined(HAVE_SOCKETS)
+/* Whether workers can play the trials of all alternatives: with dice
+ * from a generator seeded the same way everywhere */
+static int
+RolloutRemotable(void)
+{
+    int alt;
+
+    for (alt = 0; alt < ro_alternatives; ++alt) {
+        const rolloutcontext *prc = &ro_apes[alt]->rc;
+
+        if (prc->rngRollout != RNG_ISAAC && prc->rngRollout != RNG_MD5 && prc->rngRollout != RNG_MERSENNE)
+            return FALSE;
+        if (prc->fInitial && prc->fRotate)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* What RolloutLoopMT() does for a thread, for a worker on another
+ * machine; run by a thread of the server for each worker */
+static void
+RolloutWorkerLoop(rolloutworker * prw)
+{
+    /* enough to keep all the threads of the worker busy */
+    unsigned int nBatch = MIN(2 * prw->nThreads, MAX_WORKER_TRIALS);
+    rolloutacc *aAccThread = g_new0(rolloutacc, ro_alternatives);
+    GArray *pajr = pfJournal ? g_array_new(FALSE, FALSE, sizeof(journalrecord)) : NULL;
+    int *aiTrial = g_new(int, ro_alternatives * nBatch);
+    unsigned int *ac = g_new(unsigned int, ro_alternatives);
+    float (*aar)[NUM_ROLLOUT_OUTPUTS] = g_malloc(nBatch * sizeof(*aar));
+    rolloutstat ars[2];
+    int alt, fClaimed;
+    unsigned int k;
+
+    while (!prw->fLost && (MT_SafeIncValue(&ro_NextTrial) <= cGames || MT_SafeGet(&cRetry))) {
+        unsigned int cCycle = 1;
+
+        while (cCycle < nBatch && MT_SafeIncValue(&ro_NextTrial) <= cGames)
+            cCycle++;
+
+        /* claim the trials of all the cycles at once, so that they can
+         * be given back if the worker is lost */
+        for (alt = 0, fClaimed = FALSE; alt < ro_alternatives; ++alt)
+            if ((ac[alt] = ClaimTrials(alt, cCycle, aiTrial + alt * nBatch)))
+                fClaimed = TRUE;
+
+        /* see RolloutLoopMT() */
+        if (!fClaimed)
+            g_thread_yield();
+
+        for (alt = 0; alt < ro_alternatives; ++alt) {
+            int *ai = aiTrial + alt * nBatch;
+
+            if (!ac[alt])
+                continue;
+
+            if (prw->fLost ||
+                RolloutWorkerTrials(prw, ro_apBoard[alt], ro_apci[alt], *ro_apCubeDecTop[alt],
+                                    AltCubeInfo(alt)->nCube, &ro_apes[alt]->rc,
+                                    ai, ac[alt], aar, ars) < 0) {
+                GiveBackTrials(alt, ai, ac[alt]);
+                continue;
+            }
+
+            for (k = 0; k < ac[alt]; k++) {
+                if (AltDecision(alt)->fInvert)
+                    InvertEvaluationR(aar[k], ro_apci[alt]);
+
+                AccAdd(&aAccThread[alt], aar[k]);
+
+                if (pajr)
+                    JournalAdd(pajr, alt, ai[k], aar[k]);
+            }
+
+            if (ro_aarsStatistics) {
+                MT_Exclusive();
+                AddRolloutstat(&ro_aarsStatistics[alt][0], &ars[0]);
+                AddRolloutstat(&ro_aarsStatistics[alt][1], &ars[1]);
+                MT_Release();
+            }
         }
-        if ((active_alternatives < 2 && rcRollout.fStopOnJsd) || active_alternatives < 1) {
-            multi_debug("exclusive release: rollout done early");
-            MT_Release();
+
+        if (!MergeTrials(aAccThread, pajr, NULL))
             break;
-        }
-        multi_debug("exclusive release: rollout cycle update");
-        MT_Release();
     }
-    g_free(rngctxMTRollout);
+
+    if (pajr)
+        g_array_free(pajr, TRUE);
+
+    g_free(aar);
+    g_free(ac);
+    g_free(aiTrial);
+    g_free(aAccThread);
 }
+#endif
 
 static rolloutprogressfunc *ro_pfProgress;
 static void *ro_pUserData;
@@ -1276,7 +2614,8 @@ UpdateProgress(gpointer UNUSED(unused))
             rolloutcontext *prc = &ro_apes[alt]->rc;
 
             (*ro_pfProgress) (aarMu, aarSigma, prc, aciLocal, initial_game_count, altGameCount[alt] - 1, alt,
-                              ajiJSD[alt].nRank + 1, ajiJSD[alt].rJSD, fNoMore[alt], show_jsds, ro_fCubeRollout,
+                              ajiJSD[alt].nRank + 1, ajiJSD[alt].rJSD, fNoMore[alt], AltDecision(alt)->fJsd,
+                              AltDecision(alt)->fCubeRollout,
                               ro_pUserData);
         }
 
@@ -1286,15 +2625,17 @@ UpdateProgress(gpointer UNUSED(unused))
     return TRUE;
 }
 
-extern int
-RolloutGeneral(ConstTanBoard * apBoard,
-               float (*apOutput[])[NUM_ROLLOUT_OUTPUTS],
-               float (*apStdDev[])[NUM_ROLLOUT_OUTPUTS],
-               rolloutstat aarsStatistics[][2],
-               evalsetup(*apes[]),
-               const cubeinfo(*apci[]),
-               int (*apCubeDecTop[]), int alternatives,
-               int fInvert, int fCubeRollout, rolloutprogressfunc * pfProgress, void *pUserData)
+/* Roll out the alternatives of the decisions adi[] together; see
+ * RolloutGeneral() */
+static int
+RolloutGeneralDecisions(ConstTanBoard * apBoard,
+                        float (*apOutput[])[NUM_ROLLOUT_OUTPUTS],
+                        float (*apStdDev[])[NUM_ROLLOUT_OUTPUTS],
+                        rolloutstat aarsStatistics[][2],
+                        evalsetup(*apes[]),
+                        const cubeinfo(*apci[]),
+                        int (*apCubeDecTop[]), int alternatives,
+                        decisioninfo adi[], int cDecisions, rolloutprogressfunc * pfProgress, void *pUserData)
 {
     unsigned int j;
     int alt;
@@ -1303,19 +2644,32 @@ RolloutGeneral(ConstTanBoard * apBoard,
     unsigned int trialsDone;
     rolloutcontext *prc = NULL, rcRolloutSave;
     evalsetup *pes;
-    int nIsCubeless = 0;
-    int nIsCubeful = 0;
     int fOutputMWCSave = fOutputMWC;
-    int active_alternatives;
-    int previous_rollouts = 0;
-
-    show_jsds = 1;
+    int fAnyCubeRollout = FALSE, fAllCubeRollout = TRUE, fAnyJsd = FALSE;
+    int fRollout = FALSE;
+    int d;
 
     if (alternatives < 1) {
         errno = EINVAL;
         return -1;
     }
 
+    aiDecision = g_alloca(alternatives * sizeof(int));
+    for (d = 0; d < cDecisions; ++d) {
+        for (alt = adi[d].iFirst; alt < adi[d].iFirst + adi[d].cAlternatives; ++alt)
+            aiDecision[alt] = d;
+        adi[d].cPrevious = 0;
+        adi[d].fDone = FALSE;
+        adi[d].fJsd = TRUE;
+
+        if (adi[d].fCubeRollout)
+            fAnyCubeRollout = TRUE;
+        else
+            fAllCubeRollout = FALSE;
+    }
+    ro_adi = adi;
+    ro_decisions = cDecisions;
+
     ajiJSD = g_alloca(alternatives * sizeof(jsdinfo));
     fNoMore = g_alloca(alternatives * sizeof(int));
     aciLocal = g_alloca(alternatives * sizeof(cubeinfo));
@@ -1324,19 +2678,15 @@ RolloutGeneral(ConstTanBoard * apBoard,
 
     aarMu = g_alloca(alternatives * NUM_ROLLOUT_OUTPUTS * sizeof(float));
     aarSigma = g_alloca(alternatives * NUM_ROLLOUT_OUTPUTS * sizeof(float));
-    aarResult = g_alloca(alternatives * NUM_ROLLOUT_OUTPUTS * sizeof(float));
-    aarVariance = g_alloca(alternatives * NUM_ROLLOUT_OUTPUTS * sizeof(float));
+    aAcc = g_alloca(alternatives * sizeof(rolloutacc));
 
     if (ms.nMatchTo == 0)
         fOutputMWC = 0;
 
     memcpy(&rcRolloutSave, &rcRollout, sizeof(rcRollout));
-    if (alternatives == 1) {
-        rcRollout.fStopOnJsd = 0;
-    }
 
     /* make sure cube decisions are rolled out cubeful */
-    if (fCubeRollout) {
+    if (fAllCubeRollout) {
         rcRollout.fCubeful = rcRollout.aecCubeTrunc.fCubeful = rcRollout.aecChequerTrunc.fCubeful = 1;
         for (i = 0; i < 2; ++i)
             rcRollout.aecCube[i].fCubeful = rcRollout.aecChequer[i].fCubeful =
@@ -1352,6 +2702,8 @@ RolloutGeneral(ConstTanBoard * apBoard,
     nFirstTrial = cGames = rcRollout.nTrials;
     initial_game_count = 0;
     for (alt = 0; alt < alternatives; ++alt) {
+        decisioninfo *pdi = &adi[aiDecision[alt]];
+
         pes = apes[alt];
         prc = &pes->rc;
 
@@ -1365,21 +2717,27 @@ RolloutGeneral(ConstTanBoard * apBoard,
 
         /* Invert cubeinfo */
 
-        if (fInvert)
+        if (pdi->fInvert)
             aciLocal[alt].fMove = !aciLocal[alt].fMove;
 
         if ((pes->et != EVAL_ROLLOUT) || (prc->nGamesDone == 0)) {
             /* later the saved context may to be stored with the move, so cubeful/cubeless must be made
              * consistent */
             rcRolloutSave.fCubeful = rcRolloutSave.aecCubeTrunc.fCubeful =
-                rcRolloutSave.aecChequerTrunc.fCubeful = (fCubeRollout || rcRolloutSave.fCubeful);
+                rcRolloutSave.aecChequerTrunc.fCubeful = (fAnyCubeRollout || rcRolloutSave.fCubeful);
             for (i = 0; i < 2; ++i)
                 rcRolloutSave.aecCube[i].fCubeful =
                     rcRolloutSave.aecChequer[i].fCubeful =
                     rcRolloutSave.aecCubeLate[i].fCubeful =
-                    rcRolloutSave.aecChequerLate[i].fCubeful = (fCubeRollout || rcRolloutSave.fCubeful);
+                    rcRolloutSave.aecChequerLate[i].fCubeful = (fAnyCubeRollout || rcRolloutSave.fCubeful);
 
             memcpy(prc, &rcRollout, sizeof(rolloutcontext));
+            if (pdi->fCubeRollout) {
+                prc->fCubeful = prc->aecCubeTrunc.fCubeful = prc->aecChequerTrunc.fCubeful = 1;
+                for (i = 0; i < 2; ++i)
+                    prc->aecCube[i].fCubeful = prc->aecChequer[i].fCubeful =
+                        prc->aecCubeLate[i].fCubeful = prc->aecChequerLate[i].fCubeful = 1;
+            }
             prc->nGamesDone = 0;
             prc->nSkip = 0;
             nFirstTrial = 0;
@@ -1391,33 +2749,37 @@ RolloutGeneral(ConstTanBoard * apBoard,
             }
 
             /* initialise internal variables */
+            memset(&aAcc[alt], 0, sizeof(rolloutacc));
             for (j = 0; j < NUM_ROLLOUT_OUTPUTS; ++j) {
-                aarResult[alt][j] = aarVariance[alt][j] = aarMu[alt][j] = aarSigma[alt][j] = 0.0f;
+                aarMu[alt][j] = aarSigma[alt][j] = 0.0f;
             }
         } else {
             int nGames = prc->nGamesDone;
 
-            previous_rollouts++;
+            pdi->cPrevious++;
 
             /* make sure the saved rollout contexts are consistent for cubeful/not cubeful */
             prc->fCubeful = prc->aecCubeTrunc.fCubeful =
-                prc->aecChequerTrunc.fCubeful = (prc->fCubeful || fCubeRollout);
+                prc->aecChequerTrunc.fCubeful = (prc->fCubeful || pdi->fCubeRollout);
             for (i = 0; i < 2; ++i)
                 prc->aecCube[i].fCubeful = prc->aecChequer[i].fCubeful =
-                    prc->aecCubeLate[i].fCubeful = prc->aecChequerLate[i].fCubeful = (prc->fCubeful || fCubeRollout);
+                    prc->aecCubeLate[i].fCubeful = prc->aecChequerLate[i].fCubeful = (prc->fCubeful
+                                                                                      || pdi->fCubeRollout);
 
             altTrialCount[alt] = altGameCount[alt] = nGames;
             initial_game_count += nGames;
             if (nGames < nFirstTrial)
                 nFirstTrial = nGames;
             /* restore internal variables from input values */
+            aAcc[alt].n = (unsigned int) nGames;
             for (j = 0; j < NUM_ROLLOUT_OUTPUTS; ++j) {
                 float r;
 
                 r = aarMu[alt][j] = (*apOutput[alt])[j];
-                aarResult[alt][j] = r * (float) nGames;
+                aAcc[alt].arMean[j] = r;
                 r = aarSigma[alt][j] = (*apStdDev[alt])[j];
-                aarVariance[alt][j] = r * r * (float) nGames;
+                /* the standard error is sqrt(M2 / (n - 1) / n) */
+                aAcc[alt].arM2[j] = (double) r * r * nGames * (nGames - 1);
             }
         }
 
@@ -1426,26 +2788,50 @@ RolloutGeneral(ConstTanBoard * apBoard,
         prc->nTrials = cGames;
 
         pes->et = EVAL_ROLLOUT;
-        if (prc->fCubeful)
-            ++nIsCubeful;
-        else
-            ++nIsCubeless;
 
         /* we can't do JSD tricks on initial positions */
         if (prc->fInitial) {
-            rcRollout.fStopOnJsd = 0;
-            show_jsds = 0;
+            prc->fStopOnJsd = FALSE;
+            pdi->fJsd = FALSE;
         }
 
     }
 
-    /* we can't do JSD tricks if some rollouts are cubeful and some not */
-    if (nIsCubeful && nIsCubeless)
-        rcRollout.fStopOnJsd = 0;
+    for (d = 0; d < cDecisions; ++d) {
+        decisioninfo *pdi = &adi[d];
+        int nIsCubeless = 0;
+        int nIsCubeful = 0;
+
+        for (alt = pdi->iFirst; alt < pdi->iFirst + pdi->cAlternatives; ++alt) {
+            if (apes[alt]->rc.fCubeful)
+                ++nIsCubeful;
+            else
+                ++nIsCubeless;
+        }
+
+        /* we can't do JSD tricks on a single move or if some rollouts are cubeful and some not */
+        pdi->fStopOnJsd = rcRollout.fStopOnJsd && pdi->fJsd && pdi->cAlternatives > 1
+            && !(nIsCubeful && nIsCubeless);
+        if (pdi->fJsd)
+            fAnyJsd = TRUE;
+
+        /* if we're using stop on JSD, turn off stop on STD error */
+        pdi->fStopOnSTD = rcRollout.fStopOnSTD && !pdi->fStopOnJsd;
+
+        pdi->fStopOnCube = fRolloutCubeStop && pdi->fCubeRollout && nIsCubeful == pdi->cAlternatives;
+    }
 
-    /* if we're using stop on JSD, turn off stop on STD error */
-    if (rcRollout.fStopOnJsd)
-        rcRollout.fStopOnSTD = 0;
+    /* cube decisions roll out no double and double/take together */
+    arAllocation = NULL;
+    if (fRolloutAdaptive && !fAllCubeRollout && alternatives > 1 && fAnyJsd) {
+        arAllocation = g_alloca(alternatives * sizeof(float));
+        for (alt = 0; alt < alternatives; ++alt)
+            arAllocation[alt] = 1.0f;
+        /* the JSD rule must be able to stop the ones held back */
+        nAllocationMinimum = ALLOCATION_MINIMUM;
+        if (rcRollout.fStopOnJsd && rcRollout.nMinimumJsdGames > ALLOCATION_MINIMUM)
+            nAllocationMinimum = (int) rcRollout.nMinimumJsdGames;
+    }
 
     /* Put parameters in global variables - urgh, would be better in task variable really... */
     ro_alternatives = alternatives;
@@ -1454,43 +2840,91 @@ RolloutGeneral(ConstTanBoard * apBoard,
     ro_apci = apci;
     ro_apCubeDecTop = apCubeDecTop;
     ro_aarsStatistics = aarsStatistics;
-    ro_fCubeRollout = fCubeRollout;
-    ro_fInvert = fInvert;
     ro_NextTrial = nFirstTrial;
     ro_pfProgress = pfProgress;
     ro_pUserData = pUserData;
 
-    active_alternatives = ro_alternatives;
+    JournalOpen();
+    TraceOpen();
 
-    /* check if rollout alternatives are done, but only when extending
-     * all candidates */
-    if (previous_rollouts == active_alternatives) {
-        if (show_jsds) {
-            check_jsds(&active_alternatives);
-        }
-        if (rcRollout.fStopOnSTD) {
-            check_sds(&active_alternatives);
+    for (d = 0; d < cDecisions; ++d) {
+        decisioninfo *pdi = &adi[d];
+        int active_alternatives = pdi->cAlternatives;
+
+        /* check if rollout alternatives are done, but only when extending
+         * all candidates */
+        if (pdi->cPrevious == active_alternatives) {
+            if (pdi->fJsd) {
+                check_jsds(pdi, &active_alternatives);
+            }
+            if (pdi->fStopOnSTD) {
+                check_sds(pdi, &active_alternatives);
+            }
+            if (pdi->fStopOnCube) {
+                check_cube(pdi, &active_alternatives);
+            }
         }
+
+        if (active_alternatives > 1 || (!pdi->fStopOnJsd && active_alternatives > 0))
+            fRollout = TRUE;
+        else
+            pdi->fDone = TRUE;
     }
 
     UpdateProgress(NULL);
 
-    if (active_alternatives > 1 || (!rcRollout.fStopOnJsd && active_alternatives > 0)) {
+    if (fRollout) {
+        paRetry = g_array_new(FALSE, FALSE, sizeof(trialid));
+        cRetry = 0;
+
+#if defined(USE_MULTITHREAD) && defined(HAVE_SOCKETS)
+        if (RolloutRemotable())
+            RolloutServerStart(RolloutWorkerLoop);
+#endif
+
         multi_debug("rollout adding tasks");
         mt_add_tasks(MT_GetNumThreads(), RolloutLoopMT, NULL, NULL);
 
         multi_debug("rollout waiting for tasks to complete");
         MT_WaitForTasks(UpdateProgress, 2000, fAutoSaveRollout);
         multi_debug("rollout finished waiting for tasks to complete");
+
+#if defined(USE_MULTITHREAD) && defined(HAVE_SOCKETS)
+        RolloutServerStop();
+
+        /* the trials of workers lost after our threads were done */
+        while (MT_SafeGet(&cRetry) && !MT_SafeGet(&fInterrupt)) {
+            mt_add_tasks(MT_GetNumThreads(), RolloutLoopMT, NULL, NULL);
+            MT_WaitForTasks(UpdateProgress, 2000, fAutoSaveRollout);
+        }
+#endif
+
+        g_array_free(paRetry, TRUE);
+        paRetry = NULL;
     }
 
+    JournalClose();
+    TraceClose();
+
     /* Make sure final output is up to date */
 #if defined(USE_GTK)
     if (!fX)
 #endif
-        if (!MT_SafeGet(&fInterrupt))
+        if (!MT_SafeGet(&fInterrupt)) {
             outputf(_("\nRollout done. Printing final results.\n"));
 
+            if (arAllocation) {
+                unsigned int cTotal = 0;
+
+                output(_("Trials per alternative:"));
+                for (alt = 0; alt < alternatives; ++alt) {
+                    outputf(" %u", altGameCount[alt]);
+                    cTotal += altGameCount[alt];
+                }
+                outputf(" (%u in all)\n", cTotal);
+            }
+        }
+
     if (!MT_SafeGet(&fInterrupt))
         UpdateProgress(NULL);
 
@@ -1498,6 +2932,9 @@ RolloutGeneral(ConstTanBoard * apBoard,
      * more progress should be displayed.
      */
     ro_alternatives = -1;
+    arAllocation = NULL;
+    ro_adi = NULL;
+    ro_decisions = 0;
 
     for (alt = 0, trialsDone = 0; alt < alternatives; ++alt) {
         if (apes[alt]->rc.nGamesDone > trialsDone)
@@ -1537,6 +2974,162 @@ RolloutGeneral(ConstTanBoard * apBoard,
     return trialsDone;
 }
 
+extern int
+RolloutGeneral(ConstTanBoard * apBoard,
+               float (*apOutput[])[NUM_ROLLOUT_OUTPUTS],
+               float (*apStdDev[])[NUM_ROLLOUT_OUTPUTS],
+               rolloutstat aarsStatistics[][2],
+               evalsetup(*apes[]),
+               const cubeinfo(*apci[]),
+               int (*apCubeDecTop[]), int alternatives,
+               int fInvert, int fCubeRollout, rolloutprogressfunc * pfProgress, void *pUserData)
+{
+    decisioninfo di;
+
+    di.iFirst = 0;
+    di.cAlternatives = alternatives;
+    di.fInvert = fInvert;
+    di.fCubeRollout = fCubeRollout;
+
+    return RolloutGeneralDecisions(apBoard, apOutput, apStdDev, aarsStatistics, apes, apci, apCubeDecTop,
+                                   alternatives, &di, 1, pfProgress, pUserData);
+}
+
+/* Score a move from its rollout:
+ * rScore is the primary score (cubeful/cubeless)
+ * rScore2 is the secondary score (cubeless) */
+static void
+ScoreMoveRolloutResult(move * pm, const cubeinfo * pci)
+{
+    if (pm->esMove.rc.fCubeful) {
+        if (pci->nMatchTo)
+            pm->rScore = mwc2eq(pm->arEvalMove[OUTPUT_CUBEFUL_EQUITY], pci);
+        else
+            pm->rScore = pm->arEvalMove[OUTPUT_CUBEFUL_EQUITY];
+    } else
+        pm->rScore = pm->arEvalMove[OUTPUT_EQUITY];
+
+    pm->rScore2 = pm->arEvalMove[OUTPUT_EQUITY];
+}
+
+/* Roll out several decisions together, so that the threads go on with
+ * the trials of the others when one is stopped or near its end instead
+ * of waiting for it.  The moves of ard[i] are scored as by
+ * ScoreMoveRollout(), or if it has none its cube decision is rolled
+ * out as by GeneralCubeDecisionR().  The progress is reported for the
+ * alternatives of all the decisions in turn.  Returns -1 if no trials
+ * were played. */
+extern int
+RolloutDecisions(rolloutdecision ard[], int cDecisions, rolloutprogressfunc * pfProgress, void *pUserData)
+{
+    int fCubeDecTop = TRUE;
+    decisioninfo *adi = g_new(decisioninfo, cDecisions);
+    int alternatives = 0;
+    int alt, d, i, n;
+    TanBoard *anBoard;
+    ConstTanBoard *apBoard;
+    float (**apOutput)[NUM_ROLLOUT_OUTPUTS];
+    float (**apStdDev)[NUM_ROLLOUT_OUTPUTS];
+    rolloutstat(*aarsStatistics)[2];
+    evalsetup **apes;
+    const cubeinfo **apci;
+    cubeinfo *aci;
+    int **apCubeDecTop;
+
+    for (d = 0; d < cDecisions; ++d)
+        alternatives += ard[d].cMoves ? ard[d].cMoves : 2;
+
+    anBoard = g_new(TanBoard, alternatives);
+    apBoard = g_new(ConstTanBoard, alternatives);
+    apOutput = g_malloc(alternatives * sizeof(*apOutput));
+    apStdDev = g_malloc(alternatives * sizeof(*apStdDev));
+    aarsStatistics = g_malloc0(alternatives * sizeof(*aarsStatistics));
+    apes = g_new(evalsetup *, alternatives);
+    apci = g_new(const cubeinfo *, alternatives);
+    aci = g_new(cubeinfo, alternatives);
+    apCubeDecTop = g_new(int *, alternatives);
+
+    for (d = 0, alt = 0; d < cDecisions; ++d) {
+        rolloutdecision *prd = &ard[d];
+
+        adi[d].iFirst = alt;
+
+        if (prd->cMoves) {
+            /* as ScoreMoveRollout() */
+            adi[d].cAlternatives = prd->cMoves;
+            adi[d].fInvert = TRUE;
+            adi[d].fCubeRollout = FALSE;
+
+            for (i = 0; i < prd->cMoves; ++i, ++alt) {
+                apBoard[alt] = (ConstTanBoard) (anBoard + alt);
+                apOutput[alt] = &prd->ppm[i]->arEvalMove;
+                apStdDev[alt] = &prd->ppm[i]->arEvalStdDev;
+                apes[alt] = &prd->ppm[i]->esMove;
+                apci[alt] = aci + alt;
+                memcpy(aci + alt, &prd->ci, sizeof(cubeinfo));
+                apCubeDecTop[alt] = &fCubeDecTop;
+
+                PositionFromKey(anBoard[alt], &prd->ppm[i]->key);
+
+                SwapSides(anBoard[alt]);
+
+                /* swap fMove in cubeinfo */
+                aci[alt].fMove = !aci[alt].fMove;
+            }
+        } else {
+            /* as GeneralCubeDecisionR() */
+            const cubeinfo *pci = &prd->ci;
+
+            adi[d].cAlternatives = 2;
+            adi[d].fInvert = FALSE;
+            adi[d].fCubeRollout = TRUE;
+
+            SetCubeInfo(&aci[alt], pci->nCube, pci->fCubeOwner, pci->fMove,
+                        pci->nMatchTo, pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
+
+            SetCubeInfo(&aci[alt + 1], 2 * pci->nCube, !pci->fMove, pci->fMove,
+                        pci->nMatchTo, pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
+
+            for (i = 0; i < 2; ++i, ++alt) {
+                apBoard[alt] = (ConstTanBoard) prd->anBoard;
+                apOutput[alt] = &prd->aarOutput[i];
+                apStdDev[alt] = &prd->aarStdDev[i];
+                apes[alt] = prd->pes;
+                apci[alt] = aci + alt;
+                apCubeDecTop[alt] = &fCubeDecTop;
+            }
+        }
+    }
+
+    n = RolloutGeneralDecisions(apBoard, apOutput, apStdDev, aarsStatistics, apes, apci, apCubeDecTop,
+                                alternatives, adi, cDecisions, pfProgress, pUserData);
+
+    for (d = 0; n > 0 && d < cDecisions; ++d) {
+        rolloutdecision *prd = &ard[d];
+
+        if (prd->cMoves) {
+            for (i = 0; i < prd->cMoves; ++i)
+                ScoreMoveRolloutResult(prd->ppm[i], &prd->ci);
+        } else {
+            memcpy(prd->aarsStatistics, aarsStatistics[adi[d].iFirst], sizeof(prd->aarsStatistics));
+            prd->pes->rc.nSkip = MT_SafeGet(&nSkip);
+        }
+    }
+
+    g_free(apCubeDecTop);
+    g_free(aci);
+    g_free(apci);
+    g_free(apes);
+    g_free(aarsStatistics);
+    g_free(apStdDev);
+    g_free(apOutput);
+    g_free(apBoard);
+    g_free(anBoard);
+    g_free(adi);
+
+    return n > 0 ? 0 : -1;
+}
+
 /*
  * General evaluation functions.
  */
@@ -1860,26 +3453,8 @@ ScoreMoveRollout(move ** ppm, cubeinfo ** ppci, int cMoves, rolloutprogressfunc
     if (nGamesDone < 0)
         return -1;
 
-    for (i = 0; i < cMoves; ++i) {
-        const cubeinfo *pci;
-        rolloutcontext *prc;
-
-        /* Score for move:
-         * rScore is the primary score (cubeful/cubeless)
-         * rScore2 is the secondary score (cubeless) */
-        prc = &apes[i]->rc;
-        pci = apci[i];
-
-        if (prc->fCubeful) {
-            if (pci->nMatchTo)
-                ppm[i]->rScore = mwc2eq(ppm[i]->arEvalMove[OUTPUT_CUBEFUL_EQUITY], pci);
-            else
-                ppm[i]->rScore = ppm[i]->arEvalMove[OUTPUT_CUBEFUL_EQUITY];
-        } else
-            ppm[i]->rScore = ppm[i]->arEvalMove[OUTPUT_EQUITY];
-
-        ppm[i]->rScore2 = ppm[i]->arEvalMove[OUTPUT_EQUITY];
-    }
+    for (i = 0; i < cMoves; ++i)
+        ScoreMoveRolloutResult(ppm[i], apci[i]);
 
     return 0;
 }
@@ -23,6 +23,7 @@
 
 #define MAXHIT 50               /* for statistics */
 #define STAT_MAXCUBE 10
+#define MAX_ROLLOUT_BATCH 256   /* trials played together, see set rollout batch */
 
 typedef struct {
 
@@ -126,8 +127,31 @@ extern int
 ScoreMoveRollout(move ** ppm, cubeinfo ** ppci, int cMoves,
                  rolloutprogressfunc * pfRolloutProgress, void *pUserData);
 
+/* A decision for RolloutDecisions(): the moves ppm[] from the position
+ * with cubeinfo ci, or if cMoves is 0 the cube decision in anBoard with
+ * its results in aarOutput, aarStdDev and aarsStatistics */
+typedef struct {
+    move **ppm;
+    int cMoves;
+    TanBoard anBoard;
+    cubeinfo ci;
+    evalsetup *pes;
+    float aarOutput[2][NUM_ROLLOUT_OUTPUTS];
+    float aarStdDev[2][NUM_ROLLOUT_OUTPUTS];
+    rolloutstat aarsStatistics[2][2];
+} rolloutdecision;
+
+extern int
+RolloutDecisions(rolloutdecision ard[], int cDecisions,
+                 rolloutprogressfunc * pfRolloutProgress, void *pUserData);
+
 extern void RolloutLoopMT(void *unused);
 
+extern int
+RolloutTrials(ConstTanBoard anBoard, const cubeinfo * pci, int fCubeDecTop, int nBasisCube,
+              rolloutcontext * prc, const int aiTrial[], unsigned int cTrials,
+              float aarOutput[][NUM_ROLLOUT_OUTPUTS], rolloutstat ars[2]);
+
 /* Quasi-random permutation array: the first index is the "generation" of the
  * permutation (0 permutes each set of 36 rolls, 1 permutes those sets of 36
  * into 1296, etc.); the second is the roll within the game (limited to QRLEN,
@@ -142,11 +166,11 @@ typedef struct {
 EXP_LOCK_FUN(int, BasicCubefulRollout, unsigned int aanBoard[][2][25], float aarOutput[][NUM_ROLLOUT_OUTPUTS],
              int iTurn, int iGame, const cubeinfo aci[], int afCubeDecTop[], unsigned int cci, rolloutcontext * prc,
              rolloutstat aarsStatistics[][2], int nBasisCube, perArray * dicePerms, rngcontext * rngctxRollout,
-             FILE * logfp);
+             GArray * paTrace);
 
 
-extern void log_cube(FILE * logfp, const char *action, int side);
-extern void log_move(FILE * logfp, const int *anMove, int side, int die0, int die1);
+extern void log_cube(GArray * paTrace, int side, int fTake);
+extern void log_move(GArray * paTrace, const int *anMove, int side, int die0, int die1);
 extern int RolloutDice(int iTurn, int iGame, int fInitial, unsigned int anDice[2], rng * rngx, void *rngctx,
                        const int fRotate, const perArray * dicePerms);
 extern void ClosedBoard(int afClosedBoard[2], const TanBoard anBoard);
@@ -0,0 +1,933 @@
+/*
+ * Copyright (C) 2026 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+
+#if HAVE_SOCKETS
+#ifndef WIN32
+#if HAVE_SYS_SOCKET_H
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif                          /* #if HAVE_SYS_SOCKET_H */
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+#if HAVE_POLL_H
+#include <poll.h>
+#endif
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#else                           /* #ifndef WIN32 */
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif                          /* #ifndef WIN32 */
+#endif                          /* #if HAVE_SOCKETS */
+
+#include "backgammon.h"
+#include "external.h"
+#include "matchequity.h"
+#include "multithread.h"
+#include "positionid.h"
+#include "rolloutnet.h"
+
+char *szRolloutServer = NULL;
+
+#if HAVE_SOCKETS
+
+/*
+ * The messages are a type, the number of words that follow and the
+ * words, all 32 bit integers in network byte order; floats are sent
+ * as their bits.
+ *
+ * A worker starts with WORKER_HELLO: WORKER_MAGIC, WORKER_VERSION, its
+ * number of threads and the 16 bytes of its EvalCacheTag().  The server
+ * then sends WORKER_TRIALS: the position, the cube, fCubeDecTop, the
+ * basis cube, the rollout context, the number of trials and the trials.
+ * The worker plays them and replies WORKER_OUTPUTS: the number of
+ * trials, their outputs in the same order and the statistics of both
+ * sides added up.
+ */
+
+#define WORKER_MAGIC 0x474e5572 /* "GNUr" */
+#define WORKER_VERSION 1
+
+#define WORKER_HELLO 1
+#define WORKER_TRIALS 2
+#define WORKER_OUTPUTS 3
+
+/* longer messages are not ours */
+#define MAX_MESSAGE_WORDS (1 << 20)
+
+/* a worker that connects has this long to say hello */
+#define HELLO_TIMEOUT_MS 5000
+
+#if defined(WIN32)
+#define SockRecv(h, p, cb) recv((SOCKET) (h), (char *) (p), (int) (cb), 0)
+#define SockSend(h, p, cb) send((SOCKET) (h), (const char *) (p), (int) (cb), 0)
+#else
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+#define SockRecv(h, p, cb) recv((h), (p), (cb), 0)
+#define SockSend(h, p, cb) send((h), (p), (cb), MSG_NOSIGNAL)
+#endif
+
+static void
+NoSigPipe(int h)
+{
+#if defined(SO_NOSIGPIPE)
+    int f = TRUE;
+
+    setsockopt(h, SOL_SOCKET, SO_NOSIGPIPE, &f, sizeof(f));
+#else
+    (void) h;
+#endif
+}
+
+/* Wait until there is something to read on h; gives up when
+ * interrupted or after msTimeout milliseconds if that is not negative */
+static int
+WaitReadable(int h, int msTimeout)
+{
+#if !HAVE_POLL_H && !defined(WIN32)
+    /* an fd_set has no room for it */
+    if (h >= FD_SETSIZE) {
+        errno = EBADF;
+        return -1;
+    }
+#endif
+
+    while (!MT_SafeGet(&fInterrupt)) {
+#if HAVE_POLL_H
+        struct pollfd pfd;
+#else
+        fd_set fds;
+        struct timeval tv;
+#endif
+        int n;
+
+#if HAVE_POLL_H
+        pfd.fd = h;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        if ((n = poll(&pfd, 1, 250)) > 0)
+            return 0;
+#else
+        FD_ZERO(&fds);
+        FD_SET(h, &fds);
+        tv.tv_sec = 0;
+        tv.tv_usec = 250000;
+
+        if ((n = select(h + 1, &fds, NULL, NULL, &tv)) > 0)
+            return 0;
+#endif
+        if (n < 0 && errno != EINTR)
+            return -1;
+        if (msTimeout >= 0 && (msTimeout -= 250) < 0)
+            return -1;
+    }
+
+    return -1;
+}
+
+static int
+ReadAll(int h, void *p, size_t cb, int msTimeout)
+{
+    char *pch = p;
+
+    while (cb) {
+        ssize_t n;
+
+        if (WaitReadable(h, msTimeout) < 0)
+            return -1;
+
+        if ((n = SockRecv(h, pch, cb)) < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+
+        pch += n;
+        cb -= (size_t) n;
+    }
+
+    return 0;
+}
+
+static int
+WriteAll(int h, const void *p, size_t cb)
+{
+    const char *pch = p;
+
+    while (cb) {
+        ssize_t n;
+
+        if ((n = SockSend(h, pch, cb)) < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+
+        pch += n;
+        cb -= (size_t) n;
+    }
+
+    return 0;
+}
+
+static void
+PutInt(GArray * pa, guint32 n)
+{
+    n = g_htonl(n);
+    g_array_append_val(pa, n);
+}
+
+static void
+PutFloat(GArray * pa, float r)
+{
+    guint32 n;
+
+    G_STATIC_ASSERT(sizeof(r) == sizeof(n));
+    memcpy(&n, &r, sizeof(n));
+    PutInt(pa, n);
+}
+
+/* A message being built starts with its type and length */
+static GArray *
+NewMessage(guint32 nType)
+{
+    GArray *pa = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+    PutInt(pa, nType);
+    PutInt(pa, 0);
+
+    return pa;
+}
+
+static int
+SendMessage(int h, GArray * pa)
+{
+    int r;
+
+    g_array_index(pa, guint32, 1) = g_htonl(pa->len - 2);
+    r = WriteAll(h, pa->data, pa->len * sizeof(guint32));
+    g_array_free(pa, TRUE);
+
+    return r;
+}
+
+typedef struct {
+    GArray *pa;
+    unsigned int i;
+    int fError;                 /* read past the end */
+} msgreader;
+
+/* Read a message of type nType into pmr */
+static int
+ReadMessage(int h, guint32 nType, msgreader * pmr, int msTimeout)
+{
+    guint32 an[2];
+
+    if (ReadAll(h, an, sizeof(an), msTimeout) < 0)
+        return -1;
+
+    if (g_ntohl(an[0]) != nType || g_ntohl(an[1]) > MAX_MESSAGE_WORDS)
+        return -1;
+
+    g_array_set_size(pmr->pa, g_ntohl(an[1]));
+    pmr->i = 0;
+    pmr->fError = FALSE;
+
+    return ReadAll(h, pmr->pa->data, pmr->pa->len * sizeof(guint32), msTimeout);
+}
+
+static guint32
+GetInt(msgreader * pmr)
+{
+    if (pmr->i >= pmr->pa->len) {
+        pmr->fError = TRUE;
+        return 0;
+    }
+
+    return g_ntohl(g_array_index(pmr->pa, guint32, pmr->i++));
+}
+
+static float
+GetFloat(msgreader * pmr)
+{
+    guint32 n = GetInt(pmr);
+    float r;
+
+    memcpy(&r, &n, sizeof(r));
+
+    return r;
+}
+
+static void
+PutEval(GArray * pa, const evalcontext * pec)
+{
+    PutInt(pa, pec->fCubeful);
+    PutInt(pa, pec->nPlies);
+    PutInt(pa, pec->fUsePrune);
+    PutInt(pa, pec->fDeterministic);
+    PutFloat(pa, pec->rNoise);
+}
+
+static void
+GetEval(msgreader * pmr, evalcontext * pec)
+{
+    guint32 nPlies;
+
+    pec->fCubeful = GetInt(pmr) & 1;
+    nPlies = GetInt(pmr);
+    pec->fUsePrune = GetInt(pmr) & 1;
+    pec->fDeterministic = GetInt(pmr) & 1;
+    pec->rNoise = GetFloat(pmr);
+
+    /* the plies index the move filters */
+    if (nPlies > MAX_FILTER_PLIES || !isfinite(pec->rNoise) || pec->rNoise < 0.0f)
+        pmr->fError = TRUE;
+    else
+        pec->nPlies = nPlies;
+}
+
+static void
+PutFilters(GArray * pa, movefilter aaamf[2][MAX_FILTER_PLIES][MAX_FILTER_PLIES])
+{
+    int i, j, k;
+
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < MAX_FILTER_PLIES; j++)
+            for (k = 0; k < MAX_FILTER_PLIES; k++) {
+                PutInt(pa, (guint32) aaamf[i][j][k].Accept);
+                PutInt(pa, (guint32) aaamf[i][j][k].Extra);
+                PutFloat(pa, aaamf[i][j][k].Threshold);
+            }
+}
+
+static void
+GetFilters(msgreader * pmr, movefilter aaamf[2][MAX_FILTER_PLIES][MAX_FILTER_PLIES])
+{
+    int i, j, k;
+
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < MAX_FILTER_PLIES; j++)
+            for (k = 0; k < MAX_FILTER_PLIES; k++) {
+                movefilter *pmf = &aaamf[i][j][k];
+
+                pmf->Accept = (int) GetInt(pmr);
+                pmf->Extra = (int) GetInt(pmr);
+                pmf->Threshold = GetFloat(pmr);
+
+                if (pmf->Accept < -1 || pmf->Accept > MAX_MOVES || pmf->Extra < -1 || pmf->Extra > MAX_MOVES
+                    || !isfinite(pmf->Threshold) || pmf->Threshold < 0.0f)
+                    pmr->fError = TRUE;
+            }
+}
+
+/* What decides how the trials are played; the stop rules and counts
+ * are left to the server */
+static void
+PutRolloutContext(GArray * pa, const rolloutcontext * prc)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        PutEval(pa, &prc->aecCube[i]);
+        PutEval(pa, &prc->aecChequer[i]);
+        PutEval(pa, &prc->aecCubeLate[i]);
+        PutEval(pa, &prc->aecChequerLate[i]);
+    }
+    PutEval(pa, &prc->aecCubeTrunc);
+    PutEval(pa, &prc->aecChequerTrunc);
+    PutFilters(pa, (movefilter(*)[MAX_FILTER_PLIES][MAX_FILTER_PLIES]) prc->aaamfChequer);
+    PutFilters(pa, (movefilter(*)[MAX_FILTER_PLIES][MAX_FILTER_PLIES]) prc->aaamfLate);
+
+    PutInt(pa, prc->fCubeful);
+    PutInt(pa, prc->fVarRedn);
+    PutInt(pa, prc->fInitial);
+    PutInt(pa, prc->fRotate);
+    PutInt(pa, prc->fTruncBearoff2);
+    PutInt(pa, prc->fTruncBearoffOS);
+    PutInt(pa, prc->fLateEvals);
+    PutInt(pa, prc->fDoTruncate);
+    PutInt(pa, prc->nTruncate);
+    PutInt(pa, prc->nLate);
+    PutInt(pa, prc->rngRollout);
+    /* only the low bits reach InitRNGSeed() */
+    PutInt(pa, (guint32) prc->nSeed);
+}
+
+static void
+GetRolloutContext(msgreader * pmr, rolloutcontext * prc)
+{
+    int i;
+
+    memset(prc, 0, sizeof(*prc));
+
+    for (i = 0; i < 2; i++) {
+        GetEval(pmr, &prc->aecCube[i]);
+        GetEval(pmr, &prc->aecChequer[i]);
+        GetEval(pmr, &prc->aecCubeLate[i]);
+        GetEval(pmr, &prc->aecChequerLate[i]);
+    }
+    GetEval(pmr, &prc->aecCubeTrunc);
+    GetEval(pmr, &prc->aecChequerTrunc);
+    GetFilters(pmr, prc->aaamfChequer);
+    GetFilters(pmr, prc->aaamfLate);
+
+    prc->fCubeful = GetInt(pmr) & 1;
+    prc->fVarRedn = GetInt(pmr) & 1;
+    prc->fInitial = GetInt(pmr) & 1;
+    prc->fRotate = GetInt(pmr) & 1;
+    prc->fTruncBearoff2 = GetInt(pmr) & 1;
+    prc->fTruncBearoffOS = GetInt(pmr) & 1;
+    prc->fLateEvals = GetInt(pmr) & 1;
+    prc->fDoTruncate = GetInt(pmr) & 1;
+    prc->nTruncate = (unsigned short) GetInt(pmr);
+    prc->nLate = (unsigned short) GetInt(pmr);
+    prc->rngRollout = (rng) GetInt(pmr);
+    prc->nSeed = GetInt(pmr);
+
+    if (prc->rngRollout != RNG_ISAAC && prc->rngRollout != RNG_MD5 && prc->rngRollout != RNG_MERSENNE)
+        pmr->fError = TRUE;
+}
+
+static void
+PutCubeinfo(GArray * pa, const cubeinfo * pci)
+{
+    int i;
+
+    PutInt(pa, (guint32) pci->nCube);
+    PutInt(pa, (guint32) pci->fCubeOwner);
+    PutInt(pa, (guint32) pci->fMove);
+    PutInt(pa, (guint32) pci->nMatchTo);
+    PutInt(pa, (guint32) pci->anScore[0]);
+    PutInt(pa, (guint32) pci->anScore[1]);
+    /* fBeavers may be the number of beavers allowed */
+    PutInt(pa, pci->fCrawford != 0);
+    PutInt(pa, pci->fJacoby != 0);
+    PutInt(pa, pci->fBeavers != 0);
+    for (i = 0; i < 4; i++)
+        PutFloat(pa, pci->arGammonPrice[i]);
+    PutInt(pa, pci->bgv);
+}
+
+/* A positive power of two */
+static int
+IsCubeValue(int n)
+{
+    return n > 0 && !(n & (n - 1));
+}
+
+static void
+GetCubeinfo(msgreader * pmr, cubeinfo * pci)
+{
+    int i;
+
+    pci->nCube = (int) GetInt(pmr);
+    pci->fCubeOwner = (int) GetInt(pmr);
+    pci->fMove = (int) GetInt(pmr) & 1;
+    pci->nMatchTo = (int) GetInt(pmr);
+    pci->anScore[0] = (int) GetInt(pmr);
+    pci->anScore[1] = (int) GetInt(pmr);
+    pci->fCrawford = (int) GetInt(pmr);
+    pci->fJacoby = (int) GetInt(pmr);
+    pci->fBeavers = (int) GetInt(pmr);
+    for (i = 0; i < 4; i++)
+        pci->arGammonPrice[i] = GetFloat(pmr);
+    pci->bgv = (bgvariation) GetInt(pmr);
+
+    if (pci->bgv >= NUM_VARIATIONS || pci->fCubeOwner < -1 || pci->fCubeOwner > 1
+        || !IsCubeValue(pci->nCube) || pci->nMatchTo < 0 || pci->nMatchTo > MAXSCORE
+        || (pci->fCrawford & ~1) || (pci->fJacoby & ~1) || (pci->fBeavers & ~1))
+        pmr->fError = TRUE;
+
+    if (pci->nMatchTo)
+        for (i = 0; i < 2; i++)
+            if (pci->anScore[i] < 0 || pci->anScore[i] >= pci->nMatchTo)
+                pmr->fError = TRUE;
+}
+
+/* rolloutstat is made of ints only */
+#define STAT_WORDS (sizeof(rolloutstat) / sizeof(int))
+
+static void
+PutStatistics(GArray * pa, const rolloutstat ars[2])
+{
+    const int *pn = (const int *) ars;
+    unsigned int i;
+
+    for (i = 0; i < 2 * STAT_WORDS; i++)
+        PutInt(pa, (guint32) pn[i]);
+}
+
+static void
+GetStatistics(msgreader * pmr, rolloutstat ars[2])
+{
+    int *pn = (int *) ars;
+    unsigned int i;
+
+    for (i = 0; i < 2 * STAT_WORDS; i++)
+        pn[i] = (int) GetInt(pmr);
+}
+
+/* Have a worker play trials of an alternative; the connection is given
+ * up on any error */
+extern int
+RolloutWorkerTrials(rolloutworker * prw, ConstTanBoard anBoard, const cubeinfo * pci,
+                    int fCubeDecTop, int nBasisCube, const rolloutcontext * prc,
+                    const int aiTrial[], unsigned int cTrials,
+                    float aarOutput[][NUM_ROLLOUT_OUTPUTS], rolloutstat ars[2])
+{
+    GArray *pa = NewMessage(WORKER_TRIALS);
+    msgreader mr;
+    unsigned int i, j;
+
+    g_assert(cTrials <= MAX_WORKER_TRIALS);
+
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < 25; j++)
+            PutInt(pa, anBoard[i][j]);
+    PutCubeinfo(pa, pci);
+    PutInt(pa, (guint32) fCubeDecTop);
+    PutInt(pa, (guint32) nBasisCube);
+    PutRolloutContext(pa, prc);
+    PutInt(pa, cTrials);
+    for (i = 0; i < cTrials; i++)
+        PutInt(pa, (guint32) aiTrial[i]);
+
+    if (SendMessage(prw->h, pa) < 0) {
+        prw->fLost = TRUE;
+        return -1;
+    }
+
+    mr.pa = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+    if (ReadMessage(prw->h, WORKER_OUTPUTS, &mr, -1) < 0 || GetInt(&mr) != cTrials)
+        prw->fLost = TRUE;
+    else {
+        for (i = 0; i < cTrials; i++)
+            for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++)
+                aarOutput[i][j] = GetFloat(&mr);
+        GetStatistics(&mr, ars);
+
+        prw->fLost = mr.fError;
+    }
+
+    g_array_free(mr.pa, TRUE);
+
+    return prw->fLost ? -1 : 0;
+}
+
+#if defined(USE_MULTITHREAD)
+
+static int hListen = -1;
+static GList *plWorkers;        /* rolloutworker *, under MT_Exclusive() while rolling out */
+static rolloutworkerfunc *pfWorker;
+static unsigned char auchTagServer[16];
+static GThread *ptAccept;
+static int fStopAccepting;
+
+static void
+WorkerFree(rolloutworker * prw)
+{
+    closesocket(prw->h);
+    g_free(prw->szName);
+    g_free(prw);
+}
+
+static gpointer
+WorkerThread(gpointer p)
+{
+    rolloutworker *prw = p;
+
+    pfWorker(prw);
+
+    return NULL;
+}
+
+static void
+StartWorker(rolloutworker * prw)
+{
+    if ((prw->fRefused = memcmp(prw->auchTag, auchTagServer, sizeof(auchTagServer)) != 0))
+        return;
+
+#if GLIB_CHECK_VERSION (2,32,0)
+    prw->pt = g_thread_try_new(NULL, WorkerThread, prw, NULL);
+#else
+    prw->pt = g_thread_create(WorkerThread, prw, TRUE, NULL);
+#endif
+}
+
+/* Accept a worker that connects and read its hello */
+static rolloutworker *
+AcceptWorker(void)
+{
+    struct sockaddr_in saRemote;    /* ExternalSocket() only does Internet sockets */
+    socklen_t saLen = sizeof(saRemote);
+    rolloutworker *prw;
+    msgreader mr;
+    int h, i;
+
+    if ((h = accept(hListen, (struct sockaddr *) &saRemote, &saLen)) < 0)
+        return NULL;
+
+    NoSigPipe(h);
+
+    mr.pa = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+    if (ReadMessage(h, WORKER_HELLO, &mr, HELLO_TIMEOUT_MS) < 0 || GetInt(&mr) != WORKER_MAGIC
+        || GetInt(&mr) != WORKER_VERSION) {
+        g_array_free(mr.pa, TRUE);
+        closesocket(h);
+        return NULL;
+    }
+
+    prw = g_new0(rolloutworker, 1);
+    prw->h = h;
+    prw->szName = g_strdup(inet_ntoa(saRemote.sin_addr));
+    prw->nThreads = CLAMP(GetInt(&mr), 1, MAX_WORKER_TRIALS / 2);
+    for (i = 0; i < 16; i++)
+        prw->auchTag[i] = (unsigned char) GetInt(&mr);
+
+    if (mr.fError) {
+        WorkerFree(prw);
+        prw = NULL;
+    }
+
+    g_array_free(mr.pa, TRUE);
+
+    return prw;
+}
+
+/* Workers connecting during a rollout join it */
+static gpointer
+AcceptLoop(gpointer UNUSED(p))
+{
+    while (!MT_SafeGet(&fStopAccepting)) {
+        rolloutworker *prw;
+
+        if (WaitReadable(hListen, 250) < 0 || !(prw = AcceptWorker()))
+            continue;
+
+        MT_Exclusive();
+        plWorkers = g_list_append(plWorkers, prw);
+        StartWorker(prw);
+        MT_Release();
+    }
+
+    return NULL;
+}
+
+/* Listen for workers on szAddress.  Without a host only workers on
+ * this machine can connect; the workers are not authenticated and the
+ * server takes the results they send back as they are, so listening on
+ * other addresses is for networks whose machines are all trusted. */
+extern int
+RolloutServerListen(const char *szAddress)
+{
+    struct sockaddr *psa;
+    socklen_t cb;
+    char *sz = *szAddress == ':' ? g_strconcat("127.0.0.1", szAddress, NULL) : g_strdup(szAddress);
+    int h;
+
+    RolloutServerClose();
+
+    if ((h = ExternalSocket(&psa, &cb, sz)) < 0) {
+        SockErr(szAddress);
+        g_free(sz);
+        return -1;
+    }
+
+    if (bind(h, psa, cb) < 0 || listen(h, 16) < 0) {
+        SockErr(szAddress);
+        closesocket(h);
+        g_free(psa);
+        g_free(sz);
+        return -1;
+    }
+
+    /* 127.x.x.x */
+    if (ntohl(((struct sockaddr_in *) psa)->sin_addr.s_addr) >> 24 != 127)
+        outputl(_("Rollout workers on other machines can connect.  They are not authenticated\n"
+                  "and their results are used as they are, so anyone who can reach this\n"
+                  "address can spoil your rollouts.  Only do this on a network you trust."));
+
+    g_free(psa);
+
+    hListen = h;
+    szRolloutServer = sz;
+
+    return 0;
+}
+
+extern void
+RolloutServerClose(void)
+{
+    g_list_free_full(plWorkers, (GDestroyNotify) WorkerFree);
+    plWorkers = NULL;
+
+    if (hListen >= 0) {
+        closesocket(hListen);
+        hListen = -1;
+    }
+
+    g_free(szRolloutServer);
+    szRolloutServer = NULL;
+}
+
+/* Start a thread running pf for each worker, now and as they connect */
+extern void
+RolloutServerStart(rolloutworkerfunc * pf)
+{
+    GList *pl;
+
+    if (hListen < 0)
+        return;
+
+    pfWorker = pf;
+    EvalCacheTag(auchTagServer);
+
+    for (pl = plWorkers; pl; pl = pl->next)
+        StartWorker(pl->data);
+
+    MT_SafeSet(&fStopAccepting, FALSE);
+#if GLIB_CHECK_VERSION (2,32,0)
+    ptAccept = g_thread_try_new(NULL, AcceptLoop, NULL, NULL);
+#else
+    ptAccept = g_thread_create(AcceptLoop, NULL, TRUE, NULL);
+#endif
+}
+
+/* Wait for the workers to finish the trials they have and drop the
+ * ones we cannot use */
+extern void
+RolloutServerStop(void)
+{
+    GList *pl, *plNext;
+
+    if (hListen < 0)
+        return;
+
+    MT_SafeSet(&fStopAccepting, TRUE);
+    if (ptAccept)
+        g_thread_join(ptAccept);
+    ptAccept = NULL;
+
+    for (pl = plWorkers; pl; pl = plNext) {
+        rolloutworker *prw = pl->data;
+
+        plNext = pl->next;
+
+        if (prw->pt)
+            g_thread_join(prw->pt);
+        prw->pt = NULL;
+
+        if (prw->fRefused)
+            outputerrf(_("The rollout worker at %s does not use the same neural nets, "
+                         "precision, bearoff databases and match equity table.\n"), prw->szName);
+        else if (prw->fLost && !MT_SafeGet(&fInterrupt))
+            outputerrf(_("Lost the rollout worker at %s.\n"), prw->szName);
+        else
+            continue;
+
+        WorkerFree(prw);
+        plWorkers = g_list_delete_link(plWorkers, pl);
+    }
+}
+
+#endif                          /* USE_MULTITHREAD */
+
+static int
+ConnectServer(char *szAddress)
+{
+    struct sockaddr *psa;
+    socklen_t cb;
+    int h;
+
+    if ((h = ExternalSocket(&psa, &cb, szAddress)) < 0)
+        return -1;
+
+    if (connect(h, psa, cb) < 0) {
+        closesocket(h);
+        h = -1;
+    } else
+        NoSigPipe(h);
+
+    g_free(psa);
+
+    return h;
+}
+
+/* Play the trials the server sends until it goes away */
+static void
+ServeTrials(int h)
+{
+    GArray *pa = NewMessage(WORKER_HELLO);
+    unsigned char auchTag[16];
+    msgreader mr;
+    int i;
+
+    EvalCacheTag(auchTag);
+
+    PutInt(pa, WORKER_MAGIC);
+    PutInt(pa, WORKER_VERSION);
+    PutInt(pa, MT_GetNumThreads());
+    for (i = 0; i < 16; i++)
+        PutInt(pa, auchTag[i]);
+
+    if (SendMessage(h, pa) < 0)
+        return;
+
+    mr.pa = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+    while (ReadMessage(h, WORKER_TRIALS, &mr, -1) == 0) {
+        TanBoard anBoard;
+        cubeinfo ci;
+        rolloutcontext rc;
+        int fCubeDecTop, nBasisCube;
+        unsigned int cTrials, j, k;
+        int *aiTrial;
+        float (*aar)[NUM_ROLLOUT_OUTPUTS];
+        rolloutstat ars[2];
+        int r;
+
+        for (i = 0; i < 2; i++)
+            for (j = 0; j < 25; j++)
+                anBoard[i][j] = MIN(GetInt(&mr), 15);
+        GetCubeinfo(&mr, &ci);
+        fCubeDecTop = (int) GetInt(&mr);
+        nBasisCube = (int) GetInt(&mr);
+        GetRolloutContext(&mr, &rc);
+
+        if ((cTrials = GetInt(&mr)) > MAX_WORKER_TRIALS || !IsCubeValue(nBasisCube) || mr.fError
+            || !CheckPosition((ConstTanBoard) anBoard))
+            break;
+
+        aiTrial = g_new(int, cTrials);
+        for (k = 0; k < cTrials; k++)
+            aiTrial[k] = (int) GetInt(&mr);
+
+        aar = g_malloc(cTrials * sizeof(*aar));
+
+        if ((r = mr.fError ? -1 : RolloutTrials((ConstTanBoard) anBoard, &ci, fCubeDecTop, nBasisCube, &rc,
+                                                aiTrial, cTrials, aar, ars)) == 0) {
+            pa = NewMessage(WORKER_OUTPUTS);
+            PutInt(pa, cTrials);
+            for (k = 0; k < cTrials; k++)
+                for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++)
+                    PutFloat(pa, aar[k][j]);
+            PutStatistics(pa, ars);
+
+            r = SendMessage(h, pa);
+        }
+
+        g_free(aar);
+        g_free(aiTrial);
+
+        if (r < 0)
+            break;
+    }
+
+    g_array_free(mr.pa, TRUE);
+}
+
+#endif                          /* HAVE_SOCKETS */
+
+#if !HAVE_SOCKETS || !defined(USE_MULTITHREAD)
+
+extern int
+RolloutServerListen(const char *UNUSED(szAddress))
+{
+    outputl(_("This installation of GNU Backgammon was compiled without\n"
+              "multithreading or socket support, and cannot hand out\n"
+              "rollouts to workers."));
+    return -1;
+}
+
+extern void
+RolloutServerClose(void)
+{
+}
+
+extern void
+RolloutServerStart(rolloutworkerfunc * UNUSED(pf))
+{
+}
+
+extern void
+RolloutServerStop(void)
+{
+}
+
+#endif                          /* !HAVE_SOCKETS || !USE_MULTITHREAD */
+
+extern void
+CommandRolloutWorker(char *sz)
+{
+#if !HAVE_SOCKETS
+    (void) sz;                  /* silence compiler warning */
+    outputl(_("This installation of GNU Backgammon was compiled without\n"
+              "socket support, and cannot work for a rollout server."));
+#else
+    char *szAddress = NextToken(&sz);
+
+    if (!szAddress || !*szAddress) {
+        outputl(_("You must specify the address of the rollout server (host:port)."));
+        return;
+    }
+
+    szAddress = g_strdup(szAddress);
+
+    outputf(_("Playing rollout trials for %s until interrupted.\n"), szAddress);
+    outputx();
+
+    while (!MT_SafeGet(&fInterrupt)) {
+        int h, i;
+
+        if ((h = ConnectServer(szAddress)) < 0) {
+            /* the server may not be up yet */
+            for (i = 0; i < 20 && !MT_SafeGet(&fInterrupt); i++) {
+                ProcessEvents();
+                g_usleep(250000);
+            }
+            continue;
+        }
+
+        outputf(_("Connected to %s.\n"), szAddress);
+        outputx();
+
+        ServeTrials(h);
+        closesocket(h);
+
+        if (!MT_SafeGet(&fInterrupt)) {
+            outputf(_("Lost the connection to %s.\n"), szAddress);
+            outputx();
+        }
+    }
+
+    g_free(szAddress);
+#endif
+}
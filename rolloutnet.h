@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2026 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Rollouts spread over several machines: the gnubg running a rollout
+ * listens for workers ("set rollout server"), gnubg processes started
+ * with "rollout worker" on other machines connect to it, and each is
+ * sent the trials of an alternative to play and returns their outputs.
+ */
+
+#ifndef ROLLOUTNET_H
+#define ROLLOUTNET_H
+
+#include <glib.h>
+
+#include "eval.h"
+#include "rollout.h"
+
+/* the most trials sent to a worker at once */
+#define MAX_WORKER_TRIALS 1024
+
+typedef struct {
+    int h;                      /* the connection */
+    char *szName;               /* the address of the worker */
+    unsigned int nThreads;      /* the threads the worker plays trials with */
+    unsigned char auchTag[16];  /* its nets, databases and MET, see EvalCacheTag() */
+    int fLost;                  /* the connection failed */
+    int fRefused;               /* the worker evaluates differently from us */
+    GThread *pt;
+} rolloutworker;
+
+typedef void (rolloutworkerfunc) (rolloutworker * prw);
+
+extern int RolloutServerListen(const char *szAddress);
+extern void RolloutServerClose(void);
+extern void RolloutServerStart(rolloutworkerfunc * pf);
+extern void RolloutServerStop(void);
+
+extern int
+RolloutWorkerTrials(rolloutworker * prw, ConstTanBoard anBoard, const cubeinfo * pci,
+                    int fCubeDecTop, int nBasisCube, const rolloutcontext * prc,
+                    const int aiTrial[], unsigned int cTrials,
+                    float aarOutput[][NUM_ROLLOUT_OUTPUTS], rolloutstat ars[2]);
+
+#endif                          /* ROLLOUTNET_H */
@@ -84,6 +84,7 @@
 #include "inc3d.h"
 #endif
 #include "multithread.h"
+#include "rolloutnet.h"
 
 static int iPlayerSet, iPlayerLateSet;
 
@@ -669,6 +670,15 @@ extern void
 CommandSetCache(char *sz)
 {
     int n;
+
+    while (sz && isspace(*sz))
+        ++sz;
+
+    if (sz && *sz && !isdigit(*sz)) {
+        HandleCommand(sz, acSetCache);
+        return;
+    }
+
     if ((n = ParseNumber(&sz)) < 0) {
         outputl(_("You must specify the number of cache entries to use."));
         return;
@@ -683,27 +693,137 @@ CommandSetCache(char *sz)
         outputerr(_("Evaluation cache allocation failed"));
 }
 
+extern void
+CommandSetCacheBearoff(char *sz)
+{
+    int n;
+
+    if ((n = ParseNumber(&sz)) < 0) {
+        outputl(_("You must specify the number of bearoff positions to cache."));
+        return;
+    }
+
+    n = EvalBearoffCacheResize(n);
+    if (n != -1)
+        outputf(ngettext
+                ("The bearoff database caches have been sized to %d entry.\n",
+                 "The bearoff database caches have been sized to %d entries.\n", n), n);
+    else
+        outputerr(_("Bearoff cache allocation failed"));
+}
+
+static void
+SetCacheType(cachetype type)
+{
+    if (EvalCacheSetType(type) != 0) {
+        outputerr(_("Evaluation cache allocation failed"));
+        return;
+    }
+
+    outputf(_("The evaluation cache is now %s.\n"), aszCacheType[type]);
+}
+
+extern void
+CommandSetCacheFile(char *sz)
+{
+    char *pch = NextToken(&sz);
+
+    if (EvalCacheSetFile(pch, FALSE) != 0) {
+        outputerrf(_("Cannot keep the evaluation cache in `%s': %s\n"), pch, strerror(errno));
+        return;
+    }
+
+    if (pch)
+        outputf(_("The evaluation cache is kept in `%s'.\n"), pch);
+    else
+        outputl(_("The evaluation cache is kept in memory only."));
+}
+
+extern void
+CommandSetCacheShared(char *sz)
+{
+    char *pch = NextToken(&sz);
+    char *szName;
+
+    if (!pch) {
+        CommandSetCacheFile(NULL);
+        return;
+    }
+
+    /* POSIX shared memory objects are named /name */
+    szName = *pch == '/' ? g_strdup(pch) : g_strconcat("/", pch, NULL);
+
+    if (EvalCacheSetFile(szName, TRUE) != 0)
+        outputerrf(_("Cannot share the evaluation cache as `%s': %s\n"), szName, strerror(errno));
+    else
+        outputf(_("The evaluation cache is shared as `%s' (%u entries).\n"), szName, GetEvalCacheEntries());
+
+    g_free(szName);
+}
+
+extern void
+CommandSetCacheTypeClustered(char *UNUSED(sz))
+{
+    SetCacheType(CACHE_CLUSTERED);
+}
+
+extern void
+CommandSetCacheTypeStandard(char *UNUSED(sz))
+{
+    SetCacheType(CACHE_STANDARD);
+}
+
 #if defined(USE_MULTITHREAD)
 extern void
 CommandSetThreads(char *sz)
 {
     int n;
 
+    while (sz && isspace(*sz))
+        ++sz;
+
+    if (sz && *sz && !isdigit(*sz)) {
+        HandleCommand(sz, acSetThreads);
+        return;
+    }
+
     if ((n = ParseNumber(&sz)) <= 0) {
         outputl(_("You must specify the number of threads to use."));
 
         return;
     }
 
-    if (n > MAX_NUMTHREADS) {
-        outputf(_("%d is the maximum number of threads supported"), MAX_NUMTHREADS);
+    if (n > (int) MT_GetMaxThreads()) {
+        outputf(_("%u is the maximum number of threads supported"), MT_GetMaxThreads());
         output(".\n");
-        n = MAX_NUMTHREADS;
+        n = (int) MT_GetMaxThreads();
     }
 
     MT_SetNumThreads(n);
     outputf(_("The number of threads has been set to %d.\n"), n);
 }
+
+extern void
+CommandSetThreadsAffinity(char *sz)
+{
+    int f = td.fAffinity;
+
+    if (SetToggle("threads affinity", &f, sz,
+                  _("Each calculation thread will be kept on one processor."),
+                  _("The system will move the calculation threads between processors.")) >= 0)
+        MT_SetPlacement(f, td.fNUMA);
+}
+
+extern void
+CommandSetThreadsNUMA(char *sz)
+{
+    int f = td.fNUMA;
+
+    if (SetToggle("threads numa", &f, sz,
+                  _("Each calculation thread will place its part of the evaluation cache in its own memory."),
+                  _("The evaluation cache will be placed by the thread allocating it.")) >= 0)
+        MT_SetPlacement(td.fAffinity, f);
+}
 #endif
 
 extern void
@@ -1812,9 +1932,9 @@ CommandSetRolloutLogEnable(char *sz)
 {
     int f = log_rollouts;
 
-    SetToggle("rollout .sgf files", &f, sz,
-              _("Create an .sgf file for each game rolled out"),
-              _("Do not create an .sgf file for each game rolled out"));
+    SetToggle("rollout trace", &f, sz,
+              _("Record the games rolled out in a rollout trace"),
+              _("Do not record the games rolled out"));
 
     log_rollouts = f;
 }
@@ -1827,6 +1947,38 @@ CommandSetRolloutLogFile(char *sz)
     log_file_name = g_strdup(sz);
 }
 
+extern void
+CommandSetRolloutJournal(char *sz)
+{
+    char *pch = NextToken(&sz);
+
+    g_free(szRolloutJournal);
+    szRolloutJournal = NULL;
+
+    if (!pch || !*pch) {
+        outputl(_("Rollouts will not keep a journal."));
+        return;
+    }
+
+    szRolloutJournal = g_strdup(pch);
+    outputf(_("Rollouts will keep a journal of their trials in `%s'.\n"), szRolloutJournal);
+}
+
+extern void
+CommandSetRolloutServer(char *sz)
+{
+    char *pch = NextToken(&sz);
+
+    if (!pch || !*pch || !g_ascii_strcasecmp(pch, "off")) {
+        RolloutServerClose();
+        outputl(_("Rollouts will not use workers."));
+        return;
+    }
+
+    if (RolloutServerListen(pch) == 0)
+        outputf(_("Rollouts will hand out trials to workers connecting to %s.\n"), szRolloutServer);
+}
+
 extern void
 CommandSetRolloutLateEnable(char *sz)
 {
@@ -2190,6 +2342,39 @@ CommandSetRolloutPlayerLateCubedecision(char *sz)
 
 }
 
+extern void
+CommandSetRolloutAdaptive(char *sz)
+{
+    SetToggle("rollout adaptive", &fRolloutAdaptive, sz,
+              _("Move rollouts will give more trials to the moves that may still be best."),
+              _("Move rollouts will give all the moves the same number of trials."));
+}
+
+extern void
+CommandSetRolloutBatch(char *sz)
+{
+    int n = ParseNumber(&sz);
+
+    if (n < 1) {
+        outputl(_("You must specify how many games to play together (see `help set rollout batch')."));
+
+        return;
+    }
+
+    if (n > MAX_ROLLOUT_BATCH) {
+        outputf(_("%d is the maximum number of games played together"), MAX_ROLLOUT_BATCH);
+        output(".\n");
+        n = MAX_ROLLOUT_BATCH;
+    }
+
+    nRolloutBatch = (unsigned int) n;
+
+    if (n == 1)
+        outputl(_("Each thread will play one rollout game at a time."));
+    else
+        outputf(_("Each thread will play %d rollout games together.\n"), n);
+}
+
 extern void
 CommandSetRolloutBearoffTruncationExact(char *sz)
 {
@@ -2405,6 +2590,37 @@ CommandSetRolloutCubeful(char *sz)
     prcSet->fCubeful = f;
 }
 
+extern void
+CommandSetRolloutCubeStop(char *sz)
+{
+    HandleCommand(sz, acSetRolloutCubeStop);
+}
+
+extern void
+CommandSetRolloutCubeStopEnable(char *sz)
+{
+    SetToggle("rollout cubestop enable", &fRolloutCubeStop, sz,
+              _("Cube rollouts will stop when the cube action is clear."),
+              _("Cube rollouts will not stop on the cube action."));
+}
+
+extern void
+CommandSetRolloutCubeStopLimit(char *sz)
+{
+    float r = ParseReal(&sz);
+
+    if (r < 0.0001f) {
+        outputl(_("You must set a number of joint standard deviations for the equity "
+                  "differences deciding the cube action (see `help set rollout cubestop limit')."));
+        return;
+    }
+
+    rRolloutCubeLimit = r;
+
+    outputf(_("Cube rollouts may stop when the equities deciding the cube action differ by "
+              "more than %5.3f joint standard deviations\n"), r);
+}
+
 
 extern void
 CommandSetRolloutPlayer(char *sz)
@@ -3220,6 +3436,33 @@ CommandSetEvalSameAsAnalysis(char *sz)
               _("Evaluation settings separate from analysis settings."));
 }
 
+static void
+SetEvalPrecision(const evalprecision ep)
+{
+    if (ep != epEval) {
+        epEval = ep;
+        /* the cached evaluations were made at the other precision */
+        EvalCacheFlush();
+    }
+
+    if (ep == EVAL_PRECISION_INT16)
+        outputl(_("The neural nets will use 16 bit integer weights."));
+    else
+        outputl(_("The neural nets will use floating point weights."));
+}
+
+extern void
+CommandSetEvalPrecisionFloat(char *UNUSED(sz))
+{
+    SetEvalPrecision(EVAL_PRECISION_FLOAT);
+}
+
+extern void
+CommandSetEvalPrecisionInt16(char *UNUSED(sz))
+{
+    SetEvalPrecision(EVAL_PRECISION_INT16);
+}
+
 extern void
 CommandSetAnalysisPlayer(char *sz)
 {
@@ -245,6 +245,17 @@ ShowRollout(rolloutcontext * prc)
     outputl(prc->fVarRedn ?
             _("Lookahead variance reduction is enabled.") : _("Lookahead variance reduction is disabled."));
     outputl(prc->fRotate ? _("Quasi-random dice are enabled.") : _("Quasi-random dice are disabled."));
+    if (fRolloutAdaptive)
+        outputl(_("Move rollouts give more trials to the moves that may still be best."));
+    if (fRolloutCubeStop)
+        outputf(_("Cube rollouts stop when the equities deciding the cube action differ by %5.3f "
+                  "joint standard deviations.\n"), rRolloutCubeLimit);
+    if (nRolloutBatch > 1)
+        outputf(_("Each thread plays %u games together.\n"), nRolloutBatch);
+    if (szRolloutJournal)
+        outputf(_("Finished trials are kept in the journal `%s'.\n"), szRolloutJournal);
+    if (szRolloutServer)
+        outputf(_("Trials are handed out to rollout workers connecting to %s.\n"), szRolloutServer);
     outputl(prc->fCubeful ? _("Cubeful rollout.") : _("Cubeless rollout."));
     outputl(prc->fInitial ? _("Rollout as opening move enabled.") : _("Rollout as opening move disabled."));
     outputf(_("%s dice generator with seed %lu.\n"), gettext(aszRNG[prc->rngRollout]), prc->nSeed);
@@ -528,6 +539,11 @@ CommandShowCache(char *UNUSED(sz))
 
     EvalCacheStats(c, cLookup, cHit);
 
+    outputf(_("The evaluation cache is %s.\n"), aszCacheType[cEval.type]);
+    if (cEval.szFile)
+        outputf(cEval.fShared ? _("It is kept in shared memory as `%s'.\n") : _("It is kept in `%s'.\n"),
+                cEval.szFile);
+
     outputf(_("%10u regular eval entries used %10u lookups %10u hits"), c[0], cLookup[0], cHit[0]);
 
     if (cLookup[0])
@@ -716,9 +732,14 @@ CommandShowEngine(char *UNUSED(sz))
 }
 
 extern void
-CommandShowEvaluation(char *UNUSED(sz))
+CommandShowEvaluation(char *sz)
 {
 
+    if (sz && *sz) {
+        HandleCommand(sz, acShowEvaluation);
+        return;
+    }
+
     outputl(_("`eval' and `hint' will use:"));
     outputl(_("    Chequer play:"));
     ShowEvalSetup(GetEvalChequer());
@@ -726,7 +747,24 @@ CommandShowEvaluation(char *UNUSED(sz))
     ShowMoveFilters(*GetEvalMoveFilter());
     outputl(_("    Cube decisions:"));
     ShowEvalSetup(GetEvalCube());
+    outputf(_("    Neural net precision: %s\n"), aszEvalPrecision[epEval]);
+
+}
+
+extern void
+CommandShowEvaluationKernels(char *UNUSED(sz))
+{
+    const nnkernel *ank;
+    const nnkernel *pnkActive = NeuralNetKernel();
+    unsigned int i, c = NeuralNetKernels(&ank);
+
+    outputl(_("Neural net evaluation kernels:"));
+
+    for (i = 0; i < c; i++)
+        outputf("  %c %-12s %s\n", &ank[i] == pnkActive ? '*' : ' ', ank[i].szName,
+                ank[i].fSupported ? _("supported by this CPU") : _("not supported by this CPU"));
 
+    outputf(_("Using %s (%u floats per vector).\n"), pnkActive->szName, pnkActive->cVecSize);
 }
 
 #if defined(USE_GTK)
@@ -1143,6 +1181,11 @@ CommandShowThreads(char *UNUSED(sz))
 {
     int c = MT_GetNumThreads();
     outputf(ngettext("%d calculation thread.\n", "%d calculation threads.\n", c), c);
+    outputf(_("At most %u threads can be used.\n"), MT_GetMaxThreads());
+    if (td.fAffinity)
+        outputl(_("Each thread is kept on one processor."));
+    if (td.fNUMA)
+        outputl(_("Each thread places its part of the evaluation cache in its own memory."));
 }
 #endif
 
@@ -20,6 +20,8 @@
 
 #include "backgammon.h"
 #include "multithread.h"
+#include "positionid.h"
+#include "rollout.h"
 
 #if defined(USE_GTK)
 #include "gtkgame.h"
@@ -28,6 +30,7 @@
 #ifndef WIN32
 #include <stdlib.h>
 #endif
+#include <math.h>
 
 #include "lib/isaac.h"
 #include "lib/simd.h"
@@ -177,3 +180,262 @@ CommandCalibrate(char *sz)
         outputl(_("Calibration incomplete."));
     }
 }
+
+/* The positions rolled out by "benchmark rollout": contact, race, the
+ * one-sided bearoff database and a double/take decision */
+static const struct {
+    const char *szName;
+    const char *szID;
+    int fCubeDecision;
+} abp[] = {
+    { "contact", "sGfwATDgc/ABMA", FALSE },
+    { "race", "bbszAADa3UsAAA", FALSE },
+    { "bearoff", "bXcPAADb7g4AAA", FALSE },
+    { "cube", "4Dl4AGxsOwcHAA", TRUE }
+};
+
+#define BENCHMARK_TRIALS 324
+#define BENCHMARK_SEED 1
+
+static const evalcontext ecBenchmark = {
+    .fCubeful = TRUE, .nPlies = 0, .fUsePrune = TRUE, .fDeterministic = TRUE, .rNoise = 0.0f
+};
+
+/* Roll out the positions above with the same settings whatever
+ * "set rollout" says, so that the numbers can be compared between
+ * builds, and print them as "key=value" fields one line per position.
+ * The evaluations and cache hit rate need a build with CACHE_STATS. */
+extern void
+CommandBenchmarkRollout(char *sz)
+{
+    int n = BENCHMARK_TRIALS;
+    unsigned int i, cGames = 0, cThreads = MT_GetNumThreads();
+    int fShowProgressSave = fShowProgress, log_rolloutsSave = log_rollouts;
+    char *szJournalSave = szRolloutJournal;
+    double t, rTotal = 0.0;
+    rolloutcontext rcSave;
+    cubeinfo ci;
+    char szTime[G_ASCII_DTOSTR_BUF_SIZE], szRate[G_ASCII_DTOSTR_BUF_SIZE];
+#if CACHE_STATS
+    unsigned int c[2], cLookup[2], cHit[2], cLookupStart, cHitStart;
+    unsigned int cLookupTotal = 0, cHitTotal = 0;
+    char szEvalRate[G_ASCII_DTOSTR_BUF_SIZE], szHitRate[G_ASCII_DTOSTR_BUF_SIZE];
+#endif
+
+    if (sz && *sz) {
+        n = ParseNumber(&sz);
+
+        if (n < 1) {
+            outputl(_("If you specify a parameter to `benchmark rollout', "
+                      "it must be the number of trials for each position."));
+            return;
+        }
+    }
+
+    /* a new rollout takes its settings from rcRollout */
+    memcpy(&rcSave, &rcRollout, sizeof(rcSave));
+    rcRollout.aecCube[0] = rcRollout.aecCube[1] = rcRollout.aecChequer[0] = rcRollout.aecChequer[1] = ecBenchmark;
+    rcRollout.fCubeful = TRUE;
+    rcRollout.fVarRedn = TRUE;
+    rcRollout.fInitial = FALSE;
+    rcRollout.fRotate = TRUE;
+    rcRollout.fLateEvals = FALSE;
+    rcRollout.fDoTruncate = FALSE;
+    rcRollout.fStopOnSTD = FALSE;
+    rcRollout.fStopOnJsd = FALSE;
+    rcRollout.fStopMoveOnJsd = FALSE;
+    rcRollout.nTrials = (unsigned int) n;
+    rcRollout.rngRollout = RNG_MERSENNE;
+    rcRollout.nSeed = BENCHMARK_SEED;
+
+    /* nothing to resume, log or draw */
+    fShowProgress = FALSE;
+    log_rollouts = FALSE;
+    szRolloutJournal = NULL;
+
+    SetCubeInfoMoney(&ci, 1, -1, 0, FALSE, FALSE, VARIATION_STANDARD);
+
+    outputf("benchmark threads=%u trials=%d seed=%d\n", cThreads, n, BENCHMARK_SEED);
+
+    MT_ResetLockWait();
+
+    for (i = 0; i < G_N_ELEMENTS(abp); i++) {
+        TanBoard anBoard;
+        float aarOutput[2][NUM_ROLLOUT_OUTPUTS], aarStdDev[2][NUM_ROLLOUT_OUTPUTS];
+        rolloutstat aarsStatistics[2][2];
+        unsigned int cPosition;
+        int r;
+
+        PositionFromID(anBoard, abp[i].szID);
+
+        /* every position starts with an empty cache */
+        EvalCacheFlush();
+#if CACHE_STATS
+        EvalCacheStats(c, cLookup, cHit);
+        cLookupStart = cLookup[0];
+        cHitStart = cHit[0];
+#endif
+
+        t = get_time();
+        if (abp[i].fCubeDecision) {
+            evalsetup es;
+
+            es.et = EVAL_NONE;
+            memcpy(&es.rc, &rcRollout, sizeof(rolloutcontext));
+            r = GeneralCubeDecisionR(aarOutput, aarStdDev, aarsStatistics, (ConstTanBoard) anBoard, &ci, &es.rc, &es,
+                                     NULL, NULL);
+            cPosition = 2 * rcRollout.nTrials;
+        } else {
+            r = GeneralEvaluationR(aarOutput[0], aarStdDev[0], aarsStatistics[0], (ConstTanBoard) anBoard, &ci,
+                                   &rcRollout, NULL, NULL);
+            cPosition = rcRollout.nTrials;
+        }
+        t = (get_time() - t) / 1000.0;
+
+        if (r < 0 || MT_SafeGet(&fInterrupt))
+            break;
+
+        cGames += cPosition;
+        rTotal += t;
+
+        g_ascii_formatd(szTime, sizeof(szTime), "%.3f", t);
+        g_ascii_formatd(szRate, sizeof(szRate), "%.1f", t > 0.0 ? cPosition / t : 0.0);
+        outputf("benchmark position=%s trials=%u seconds=%s trials_per_second=%s", abp[i].szName, cPosition, szTime,
+                szRate);
+#if CACHE_STATS
+        EvalCacheStats(c, cLookup, cHit);
+        cLookup[0] -= cLookupStart;
+        cHit[0] -= cHitStart;
+        cLookupTotal += cLookup[0];
+        cHitTotal += cHit[0];
+        g_ascii_formatd(szEvalRate, sizeof(szEvalRate), "%.0f", t > 0.0 ? (cLookup[0] - cHit[0]) / t : 0.0);
+        g_ascii_formatd(szHitRate, sizeof(szHitRate), "%.4f", cLookup[0] ? (double) cHit[0] / cLookup[0] : 0.0);
+        outputf(" evals=%u evals_per_second=%s cache_hit_rate=%s", cLookup[0] - cHit[0], szEvalRate, szHitRate);
+#endif
+        outputc('\n');
+    }
+
+    memcpy(&rcRollout, &rcSave, sizeof(rcRollout));
+    fShowProgress = fShowProgressSave;
+    log_rollouts = log_rolloutsSave;
+    szRolloutJournal = szJournalSave;
+
+    if (i < G_N_ELEMENTS(abp)) {
+        outputl(_("Benchmark interrupted."));
+        return;
+    }
+
+    g_ascii_formatd(szTime, sizeof(szTime), "%.3f", rTotal);
+    g_ascii_formatd(szRate, sizeof(szRate), "%.1f", rTotal > 0.0 ? cGames / rTotal : 0.0);
+    outputf("benchmark position=total trials=%u seconds=%s trials_per_second=%s", cGames, szTime, szRate);
+#if CACHE_STATS
+    g_ascii_formatd(szEvalRate, sizeof(szEvalRate), "%.0f", rTotal > 0.0 ? (cLookupTotal - cHitTotal) / rTotal : 0.0);
+    g_ascii_formatd(szHitRate, sizeof(szHitRate), "%.4f", cLookupTotal ? (double) cHitTotal / cLookupTotal : 0.0);
+    outputf(" evals=%u evals_per_second=%s cache_hit_rate=%s", cLookupTotal - cHitTotal, szEvalRate, szHitRate);
+#endif
+    outputc('\n');
+
+    /* the main thread last */
+    for (i = 0; i <= cThreads; i++) {
+        g_ascii_formatd(szTime, sizeof(szTime), "%.3f", MT_GetLockWait(i < cThreads ? (int) i : -1));
+        if (i < cThreads)
+            outputf("benchmark thread=%u lock_wait_seconds=%s\n", i, szTime);
+        else
+            outputf("benchmark thread=main lock_wait_seconds=%s\n", szTime);
+    }
+}
+
+/* "benchmark precision" plays this many games, and the int16 nets must
+ * be within PRECISION_BOUND of the float ones in cubeless equity on
+ * all their positions; `help set evaluation precision int16' quotes
+ * the bound */
+#define PRECISION_GAMES 100
+#define PRECISION_BOUND 0.01
+
+/* Play PRECISION_GAMES games at 0-ply with the float nets and dice from
+ * a fixed seed, and evaluate each of their positions that a neural net
+ * evaluates with both precisions.  Prints the largest and mean
+ * difference in cubeless equity for each net, as "key=value" fields,
+ * and whether the largest is within PRECISION_BOUND. */
+extern void
+CommandBenchmarkPrecision(char *UNUSED(sz))
+{
+    static const char *aszNet[NUM_NN_STATES] = { "race", "crashed", "contact" };
+    evalprecision const epSave = epEval;
+    evalcontext ec = ecBasic;
+    randctx rcGames;
+    double arMax[NUM_NN_STATES] = { 0.0 }, arSum[NUM_NN_STATES] = { 0.0 }, rMax = 0.0;
+    unsigned int ac[NUM_NN_STATES] = { 0 }, cTotal = 0, i;
+    char szMax[G_ASCII_DTOSTR_BUF_SIZE], szMean[G_ASCII_DTOSTR_BUF_SIZE], szBound[G_ASCII_DTOSTR_BUF_SIZE];
+
+    if (!nnRace.asHiddenWeight || !nnCrashed.asHiddenWeight || !nnContact.asHiddenWeight) {
+        outputl(_("The neural nets have no 16 bit integer weights."));
+        return;
+    }
+
+    for (i = 0; i < RANDSIZ; i++)
+        rcGames.randrsl[i] = BENCHMARK_SEED;
+    irandinit(&rcGames, TRUE);
+
+    /* the games are played with the float nets */
+    if (epSave != EVAL_PRECISION_FLOAT) {
+        epEval = EVAL_PRECISION_FLOAT;
+        EvalCacheFlush();
+    }
+
+    for (i = 0; i < PRECISION_GAMES && !MT_SafeGet(&fInterrupt); i++) {
+        TanBoard anBoard;
+        positionclass pc;
+
+        InitBoard(anBoard, VARIATION_STANDARD);
+
+        /* the rest of the game is in the bearoff databases */
+        while ((pc = ClassifyPosition((ConstTanBoard) anBoard, VARIATION_STANDARD)) >= CLASS_RACE) {
+            SSE_ALIGN(float arFloat[NUM_OUTPUTS]);
+            SSE_ALIGN(float arInt16[NUM_OUTPUTS]);
+            int anMove[8], anDice[2];
+            double r;
+
+            /* straight to the nets, past the evaluation cache */
+            acef[pc] ((ConstTanBoard) anBoard, arFloat, VARIATION_STANDARD, NULL);
+            epEval = EVAL_PRECISION_INT16;
+            acef[pc] ((ConstTanBoard) anBoard, arInt16, VARIATION_STANDARD, NULL);
+            epEval = EVAL_PRECISION_FLOAT;
+
+            r = fabs(Utility(arFloat, &ciCubeless) - Utility(arInt16, &ciCubeless));
+            arMax[NN_STATE(pc)] = MAX(arMax[NN_STATE(pc)], r);
+            arSum[NN_STATE(pc)] += r;
+            ac[NN_STATE(pc)]++;
+
+            anDice[0] = (int) (irand(&rcGames) % 6) + 1;
+            anDice[1] = (int) (irand(&rcGames) % 6) + 1;
+            if (FindBestMove(anMove, anDice[0], anDice[1], anBoard, &ciCubeless, &ec, defaultFilters) < 0)
+                break;
+            SwapSides(anBoard);
+        }
+    }
+
+    if (epSave != EVAL_PRECISION_FLOAT) {
+        epEval = epSave;
+        EvalCacheFlush();
+    }
+
+    if (i < PRECISION_GAMES) {
+        outputl(_("Benchmark interrupted."));
+        return;
+    }
+
+    for (i = 0; i < NUM_NN_STATES; i++) {
+        g_ascii_formatd(szMax, sizeof(szMax), "%.6f", arMax[i]);
+        g_ascii_formatd(szMean, sizeof(szMean), "%.6f", ac[i] ? arSum[i] / ac[i] : 0.0);
+        outputf("benchmark precision=int16 net=%s positions=%u max_equity_diff=%s mean_equity_diff=%s\n",
+                aszNet[i], ac[i], szMax, szMean);
+        rMax = MAX(rMax, arMax[i]);
+        cTotal += ac[i];
+    }
+
+    g_ascii_formatd(szMax, sizeof(szMax), "%.6f", rMax);
+    g_ascii_formatd(szBound, sizeof(szBound), "%.6f", PRECISION_BOUND);
+    outputf("benchmark precision=int16 net=all positions=%u max_equity_diff=%s bound=%s result=%s\n",
+            cTotal, szMax, szBound, rMax <= PRECISION_BOUND ? "pass" : "fail");
+}